@@ -32,6 +32,7 @@
 // code to implement Advanced Encryption Standard - Rijndael
 // speed optimized version
 #include "AES.h"
+#include "AESNI.h"
 #include <algorithm>
 #include <stdio.h>
 #include <string.h>
@@ -56,39 +57,8 @@ using namespace std;
 
 namespace { // anonymous namespace for local linkage
 
-// tables for inverses, byte sub
-unsigned char gf2_8_inv[256];
-unsigned char byte_sub[256];
-unsigned char inv_byte_sub[256];
-
-// this table needs Nb*(Nr+1)/Nk entries - up to 8*(15)/4 = 60
-// todo - remove table, note cycles every 17(?) elements
-uint32_t Rcon[60];
-
-// long tables for encryption stuff
-uint32_t T0[256];
-uint32_t T1[256];
-uint32_t T2[256];
-uint32_t T3[256];
-
-// long tables for decryption stuff
-uint32_t I0[256];
-uint32_t I1[256];
-uint32_t I2[256];
-uint32_t I3[256];
-
-// huge tables - todo - ifdef out
-uint32_t T4[256];
-uint32_t T5[256];
-uint32_t T6[256];
-uint32_t T7[256];
-uint32_t I4[256];
-uint32_t I5[256];
-uint32_t I6[256];
-uint32_t I7[256];
-
-// have the tables been initialized?
-bool tablesInitialized = false;
+// constant tables (S-box, Rcon, T- and I-tables), no runtime initialization required
+#include "AESTables.h"
 
 // define to mult a byte by x mod the proper poly
 // todo - move magic numbers out?
@@ -138,7 +108,7 @@ inline unsigned char GF2_8_mult(unsigned char a, unsigned char b)
 	return result;
 	} // GF2_8_mult
 
-bool CheckLargeTables(bool create)
+bool CheckLargeTables()
 	{
 	unsigned int i;
 	unsigned char a1,a2,a3,b1,b2,b3,b4,b5;
@@ -154,74 +124,47 @@ bool CheckLargeTables(bool create)
 		b3 = GF2_8_mult(0x0D,b5);
 		b4 = GF2_8_mult(0x0B,b5);
 
-		if (create == true)
-			{
-			T0[i] = VEC4(a2,a1,a1,a3);
-			T1[i] = RotByteL(T0[i]);
-			T2[i] = RotByteL(T1[i]);
-			T3[i] = RotByteL(T2[i]);
-
-			T4[i] = VEC4(a1,0,0,0); // identity
-			T5[i] = RotByteL(T4[i]);
-			T6[i] = RotByteL(T5[i]);
-			T7[i] = RotByteL(T6[i]);
-
-			I0[i] = VEC4(b1,b2,b3,b4);
-			I1[i] = RotByteL(I0[i]);
-			I2[i] = RotByteL(I1[i]);
-			I3[i] = RotByteL(I2[i]);
-
-			I4[i] = VEC4(b5,0,0,0); // identity
-			I5[i] = RotByteL(I4[i]);
-			I6[i] = RotByteL(I5[i]);
-			I7[i] = RotByteL(I6[i]);
-			}
-		else
-			{
-			if (T0[i] != VEC4(a2,a1,a1,a3))
-				return false;
-			if (T1[i] != RotByteL(T0[i]))
-				return false;
-			if (T2[i] != RotByteL(T1[i]))
-				return false;
-			if (T3[i] != RotByteL(T2[i]))
-				return false;
-			if (T4[i] != VEC4(a1,0,0,0))
-				return false;
-			if (T5[i] != RotByteL(T4[i]))
-				return false;
-			if (T6[i] != RotByteL(T5[i]))
-				return false;
-			if (T7[i] != RotByteL(T6[i]))
-				return false;
-			if (I0[i] != VEC4(b1,b2,b3,b4))
-				return false;
-			if (I1[i] != RotByte(I0[i]))
-				return false;
-			if (I2[i] != RotByte(I1[i]))
-				return false;
-			if (I3[i] != RotByte(I2[i]))
-				return false;
-			if (I4[i] != VEC4(b5,0,0,0))
-				return false;
-			if (I5[i] != RotByteL(I4[i]))
-				return false;
-			if (I6[i] != RotByteL(I5[i]))
-				return false;
-			if (I7[i] != RotByteL(I6[i]))
-				return false;
-			}
+		if (T0[i] != VEC4(a2,a1,a1,a3))
+			return false;
+		if (T1[i] != RotByteL(T0[i]))
+			return false;
+		if (T2[i] != RotByteL(T1[i]))
+			return false;
+		if (T3[i] != RotByteL(T2[i]))
+			return false;
+		if (T4[i] != VEC4(a1,0,0,0))
+			return false;
+		if (T5[i] != RotByteL(T4[i]))
+			return false;
+		if (T6[i] != RotByteL(T5[i]))
+			return false;
+		if (T7[i] != RotByteL(T6[i]))
+			return false;
+		if (I0[i] != VEC4(b1,b2,b3,b4))
+			return false;
+		if (I1[i] != RotByteL(I0[i]))
+			return false;
+		if (I2[i] != RotByteL(I1[i]))
+			return false;
+		if (I3[i] != RotByteL(I2[i]))
+			return false;
+		if (I4[i] != VEC4(b5,0,0,0))
+			return false;
+		if (I5[i] != RotByteL(I4[i]))
+			return false;
+		if (I6[i] != RotByteL(I5[i]))
+			return false;
+		if (I7[i] != RotByteL(I6[i]))
+			return false;
 		}
 	return true;
 	} // CheckLargeTables
 
 // some functions to create/verify table integrity
-bool CheckInverses(bool create)
+bool CheckInverses()
 	{
 	unsigned int a,b; // need int here to prevent wraps in loop
-	if (create == true)
-		gf2_8_inv[0] = 0;
-	else if (gf2_8_inv[0] != 0)
+	if (gf2_8_inv[0] != 0)
 		return false;
 	for (a = 1; a <= 255; a++)
 		{
@@ -229,9 +172,7 @@ bool CheckInverses(bool create)
 		while (GF2_8_mult(a,b) != 1)
 			b++;
 
-		if (create == true)
-			gf2_8_inv[a] = b;
-		else if (gf2_8_inv[a] != b)
+		if (gf2_8_inv[a] != b)
 			return false;
 		}
 	return true;
@@ -244,9 +185,9 @@ unsigned char BitSum(unsigned char byte)
 	return (byte>>1)^(byte&1);
 	} // BitSum
 
-bool CheckByteSub(bool create)
+bool CheckByteSub()
 	{
-	if (CheckInverses(create) == false)
+	if (CheckInverses() == false)
 		return false; // we cannot do this without inverses
 
 	unsigned int x,y; // need ints here to prevent wrap in loop
@@ -258,19 +199,17 @@ bool CheckByteSub(bool create)
 		y = BitSum(y&0xF1) | (BitSum(y&0xE3)<<1) | (BitSum(y&0xC7)<<2) | (BitSum(y&0x8F)<<3) |
 			(BitSum(y&0x1F)<<4) | (BitSum(y&0x3E)<<5) | (BitSum(y&0x7C)<<6) | (BitSum(y&0xF8)<<7);
 		y = y ^ 0x63;
-		if (create == true)
-			byte_sub[x] = y;
-		else if (byte_sub[x] != y)
+		if (byte_sub[x] != y)
 			return false;
 		}
 	return true;
 	} // CheckByteSub
 
-bool CheckInvByteSub(bool create)
+bool CheckInvByteSub()
 	{
-	if (CheckInverses(create) == false)
+	if (CheckInverses() == false)
 		return false; // we cannot do this without inverses
-	if (CheckByteSub(create) == false)
+	if (CheckByteSub() == false)
 		return false; // we cannot do this without byte_sub
 
 	unsigned int x,y; // need ints here to prevent wrap in loop
@@ -280,27 +219,21 @@ bool CheckInvByteSub(bool create)
 		y = 0;
 		while (byte_sub[y] != x)
 			y++;
-		if (create == true)
-			inv_byte_sub[x] = y;
-		else if (inv_byte_sub[x] != y)
+		if (inv_byte_sub[x] != y)
 			return false;
 		}
 	return true;
 	} // CheckInvByteSub
 
-bool CheckRcon(bool create)
+bool CheckRcon()
 	{
 	unsigned char Ri = 1; // start here
 
-	if (create == true)
-		Rcon[0] = 0;
-	else if (Rcon[0] != 0)
+	if (Rcon[0] != 0)
 		return false; // todo - this is unused still check?
 	for (unsigned int i = 1; i < sizeof(Rcon)/sizeof(Rcon[0])-1; i++)
 		{
-		if (create == true)
-			Rcon[i] = Ri;
-		else if (Rcon[i] != Ri)
+		if (Rcon[i] != Ri)
 			return false;
 		Ri = GF2_8_mult(Ri,0x02); // multiply by x - todo replace with xmult
 		}
@@ -476,22 +409,22 @@ bool CheckRcon(bool create)
 	return result;
 	} // SubByte
 
-// return true iff tables are valid. create = true fills them in if not
-bool CreateAESTables(bool create)
+// return true iff the precomputed tables match the generating functions
+bool CheckAESTables()
 	{
 	bool retval = true;
-	if (CheckInverses(create) == false)
+	if (CheckInverses() == false)
 		retval = false;
-	if (CheckByteSub(create) == false)
+	if (CheckByteSub() == false)
 		retval = false;
-	if (CheckInvByteSub(create) == false)
+	if (CheckInvByteSub() == false)
 		retval = false;
-	if (CheckRcon(create) == false)
+	if (CheckRcon() == false)
 		return false;
-	if (CheckLargeTables(create) == false)
+	if (CheckLargeTables() == false)
 		return false;
 	return retval;
-	} // CreateAESTables
+	} // CheckAESTables
 
 }// end of anonymous namespace
 
@@ -693,28 +626,18 @@ void AES::StartDecryption(const unsigned char * key)
 	memset(iv, 0xff, sizeof(iv));
 	KeyExpansion(key);
 
-	unsigned char a0,a1,a2,a3,b0,b1,b2,b3, * W_ptr = W;
+	unsigned char * W_ptr = W;
 
 	for (int col = Nb; col < (Nr)*Nb; col++) // do all but first and last round
 		{
-		a0 = W_ptr[4*col+0];
-		a1 = W_ptr[4*col+1];
-		a2 = W_ptr[4*col+2];
-		a3 = W_ptr[4*col+3];
-
-		b0 = GF2_8_mult(0x0E,a0)^GF2_8_mult(0x0B,a1)^
-		     GF2_8_mult(0x0D,a2)^GF2_8_mult(0x09,a3);
-		b1 = GF2_8_mult(0x09,a0)^GF2_8_mult(0x0E,a1)^
-		     GF2_8_mult(0x0B,a2)^GF2_8_mult(0x0D,a3);
-		b2 = GF2_8_mult(0x0D,a0)^GF2_8_mult(0x09,a1)^
-		     GF2_8_mult(0x0E,a2)^GF2_8_mult(0x0B,a3);
-		b3 = GF2_8_mult(0x0B,a0)^GF2_8_mult(0x0D,a1)^
-		     GF2_8_mult(0x09,a2)^GF2_8_mult(0x0E,a3);
-
-		W_ptr[4*col+0] = b0;
-		W_ptr[4*col+1] = b1;
-		W_ptr[4*col+2] = b2;
-		W_ptr[4*col+3] = b3;
+		// InvMixColumn with the I-tables: I0[byte_sub[a]] = (0E.a, 09.a, 0D.a, 0B.a)
+		uint32_t b = I0[byte_sub[W_ptr[4*col+0]]]^I1[byte_sub[W_ptr[4*col+1]]]^
+		             I2[byte_sub[W_ptr[4*col+2]]]^I3[byte_sub[W_ptr[4*col+3]]];
+
+		W_ptr[4*col+0] = GetByte(b,0);
+		W_ptr[4*col+1] = GetByte(b,1);
+		W_ptr[4*col+2] = GetByte(b,2);
+		W_ptr[4*col+3] = GetByte(b,3);
 		}
 
 	// we reverse the rounds to make decryption faster
@@ -828,6 +751,12 @@ void AES::Decrypt(const unsigned char * datain, unsigned char * dataout, uint32_
 			break;
 		case CBC :
 			{
+			if (Nb == 8 && AesNiAvailable())
+				{
+				// Rijndael-256 with the AES round instructions, same key schedule
+				AesNiDecryptCbc256(W, Nr, iv, datain, dataout, numBlocks);
+				break;
+				}
 			int iBuf = 0;
 			unsigned char buffer[2][32]; // max blocksize
 			memcpy(buffer[iBuf], datain, blocksize);
@@ -854,11 +783,20 @@ void AES::Decrypt(const unsigned char * datain, unsigned char * dataout, uint32_
 		}
 	} // Decrypt
 
-// the constructor - makes sure local things are initialized
+// the constructor - the tables are constant data, nothing to initialize
 AES::AES(void)
 	{
-	if (false == tablesInitialized)
-		tablesInitialized = CreateAESTables(true);
+	}
+
+// verify the precomputed tables against the generating functions
+bool AES::SelfTest(void)
+	{
+	return CheckAESTables();
+	}
+
+const char * AES::DecryptImplementation(void)
+	{
+	return AesNiAvailable() ? "aes-ni" : "t-tables";
 	}
 
 // end - AES.cpp
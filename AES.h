@@ -68,10 +68,17 @@ typedef unsigned int uint32_t;
 class AES
 	{
 public:
-	// the constructor - makes sure local things are initialized
-	// it if fails, throws the string "Tables failed to initialize"
+	// the constructor - the lookup tables are precomputed constant data (AESTables.h)
 	AES(void);
 
+	// recomputes all lookup tables and compares them with the precomputed ones
+	// returns false if a table is corrupt - only needed for tests, not for encryption
+	static bool SelfTest(void);
+
+	// name of the implementation used by Decrypt() in CBC mode with 256 bit blocks:
+	// "aes-ni" if the CPU has the AES round instructions (AESNI.h), "t-tables" otherwise
+	static const char * DecryptImplementation(void);
+
 	// multiple block encryption/decryption modes
 	// See http://en.wikipedia.org/wiki/Block_cipher_modes_of_operation
 	enum BlockMode {
@@ -0,0 +1,126 @@
+#include "AESNI.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define AESNI_HAVE_X86 1
+#endif
+
+#ifdef AESNI_HAVE_X86
+
+#define AESNI_TARGET __attribute__((target("aes,ssse3,sse4.1")))
+
+// blocks decrypted at the same time
+#define AESNI_PARALLEL 4
+
+static bool CpuHasAesNi(void) {
+    unsigned int eax, ebx, ecx, edx;
+    if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return (ecx & bit_AES) && (ecx & bit_SSSE3) && (ecx & bit_SSE4_1);
+}
+
+bool AesNiAvailable(void) {
+    // checked on first use, thread safe since C++11
+    static const bool available = CpuHasAesNi();
+    return available;
+}
+
+/*
+ * Byte i of a half is row i % 4 of column i / 4. Rijndael-256 InvShiftRows takes row r of column c from column
+ * c - (0, 1, 3, 4)[r], AESDEC takes it from column c - r of the same half. The blend takes bytes 3, 6, 7, 10, 11, 13,
+ * 14 and 15 from the other half, the shuffle then places them where the InvShiftRows of AESDEC expects them
+ * (the same mask for both halves).
+ */
+AESNI_TARGET
+static inline void PrepareInvShiftRows(__m128i & lo, __m128i & hi) {
+    const __m128i blend = _mm_setr_epi8(0, 0, 0, -128, 0, 0, -128, -128, 0, 0, -128, -128, 0, -128, -128, -128);
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 14, 15, 4, 5, 2, 3, 8, 9, 6, 7, 12, 13, 10, 11);
+    __m128i a = _mm_blendv_epi8(lo, hi, blend);
+    __m128i b = _mm_blendv_epi8(hi, lo, blend);
+    lo = _mm_shuffle_epi8(a, shuffle);
+    hi = _mm_shuffle_epi8(b, shuffle);
+}
+
+// decrypts count (1 .. AESNI_PARALLEL) blocks of state, lo/hi = columns 0-3 and 4-7 of each block
+AESNI_TARGET
+static inline void DecryptBlocks(const __m128i * keys, int rounds, __m128i * lo, __m128i * hi, int count) {
+    for(int b = 0; b < count; b++) {
+        lo[b] = _mm_xor_si128(lo[b], keys[0]);
+        hi[b] = _mm_xor_si128(hi[b], keys[1]);
+    }
+    for(int r = 1; r < rounds; r++) {
+        __m128i keyLo = _mm_loadu_si128(keys + 2 * r);
+        __m128i keyHi = _mm_loadu_si128(keys + 2 * r + 1);
+        for(int b = 0; b < count; b++) {
+            PrepareInvShiftRows(lo[b], hi[b]);
+            lo[b] = _mm_aesdec_si128(lo[b], keyLo);
+            hi[b] = _mm_aesdec_si128(hi[b], keyHi);
+        }
+    }
+    __m128i keyLo = _mm_loadu_si128(keys + 2 * rounds);
+    __m128i keyHi = _mm_loadu_si128(keys + 2 * rounds + 1);
+    for(int b = 0; b < count; b++) {
+        PrepareInvShiftRows(lo[b], hi[b]);
+        lo[b] = _mm_aesdeclast_si128(lo[b], keyLo);
+        hi[b] = _mm_aesdeclast_si128(hi[b], keyHi);
+    }
+}
+
+AESNI_TARGET
+void AesNiDecryptCbc256(const unsigned char * roundKeys, int rounds, const unsigned char * iv,
+                        const unsigned char * datain, unsigned char * dataout, uint32_t numBlocks) {
+    __m128i keys[2 * 15];
+    for(int i = 0; i < 2 * (rounds + 1) && i < 2 * 15; i++) {
+        keys[i] = _mm_loadu_si128((const __m128i *) roundKeys + i);
+    }
+    const __m128i * in = (const __m128i *) datain;
+    __m128i * out = (__m128i *) dataout;
+    __m128i prevLo = _mm_loadu_si128((const __m128i *) iv);
+    __m128i prevHi = _mm_loadu_si128((const __m128i *) iv + 1);
+
+    while(numBlocks > 0) {
+        int count = numBlocks < AESNI_PARALLEL ? (int) numBlocks : AESNI_PARALLEL;
+        __m128i lo[AESNI_PARALLEL], hi[AESNI_PARALLEL];
+        for(int b = 0; b < count; b++) {
+            lo[b] = _mm_loadu_si128(in + 2 * b);
+            hi[b] = _mm_loadu_si128(in + 2 * b + 1);
+        }
+        if(count == AESNI_PARALLEL) {
+            // constant count: the loops are unrolled and the states stay in registers
+            DecryptBlocks(keys, rounds, lo, hi, AESNI_PARALLEL);
+        } else {
+            DecryptBlocks(keys, rounds, lo, hi, count);
+        }
+        // xor with the previous ciphertext block; all input is read before the output is written (in place)
+        lo[0] = _mm_xor_si128(lo[0], prevLo);
+        hi[0] = _mm_xor_si128(hi[0], prevHi);
+        for(int b = 1; b < count; b++) {
+            lo[b] = _mm_xor_si128(lo[b], _mm_loadu_si128(in + 2 * b - 2));
+            hi[b] = _mm_xor_si128(hi[b], _mm_loadu_si128(in + 2 * b - 1));
+        }
+        prevLo = _mm_loadu_si128(in + 2 * count - 2);
+        prevHi = _mm_loadu_si128(in + 2 * count - 1);
+        for(int b = 0; b < count; b++) {
+            _mm_storeu_si128(out + 2 * b, lo[b]);
+            _mm_storeu_si128(out + 2 * b + 1, hi[b]);
+        }
+        in += 2 * count;
+        out += 2 * count;
+        numBlocks -= count;
+    }
+}
+
+#else
+
+bool AesNiAvailable(void) {
+    return false;
+}
+
+// not reached, AES::Decrypt() checks AesNiAvailable()
+void AesNiDecryptCbc256(const unsigned char *, int, const unsigned char *, const unsigned char *, unsigned char *,
+                        uint32_t) {
+}
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef _AESNI_H
+#define _AESNI_H
+
+#include <stdint.h>
+
+/*
+ * Rijndael-256 decryption (32 byte blocks as used by RSCP) with the AES round instructions of x86 CPUs.
+ *
+ * AESDEC computes one AES round on 16 bytes: InvShiftRows, InvSubBytes, InvMixColumns and AddRoundKey.
+ * Rijndael-256 has 8 columns and shifts the rows by 1, 3 and 4 columns instead of 1, 2 and 3. The state is held in
+ * two registers of 4 columns each; before every round a blend and a byte shuffle move the bytes so that the
+ * InvShiftRows of AESDEC on each half gives the InvShiftRows of Rijndael-256. All other steps work per byte or per
+ * column and are the same for both block sizes, the round keys are the ones of AES::StartDecryption().
+ *
+ * The blocks of a CBC decryption are independent of each other, 4 blocks are decrypted interleaved to hide the
+ * latency of AESDEC. AES::Decrypt() uses this implementation when the CPU supports it, the T-table code otherwise.
+ */
+
+// the CPU supports AES-NI, SSSE3 and SSE4.1 (checked once)
+bool AesNiAvailable(void);
+
+// CBC decryption of numBlocks blocks of 32 bytes, datain and dataout may be the same buffer.
+// roundKeys: (rounds + 1) * 32 bytes in the order of decryption, iv: 32 bytes
+void AesNiDecryptCbc256(const unsigned char * roundKeys, int rounds, const unsigned char * iv,
+                        const unsigned char * datain, unsigned char * dataout, uint32_t numBlocks);
+
+#endif // _AESNI_H
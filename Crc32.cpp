@@ -0,0 +1,126 @@
+#include "Crc32.h"
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#include <arm_acle.h>
+#define CRC32_HAVE_ARM 1
+#endif
+
+/*
+ * Original implementation with a 16 entry table (4 bits per step).
+ * Init value and final xor of the standard CRC32 are folded into the table, so it starts with 0.
+ */
+uint32_t Crc32Nibble(const uint8_t *data, size_t length) {
+    static const uint32_t crc_table[] = {
+      0x4DBDF21C, 0x500AE278, 0x76D3D2D4, 0x6B64C2B0,
+      0x3B61B38C, 0x26D6A3E8, 0x000F9344, 0x1DB88320,
+      0xA005713C, 0xBDB26158, 0x9B6B51F4, 0x86DC4190,
+      0xD6D930AC, 0xCB6E20C8, 0xEDB71064, 0xF0000000
+    };
+    uint32_t crc = 0;
+    for(size_t n = 0; n < length; n++) {
+        crc = (crc >> 4) ^ crc_table[(crc ^ (data[n] >> 0)) & 0x0F];  /* lower nibble */
+        crc = (crc >> 4) ^ crc_table[(crc ^ (data[n] >> 4)) & 0x0F];  /* upper nibble */
+    }
+    return crc;
+}
+
+/*
+ * Lookup tables for slicing-by-8.
+ * table[0] is the classic byte table, table[k][i] is the CRC of byte i followed by k zero bytes.
+ */
+struct Crc32Tables {
+    uint32_t table[8][256];
+
+    Crc32Tables() {
+        for(uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for(int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+            }
+            table[0][i] = crc;
+        }
+        for(uint32_t i = 0; i < 256; i++) {
+            for(int k = 1; k < 8; k++) {
+                table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+static const Crc32Tables & getTables() {
+    // created on first use, thread safe since C++11
+    static const Crc32Tables tables;
+    return tables;
+}
+
+static inline uint32_t load32(const uint8_t *p) {
+    // byte wise composition is endian independent, the compiler merges it into one load
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+uint32_t Crc32Slice8(const uint8_t *data, size_t length) {
+    const uint32_t (*t)[256] = getTables().table;
+    uint32_t crc = 0xFFFFFFFF;
+
+    // 8 bytes per step: all table lookups of one step are independent of each other
+    while(length >= 8) {
+        uint32_t one = load32(data) ^ crc;
+        uint32_t two = load32(data + 4);
+        crc = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^ t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24] ^
+              t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^ t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+        data += 8;
+        length -= 8;
+    }
+    while(length-- > 0) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+    }
+    return ~crc;
+}
+
+#ifdef CRC32_HAVE_ARM
+__attribute__((target("+crc")))
+static uint32_t Crc32Arm(const uint8_t *data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    while(length >= 8) {
+        uint64_t value = (uint64_t) load32(data) | ((uint64_t) load32(data + 4) << 32);
+        crc = __crc32d(crc, value);
+        data += 8;
+        length -= 8;
+    }
+    while(length-- > 0) {
+        crc = __crc32b(crc, *data++);
+    }
+    return ~crc;
+}
+#endif
+
+typedef uint32_t (*Crc32Function)(const uint8_t *, size_t);
+
+struct Crc32Dispatch {
+    Crc32Function function;
+    const char *name;
+
+    Crc32Dispatch() : function(Crc32Slice8), name("slicing-by-8") {
+#ifdef CRC32_HAVE_ARM
+        if(getauxval(AT_HWCAP) & HWCAP_CRC32) {
+            function = Crc32Arm;
+            name = "armv8-crc32";
+        }
+#endif
+    }
+};
+
+static const Crc32Dispatch & getDispatch() {
+    static const Crc32Dispatch dispatch;
+    return dispatch;
+}
+
+uint32_t Crc32(const uint8_t *data, size_t length) {
+    return getDispatch().function(data, length);
+}
+
+const char * Crc32Implementation() {
+    return getDispatch().name;
+}
@@ -0,0 +1,25 @@
+#ifndef __CRC32_H_
+#define __CRC32_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * CRC32 of the RSCP frames.
+ * The RSCP checksum is the ethernet / zlib CRC32 (reflected polynomial 0xEDB88320, init and final xor 0xFFFFFFFF).
+ * Crc32() uses the fastest implementation available on this CPU, it is selected once on the first call:
+ *  - ARMv8 CRC32 instructions (same polynomial) if the CPU supports them
+ *  - slicing-by-8 with 8 lookup tables (8 bytes per step) otherwise
+ * The CRC32C instruction of SSE4.2 uses a different polynomial and can not be used for RSCP.
+ */
+
+uint32_t Crc32(const uint8_t *data, size_t length);
+
+// Name of the implementation selected by Crc32()
+const char * Crc32Implementation();
+
+// Single implementations, used for verification and benchmarks
+uint32_t Crc32Nibble(const uint8_t *data, size_t length);
+uint32_t Crc32Slice8(const uint8_t *data, size_t length);
+
+#endif // __CRC32_H_
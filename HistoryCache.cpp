@@ -0,0 +1,178 @@
+#include "HistoryCache.h"
+#include "Crc32.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+// modification time in ns, entries written within the same second keep their order
+static int64_t nowNanoseconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+HistoryCache::HistoryCache() : m_maxBytes(HISTORY_CACHE_DEFAULT_SIZE), m_bytes(0) {
+}
+
+HistoryCache::~HistoryCache() {
+}
+
+bool HistoryCache::open(const char *directory, uint64_t maxBytes) {
+    close();
+    if(mkdir(directory, 0755) != 0 && errno != EEXIST) {
+        return false;
+    }
+    DIR *dir = opendir(directory);
+    if(dir == NULL) {
+        return false;
+    }
+    m_directory = directory;
+    m_maxBytes = maxBytes;
+
+    // index of all entries: the key is part of the file name, size and last use come from stat()
+    struct dirent *entry;
+    while((entry = readdir(dir)) != NULL) {
+        HistoryCacheKey key;
+        unsigned long long start;
+        int end = 0;
+        if(sscanf(entry->d_name, "%08X_%llu_%u_%u.hist%n", &key.requestTag, &start, &key.interval, &key.span, &end) != 4 ||
+           entry->d_name[end] != '\0') {
+            continue;
+        }
+        key.start = start;
+        struct stat st;
+        if(stat(path(key).c_str(), &st) != 0) {
+            continue;
+        }
+        Entry & cached = m_entries[key];
+        cached.size = st.st_size;
+        cached.used = (int64_t) st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+        m_bytes += st.st_size;
+    }
+    closedir(dir);
+    evict();
+    return true;
+}
+
+void HistoryCache::close() {
+    m_directory.clear();
+    m_entries.clear();
+    m_bytes = 0;
+}
+
+std::string HistoryCache::path(const HistoryCacheKey & key) const {
+    char name[80];
+    snprintf(name, sizeof(name), "/%08X_%llu_%u_%u.hist", key.requestTag, (unsigned long long) key.start,
+             key.interval, key.span);
+    return m_directory + name;
+}
+
+void HistoryCache::remove(const HistoryCacheKey & key) {
+    std::map<HistoryCacheKey, Entry>::iterator it = m_entries.find(key);
+    if(it == m_entries.end()) {
+        return;
+    }
+    unlink(path(key).c_str());
+    m_bytes -= it->second.size;
+    m_entries.erase(it);
+}
+
+bool HistoryCache::load(const HistoryCacheKey & key, uint32_t *tag, uint8_t *dataType, std::vector<uint8_t> & data) {
+    if(!contains(key)) {
+        return false;
+    }
+    std::string file = path(key);
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if(fd < 0) {
+        remove(key);
+        return false;
+    }
+    HistoryCacheHeader header;
+    bool ok = read(fd, &header, sizeof(header)) == (ssize_t) sizeof(header) &&
+              memcmp(header.magic, HISTORY_CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+              header.version == HISTORY_CACHE_VERSION && header.requestTag == key.requestTag &&
+              header.start == key.start && header.interval == key.interval && header.span == key.span &&
+              header.length <= UINT16_MAX;
+    if(ok) {
+        data.resize(header.length);
+        ok = read(fd, data.data(), header.length) == (ssize_t) header.length && Crc32(data.data(), data.size()) == header.crc;
+    }
+    ::close(fd);
+    if(!ok) {
+        remove(key);
+        return false;
+    }
+    *tag = header.tag;
+    *dataType = (uint8_t) header.dataType;
+
+    // last use for the eviction order
+    utimensat(AT_FDCWD, file.c_str(), NULL, 0);
+    m_entries[key].used = nowNanoseconds();
+    return true;
+}
+
+bool HistoryCache::store(const HistoryCacheKey & key, uint32_t tag, uint8_t dataType, const uint8_t *data, uint16_t length) {
+    if(!isOpen()) {
+        return false;
+    }
+    HistoryCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HISTORY_CACHE_MAGIC, sizeof(header.magic));
+    header.version = HISTORY_CACHE_VERSION;
+    header.requestTag = key.requestTag;
+    header.start = key.start;
+    header.interval = key.interval;
+    header.span = key.span;
+    header.tag = tag;
+    header.dataType = dataType;
+    header.length = length;
+    header.crc = Crc32(data, length);
+
+    // temporary file and rename: a concurrent reader sees the old or the complete new file
+    std::string file = path(key);
+    std::string temp = file + ".tmp";
+    int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) {
+        return false;
+    }
+    bool ok = write(fd, &header, sizeof(header)) == (ssize_t) sizeof(header) &&
+              write(fd, data, length) == (ssize_t) length;
+    ok = (::close(fd) == 0) && ok;
+    if(!ok || rename(temp.c_str(), file.c_str()) != 0) {
+        unlink(temp.c_str());
+        return false;
+    }
+
+    Entry & cached = m_entries[key];
+    m_bytes -= cached.size;
+    cached.size = sizeof(header) + length;
+    cached.used = nowNanoseconds();
+    m_bytes += cached.size;
+    evict();
+    return true;
+}
+
+void HistoryCache::evict() {
+    if(m_bytes <= m_maxBytes) {
+        return;
+    }
+    // least recently used first
+    std::vector<std::pair<int64_t, HistoryCacheKey> > order;
+    order.reserve(m_entries.size());
+    for(std::map<HistoryCacheKey, Entry>::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+        order.push_back(std::make_pair(it->second.used, it->first));
+    }
+    std::sort(order.begin(), order.end(), [](const std::pair<int64_t, HistoryCacheKey> & a,
+                                             const std::pair<int64_t, HistoryCacheKey> & b) {
+        return a.first < b.first;
+    });
+    for(size_t i = 0; i < order.size() && m_bytes > m_maxBytes; i++) {
+        remove(order[i].second);
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef __HISTORY_CACHE_H_
+#define __HISTORY_CACHE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+ * On-disk cache of history responses (e3dcset -H ... with history_cache or --cache <dir>).
+ *
+ * The values of a completed day, week, month or year in the S10 database never change. The response to a
+ * TAG_DB_REQ_HISTORY_DATA_* request is therefore stored once and answered locally afterwards. The key are exactly
+ * the parameters of the request: request tag, TIME_START, TIME_INTERVAL and TIME_SPAN.
+ *
+ * Every response is one file <dir>/<TAG>_<start>_<interval>_<span>.hist:
+ *
+ *   HistoryCacheHeader   magic, key, tag/type/length of the response value, CRC32 of the data
+ *   data                 payload of the TAG_DB_HISTORY_DATA_* container as received from the S10
+ *
+ * Files are written to a temporary name and renamed, a reader never sees a partial file. The modification time is
+ * the time of the last use: a hit touches the file, when the cache grows above its size limit the files with the
+ * oldest modification time are removed first.
+ */
+
+#define HISTORY_CACHE_MAGIC "E3DCHIST"
+#define HISTORY_CACHE_VERSION 1
+#define HISTORY_CACHE_DEFAULT_SIZE (64 * 1024 * 1024)   // bytes
+
+struct HistoryCacheKey {
+    uint32_t requestTag;      // TAG_DB_REQ_HISTORY_DATA_DAY/WEEK/MONTH/YEAR
+    uint64_t start;           // TAG_DB_REQ_HISTORY_TIME_START
+    uint32_t interval;        // TAG_DB_REQ_HISTORY_TIME_INTERVAL
+    uint32_t span;            // TAG_DB_REQ_HISTORY_TIME_SPAN
+
+    bool operator<(const HistoryCacheKey & other) const {
+        if(requestTag != other.requestTag) return requestTag < other.requestTag;
+        if(start != other.start) return start < other.start;
+        if(interval != other.interval) return interval < other.interval;
+        return span < other.span;
+    }
+};
+
+struct HistoryCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t requestTag;
+    uint64_t start;
+    uint32_t interval;
+    uint32_t span;
+    uint32_t tag;             // tag of the response value
+    uint32_t dataType;        // RSCP data type of the response value (container)
+    uint32_t length;          // bytes of data following the header
+    uint32_t crc;             // Crc32() of the data
+};
+
+class HistoryCache {
+public:
+    HistoryCache();
+    virtual ~HistoryCache();
+
+    // directory is created if necessary, existing entries are indexed; maxBytes limits the sum of all files
+    bool open(const char *directory, uint64_t maxBytes = HISTORY_CACHE_DEFAULT_SIZE);
+    void close();
+    bool isOpen() const { return !m_directory.empty(); }
+
+    bool contains(const HistoryCacheKey & key) const { return m_entries.count(key) > 0; }
+    // reads a stored response; false (and the entry is dropped) if it is missing or damaged
+    bool load(const HistoryCacheKey & key, uint32_t *tag, uint8_t *dataType, std::vector<uint8_t> & data);
+    // stores a response and evicts the least recently used entries above the size limit
+    bool store(const HistoryCacheKey & key, uint32_t tag, uint8_t dataType, const uint8_t *data, uint16_t length);
+
+    size_t entries() const { return m_entries.size(); }
+    uint64_t bytes() const { return m_bytes; }
+
+private:
+    std::string path(const HistoryCacheKey & key) const;
+    void remove(const HistoryCacheKey & key);
+    void evict();
+
+    struct Entry {
+        uint64_t size;
+        int64_t used;         // modification time in ns, last use
+    };
+
+    std::string m_directory;
+    uint64_t m_maxBytes;
+    uint64_t m_bytes;
+    std::map<HistoryCacheKey, Entry> m_entries;
+};
+
+#endif // __HISTORY_CACHE_H_
@@ -0,0 +1,400 @@
+#include "OutputWriter.h"
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+#include <math.h>
+#include <charconv>
+
+// initial size of the buffer, enough for the output of most frames
+#define OUTPUT_BUFFER_RESERVE (64 * 1024)
+
+OutputWriter::OutputWriter() : m_format(OUTPUT_TEXT), m_file(stdout), m_begun(false), m_records(0), m_devices(false),
+                               m_sink(NULL) {
+}
+
+// pending output and the end of a json array are written at exit (also after exit())
+OutputWriter::~OutputWriter() {
+    end();
+}
+
+bool OutputWriter::parseFormat(const char *name, OutputFormat *format) {
+    if(strcmp(name, "text") == 0) {
+        *format = OUTPUT_TEXT;
+    } else if(strcmp(name, "json") == 0) {
+        *format = OUTPUT_JSON;
+    } else if(strcmp(name, "jsonl") == 0) {
+        *format = OUTPUT_JSONL;
+    } else if(strcmp(name, "csv") == 0) {
+        *format = OUTPUT_CSV;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void OutputWriter::begin(FILE *file, bool devices) {
+    m_file = file;
+    m_sink = NULL;
+    m_device.clear();
+    m_devices = devices;
+    m_buffer.clear();
+    m_buffer.reserve(OUTPUT_BUFFER_RESERVE);
+    m_records = 0;
+    m_begun = true;
+    if(m_format == OUTPUT_JSON) {
+        m_buffer += "[";
+    } else if(m_format == OUTPUT_CSV) {
+        m_buffer += devices ? "device,tag,name,type,value,unit,interpretation,bat,dcb,period\n" :
+                              "tag,name,type,value,unit,interpretation,bat,dcb,period\n";
+    }
+}
+
+void OutputWriter::beginDevice(OutputWriter *sink, const char *device) {
+    m_format = sink->m_format;
+    m_file = NULL;
+    m_sink = sink;
+    m_device = device;
+    m_devices = true;
+    m_buffer.clear();
+    m_buffer.reserve(OUTPUT_BUFFER_RESERVE);
+    m_records = 0;
+    m_begun = true;
+}
+
+void OutputWriter::end() {
+    if(!m_begun) {
+        return;
+    }
+    if(m_format == OUTPUT_JSON && m_sink == NULL) {
+        m_buffer += m_records > 0 ? "\n]\n" : "]\n";
+    }
+    flush();
+    m_begun = false;
+    m_sink = NULL;
+}
+
+void OutputWriter::append(const std::string & output, const std::string & device) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_format == OUTPUT_TEXT) {
+        for(size_t pos = 0; pos < output.size();) {
+            size_t end = output.find('\n', pos);
+            end = (end == std::string::npos) ? output.size() : end + 1;
+            m_buffer += '[';
+            m_buffer += device;
+            m_buffer += "] ";
+            m_buffer.append(output, pos, end - pos);
+            pos = end;
+        }
+    } else if(m_format == OUTPUT_JSON) {
+        // a device writer writes one record per line, here they become elements of the array
+        for(size_t pos = 0; pos < output.size();) {
+            size_t end = output.find('\n', pos);
+            if(end == std::string::npos) {
+                end = output.size();
+            }
+            if(end > pos) {
+                m_buffer += m_records > 0 ? ",\n  " : "\n  ";
+                m_buffer.append(output, pos, end - pos);
+                m_records++;
+            }
+            pos = end + 1;
+        }
+    } else {
+        m_buffer += output;
+    }
+    flush();
+}
+
+void OutputWriter::flush() {
+    if(m_sink != NULL) {
+        if(!m_buffer.empty()) {
+            m_sink->append(m_buffer, m_device);
+            m_buffer.clear();
+        }
+        return;
+    }
+    if(m_buffer.empty() || m_file == NULL) {
+        return;
+    }
+    // output written with stdio before (messages of the request side) stays in front
+    fflush(m_file);
+    int fd = fileno(m_file);
+    const char *data = m_buffer.data();
+    size_t remaining = m_buffer.size();
+    while(remaining > 0) {
+        ssize_t n = ::write(fd, data, remaining);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        }
+        if(n <= 0) {
+            break;      // closed pipe or socket: the output is dropped like with stdio
+        }
+        data += n;
+        remaining -= n;
+    }
+    m_buffer.clear();
+}
+
+size_t OutputWriter::formatInt(char *buffer, size_t size, int64_t value) {
+    std::to_chars_result result = std::to_chars(buffer, buffer + size - 1, value);
+    *result.ptr = '\0';
+    return result.ptr - buffer;
+}
+
+size_t OutputWriter::formatUInt(char *buffer, size_t size, uint64_t value) {
+    std::to_chars_result result = std::to_chars(buffer, buffer + size - 1, value);
+    *result.ptr = '\0';
+    return result.ptr - buffer;
+}
+
+size_t OutputWriter::formatFixed(char *buffer, size_t size, double value, int decimals) {
+    std::to_chars_result result = std::to_chars(buffer, buffer + size - 1, value, std::chars_format::fixed, decimals);
+    if(result.ec != std::errc()) {
+        // larger than the buffer (|value| > 1e300), not a value of the S10
+        return snprintf(buffer, size, "%.*e", decimals, value);
+    }
+    *result.ptr = '\0';
+    return result.ptr - buffer;
+}
+
+size_t OutputWriter::formatGeneral(char *buffer, size_t size, double value, int precision) {
+    std::to_chars_result result = std::to_chars(buffer, buffer + size - 1, value, std::chars_format::general, precision);
+    *result.ptr = '\0';
+    return result.ptr - buffer;
+}
+
+void OutputWriter::writeInt(int64_t value) {
+    if(m_format != OUTPUT_TEXT) {
+        return;
+    }
+    appendInt(value);
+}
+
+void OutputWriter::writeUInt(uint64_t value) {
+    if(m_format != OUTPUT_TEXT) {
+        return;
+    }
+    char number[24];
+    m_buffer.append(number, formatUInt(number, sizeof(number), value));
+}
+
+void OutputWriter::writeFixed(double value, int decimals) {
+    if(m_format != OUTPUT_TEXT) {
+        return;
+    }
+    char number[64];
+    m_buffer.append(number, formatFixed(number, sizeof(number), value, decimals));
+}
+
+void OutputWriter::print(const char *format, ...) {
+    if(m_format != OUTPUT_TEXT) {
+        return;
+    }
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if(n < 0) {
+        return;
+    }
+    if((size_t) n < sizeof(line)) {
+        m_buffer.append(line, n);
+        return;
+    }
+    // longer than a line: format again directly into the buffer
+    size_t length = m_buffer.size();
+    m_buffer.resize(length + n);
+    va_start(args, format);
+    vsnprintf(&m_buffer[length], n + 1, format, args);
+    va_end(args);
+}
+
+void OutputWriter::appendJsonString(const char *text, size_t length) {
+    m_buffer += '"';
+    for(size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char) text[i];
+        switch(c) {
+            case '"':  m_buffer += "\\\""; break;
+            case '\\': m_buffer += "\\\\"; break;
+            case '\n': m_buffer += "\\n"; break;
+            case '\r': m_buffer += "\\r"; break;
+            case '\t': m_buffer += "\\t"; break;
+            default:
+                if(c < 0x20) {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    m_buffer += escaped;
+                } else {
+                    m_buffer += (char) c;
+                }
+                break;
+        }
+    }
+    m_buffer += '"';
+}
+
+// RFC 4180: fields with separator, quote or line break are quoted, quotes are doubled
+void OutputWriter::appendCsvField(const char *text, size_t length) {
+    bool quote = false;
+    for(size_t i = 0; i < length && !quote; i++) {
+        quote = text[i] == ',' || text[i] == '"' || text[i] == '\r' || text[i] == '\n';
+    }
+    if(!quote) {
+        m_buffer.append(text, length);
+        return;
+    }
+    m_buffer += '"';
+    for(size_t i = 0; i < length; i++) {
+        if(text[i] == '"') {
+            m_buffer += '"';
+        }
+        m_buffer += text[i];
+    }
+    m_buffer += '"';
+}
+
+void OutputWriter::appendValue(const OutputRecord & record, bool json) {
+    char number[40];
+    switch(record.kind) {
+        case OUTPUT_VALUE_NULL:
+            if(json) {
+                m_buffer += "null";
+            }
+            return;
+        case OUTPUT_VALUE_BOOL:
+            m_buffer += record.boolean ? "true" : "false";
+            return;
+        case OUTPUT_VALUE_INT:
+            m_buffer.append(number, formatInt(number, sizeof(number), record.integer));
+            return;
+        case OUTPUT_VALUE_UINT:
+            m_buffer.append(number, formatUInt(number, sizeof(number), record.unsignedInteger));
+            return;
+        case OUTPUT_VALUE_FLOAT:
+            // JSON has no NaN/Infinity
+            if(!isfinite(record.number)) {
+                if(json) {
+                    m_buffer += "null";
+                }
+                return;
+            }
+            m_buffer.append(number, formatGeneral(number, sizeof(number), record.number, record.precision));
+            return;
+        case OUTPUT_VALUE_STRING:
+            if(json) {
+                appendJsonString(record.text, record.textLength);
+            } else {
+                appendCsvField(record.text, record.textLength);
+            }
+            return;
+    }
+}
+
+void OutputWriter::appendInt(int64_t value) {
+    char number[24];
+    m_buffer.append(number, formatInt(number, sizeof(number), value));
+}
+
+void OutputWriter::record(const OutputRecord & record) {
+    static const char hex[] = "0123456789ABCDEF";
+    char tag[11] = "0x";
+    for(int i = 0; i < 8; i++) {
+        tag[2 + i] = hex[(record.tag >> (28 - 4 * i)) & 0xF];
+    }
+    tag[10] = '\0';
+
+    if(m_format == OUTPUT_CSV) {
+        if(m_devices) {
+            appendCsvField(m_device.data(), m_device.size());
+            m_buffer += ',';
+        }
+        m_buffer += tag;
+        m_buffer += ',';
+        if(record.name) {
+            appendCsvField(record.name, strlen(record.name));
+        }
+        m_buffer += ',';
+        m_buffer += record.type;
+        m_buffer += ',';
+        appendValue(record, false);
+        m_buffer += ',';
+        if(record.unit) {
+            appendCsvField(record.unit, strlen(record.unit));
+        }
+        m_buffer += ',';
+        if(record.interpretation) {
+            appendCsvField(record.interpretation, strlen(record.interpretation));
+        }
+        m_buffer += ',';
+        if(record.bat >= 0) {
+            appendInt(record.bat);
+        }
+        m_buffer += ',';
+        if(record.dcb >= 0) {
+            appendInt(record.dcb);
+        }
+        m_buffer += ',';
+        if(record.period) {
+            m_buffer += record.period;
+        }
+        m_buffer += '\n';
+        m_records++;
+        return;
+    }
+
+    // the records of a device writer are elements of the array of the shared writer, one per line
+    bool array = (m_format == OUTPUT_JSON && m_sink == NULL);
+    if(array) {
+        m_buffer += m_records > 0 ? ",\n  " : "\n  ";
+    }
+    m_buffer += '{';
+    if(m_devices) {
+        m_buffer += "\"device\":";
+        appendJsonString(m_device.data(), m_device.size());
+        m_buffer += ',';
+    }
+    m_buffer += "\"tag\":\"";
+    m_buffer += tag;
+    m_buffer += "\",\"name\":";
+    if(record.name) {
+        appendJsonString(record.name, strlen(record.name));
+    } else {
+        m_buffer += "null";
+    }
+    m_buffer += ",\"type\":\"";
+    m_buffer += record.type;
+    m_buffer += "\",\"value\":";
+    appendValue(record, true);
+    m_buffer += ",\"unit\":";
+    if(record.unit) {
+        appendJsonString(record.unit, strlen(record.unit));
+    } else {
+        m_buffer += "null";
+    }
+    m_buffer += ",\"interpretation\":";
+    if(record.interpretation) {
+        appendJsonString(record.interpretation, strlen(record.interpretation));
+    } else {
+        m_buffer += "null";
+    }
+    if(record.bat >= 0) {
+        m_buffer += ",\"bat\":";
+        appendInt(record.bat);
+    }
+    if(record.dcb >= 0) {
+        m_buffer += ",\"dcb\":";
+        appendInt(record.dcb);
+    }
+    if(record.period) {
+        m_buffer += ",\"period\":\"";
+        m_buffer += record.period;
+        m_buffer += '"';
+    }
+    m_buffer += '}';
+    if(!array) {
+        m_buffer += '\n';
+    }
+    m_records++;
+}
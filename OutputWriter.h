@@ -0,0 +1,141 @@
+#ifndef __OUTPUT_WRITER_H_
+#define __OUTPUT_WRITER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string>
+#include <mutex>
+
+/*
+ * Output sink of the response handlers of e3dcset.
+ *
+ * All output of a frame is appended to one buffer and written with a single write() when the frame is processed
+ * (flush()), independent of the buffering of stdout (line buffered on a terminal). The buffer grows to the largest
+ * frame output once and is reused, numbers are formatted with std::to_chars without locale and allocation.
+ *
+ * Text output (default) uses write(), the write*() number functions and print() for the remaining printf formats.
+ * The sink decides the output: with a machine readable format the text functions write nothing, so the handlers
+ * call them unconditionally.
+ *
+ * Machine readable output (--format json|jsonl|csv): every value of a response becomes one record with the same fields in all formats:
+ *
+ *   tag             "0x01800001", hex of the response tag
+ *   name            tag name from e3dcset.tags, null if unknown
+ *   type            RSCP data type ("Int32", "Float32", ...)
+ *   value           number, bool or string
+ *   unit            unit taken from the tag description ("W", "V", "%", ...), null if unknown
+ *   interpretation  interpretation of the value from e3dcset.tags (or the formatted time of timestamps)
+ *   bat, dcb        battery module and cell block of BAT_* values, period for history sums
+ *   device          name of the device in fleet mode (--fleet)
+ *
+ *   json    one array of objects for the whole invocation
+ *   jsonl   one object per line
+ *   csv     header line, then one line per record
+ *
+ * Records are appended to one buffer which is written with a single fwrite() per frame (flush()).
+ *
+ * Fleet mode (--fleet): every device session has its own writer (beginDevice()), flush() hands the output of a frame
+ * to the shared writer of the process, which writes it with one write() under its lock. Text lines get the prefix
+ * "[device] ", records a "device" field (first CSV column); frames of different devices never mix within a line.
+ */
+
+enum OutputFormat {
+    OUTPUT_TEXT,      // human readable text of the handlers, records are not used
+    OUTPUT_JSON,
+    OUTPUT_JSONL,
+    OUTPUT_CSV
+};
+
+enum OutputValueKind {
+    OUTPUT_VALUE_NULL,
+    OUTPUT_VALUE_BOOL,
+    OUTPUT_VALUE_INT,
+    OUTPUT_VALUE_UINT,
+    OUTPUT_VALUE_FLOAT,
+    OUTPUT_VALUE_STRING
+};
+
+struct OutputRecord {
+    uint32_t tag;
+    const char *name;             // NULL = unknown
+    const char *type;
+    OutputValueKind kind;
+    union {
+        bool boolean;
+        int64_t integer;
+        uint64_t unsignedInteger;
+        double number;
+    };
+    int precision;                // significant digits of OUTPUT_VALUE_FLOAT (7 for Float32, 17 for Double64)
+    const char *text;             // OUTPUT_VALUE_STRING
+    size_t textLength;
+    const char *unit;             // NULL = unknown
+    const char *interpretation;   // NULL = none
+    int bat;                      // -1 = not a battery value
+    int dcb;                      // -1 = not a cell block value
+    const char *period;           // NULL = not a history value
+
+    OutputRecord() : tag(0), name(NULL), type(""), kind(OUTPUT_VALUE_NULL), unsignedInteger(0), precision(7),
+                     text(NULL), textLength(0), unit(NULL), interpretation(NULL), bat(-1), dcb(-1), period(NULL) {}
+};
+
+class OutputWriter {
+public:
+    OutputWriter();
+    virtual ~OutputWriter();
+
+    // false for an unknown format name ("text", "json", "jsonl", "csv")
+    static bool parseFormat(const char *name, OutputFormat *format);
+
+    void setFormat(OutputFormat format) { m_format = format; }
+    OutputFormat format() const { return m_format; }
+    bool structured() const { return m_format != OUTPUT_TEXT; }
+
+    // start and end of one invocation (json array brackets, csv header); \var devices adds the device column
+    void begin(FILE *file, bool devices = false);
+    // output of one device session, written through \var sink (same format) by flush()
+    void beginDevice(OutputWriter *sink, const char *device);
+    void end();
+    // name of the device of a device writer (beginDevice()), empty otherwise
+    const std::string & device() const { return m_device; }
+
+    void record(const OutputRecord & record);
+    // writes the buffered output with one write(), called once per processed frame
+    void flush();
+
+    // text output
+    void write(const char *text) { if(m_format == OUTPUT_TEXT) m_buffer.append(text); }
+    void write(const char *text, size_t length) { if(m_format == OUTPUT_TEXT) m_buffer.append(text, length); }
+    void write(char c) { if(m_format == OUTPUT_TEXT) m_buffer += c; }
+    void writeInt(int64_t value);
+    void writeUInt(uint64_t value);
+    void writeFixed(double value, int decimals);        // like printf("%.<decimals>f")
+    void print(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    // number formatting into \var buffer (terminated), returns the length
+    static size_t formatInt(char *buffer, size_t size, int64_t value);
+    static size_t formatUInt(char *buffer, size_t size, uint64_t value);
+    static size_t formatFixed(char *buffer, size_t size, double value, int decimals);
+    static size_t formatGeneral(char *buffer, size_t size, double value, int precision);    // like printf("%.<precision>g")
+
+private:
+    void appendJsonString(const char *text, size_t length);
+    void appendCsvField(const char *text, size_t length);
+    void appendValue(const OutputRecord & record, bool json);
+    void appendInt(int64_t value);
+    // output of a device writer: prefixed lines or records, written under m_mutex
+    void append(const std::string & output, const std::string & device);
+
+    OutputFormat m_format;
+    FILE *m_file;
+    std::string m_buffer;
+    bool m_begun;
+    size_t m_records;
+    bool m_devices;           // device column in the csv header
+    OutputWriter *m_sink;     // shared writer of a device writer, NULL otherwise
+    std::string m_device;
+    std::mutex m_mutex;
+};
+
+#endif // __OUTPUT_WRITER_H_
@@ -11,6 +11,7 @@
 #include <windows.h>
 #endif
 #include "RscpProtocol.h"
+#include "Crc32.h"
 
 
 RscpProtocol::RscpProtocol() {
@@ -52,19 +53,9 @@ bool RscpProtocol::setHeaderTimestamp(SRscpFrame *frame) {
 	return bTimeSet;
 }
 
-uint32_t RscpProtocol::calculateCRC32(const uint8_t *data, uint16_t length) {
-    static const uint32_t crc_table[] = {
-      0x4DBDF21C, 0x500AE278, 0x76D3D2D4, 0x6B64C2B0,
-      0x3B61B38C, 0x26D6A3E8, 0x000F9344, 0x1DB88320,
-      0xA005713C, 0xBDB26158, 0x9B6B51F4, 0x86DC4190,
-      0xD6D930AC, 0xCB6E20C8, 0xEDB71064, 0xF0000000
-    };
-	uint32_t crc = 0;
-    for(uint32_t n = 0; n < length; n++) {
-        crc = (crc >> 4) ^ crc_table[(crc ^ (data[n] >> 0)) & 0x0F];  /* lower nibble */
-        crc = (crc >> 4) ^ crc_table[(crc ^ (data[n] >> 4)) & 0x0F];  /* upper nibble */
-	}
-	return crc;
+uint32_t RscpProtocol::calculateCRC32(const uint8_t *data, uint32_t length) {
+	// table driven CRC32, see Crc32.h (the former nibble implementation is kept as Crc32Nibble)
+	return Crc32(data, length);
 }
 
 int32_t RscpProtocol::getFrameLength(const uint8_t * data, const uint32_t & length) {
@@ -388,6 +379,33 @@ int32_t RscpProtocol::parseData(const uint8_t* data, const uint32_t & length, st
 	return uiPos;
 }
 
+int32_t RscpProtocol::parseFrameView(const uint8_t* data, const uint32_t & length, RscpValueRange* values) {
+	// sanity check
+	if((data == NULL) || (values == NULL)) {
+		return RSCP::ERR_INVALID_INPUT;
+	}
+	// validates header size, magic and version
+	int32_t frameLength = getFrameLength(data, length);
+	if(frameLength < 0) {
+		return frameLength;
+	}
+	if((uint32_t)frameLength > length) {
+		return RSCP::ERR_INVALID_FRAME_LENGTH;
+	}
+	const SRscpFrameHeader *header = reinterpret_cast<const SRscpFrameHeader *>(data);
+	// check that CRC matches before handing out any value
+	if(header->ctrl.bits.crc != 0) {
+		uint32_t calcCRC32 = calculateCRC32(data, frameLength - sizeof(uint32_t));
+		uint32_t frameCRC32;
+		memcpy(&frameCRC32, data + frameLength - sizeof(uint32_t), sizeof(uint32_t));
+		if(frameCRC32 != calcCRC32) {
+			return RSCP::ERR_INVALID_CRC;
+		}
+	}
+	*values = RscpValueRange(data + sizeof(SRscpFrameHeader), header->dataLength);
+	return frameLength;
+}
+
 std::string RscpProtocol::getValueAsString(const SRscpValue* value) {
 	// sanity check
 	std::string strValue;
@@ -614,3 +632,127 @@ int32_t RscpProtocol::destroyFrameData(SRscpFrameBuffer * frameBuffer) {
 	}
 	return RSCP::OK;
 }
+
+RscpFrameBuilder::RscpFrameBuilder(size_t capacity) : m_buffer(NULL), m_capacity(0), m_length(sizeof(SRscpFrameHeader)), m_error(RSCP::OK) {
+	reserve(capacity);
+}
+
+RscpFrameBuilder::~RscpFrameBuilder() {
+	free(m_buffer);
+}
+
+void RscpFrameBuilder::reset() {
+	m_length = sizeof(SRscpFrameHeader);
+	m_openContainers.clear();
+	m_error = RSCP::OK;
+}
+
+bool RscpFrameBuilder::reserve(size_t size) {
+	if(size <= m_capacity) {
+		return true;
+	}
+	// grow geometrically to keep the amount of reallocations low
+	size_t newCapacity = (m_capacity > 0) ? m_capacity : 64;
+	while(newCapacity < size) {
+		newCapacity *= 2;
+	}
+	uint8_t *ucTmp = (uint8_t *) realloc(m_buffer, newCapacity);
+	if(ucTmp == NULL) {
+		m_error = RSCP::ERR_NO_MEMORY;
+		return false;
+	}
+	m_buffer = ucTmp;
+	m_capacity = newCapacity;
+	return true;
+}
+
+int32_t RscpFrameBuilder::appendValue(const SRscpTag & tag, const uint8_t * data, const uint16_t & dataLength, const uint8_t & dataType) {
+	if(m_error != RSCP::OK) {
+		return m_error;
+	}
+	if((dataLength > 0) && (data == NULL)) {
+		return RSCP::ERR_INVALID_INPUT;
+	}
+	// keep space for the CRC to avoid a reallocation in finish()
+	if(!reserve(m_length + RSCP_VALUE_HEADER_LENGTH + dataLength + sizeof(uint32_t))) {
+		return m_error;
+	}
+	uint8_t *ptr = m_buffer + m_length;
+	memcpy(ptr, &tag, sizeof(tag));
+	ptr[sizeof(SRscpTag)] = dataType;
+	memcpy(ptr + sizeof(SRscpTag) + sizeof(uint8_t), &dataLength, sizeof(dataLength));
+	if(dataLength > 0) {
+		memcpy(ptr + RSCP_VALUE_HEADER_LENGTH, data, dataLength);
+	}
+	m_length += RSCP_VALUE_HEADER_LENGTH + dataLength;
+	return RSCP::OK;
+}
+
+int32_t RscpFrameBuilder::beginContainer(const SRscpTag & tag) {
+	size_t offset = m_length;
+	int32_t iResult = appendValue(tag, NULL, 0, RSCP::eTypeContainer);
+	if(iResult == RSCP::OK) {
+		m_openContainers.push_back(offset);
+	}
+	return iResult;
+}
+
+int32_t RscpFrameBuilder::endContainer() {
+	if(m_openContainers.empty()) {
+		return RSCP::ERR_INVALID_INPUT;
+	}
+	size_t offset = m_openContainers.back();
+	m_openContainers.pop_back();
+	// back-patch the length of the container value
+	size_t containerLength = m_length - offset - RSCP_VALUE_HEADER_LENGTH;
+	if(containerLength > 0xFFFF) {
+		m_error = RSCP::ERR_DATA_LIMIT_EXCEEDED;
+		return m_error;
+	}
+	uint16_t length = (uint16_t) containerLength;
+	memcpy(m_buffer + offset + sizeof(SRscpTag) + sizeof(uint8_t), &length, sizeof(length));
+	return RSCP::OK;
+}
+
+int32_t RscpFrameBuilder::finish(SRscpFrameBuffer * frameBuffer, bool calcCRC) {
+	if(frameBuffer == NULL) {
+		return RSCP::ERR_INVALID_INPUT;
+	}
+	if(m_error != RSCP::OK) {
+		return m_error;
+	}
+	if(!m_openContainers.empty()) {
+		return RSCP::ERR_INVALID_INPUT;
+	}
+	size_t dataLength = m_length - sizeof(SRscpFrameHeader);
+	if(dataLength > 0xFFFF) {
+		return RSCP::ERR_DATA_LIMIT_EXCEEDED;
+	}
+	if(!reserve(m_length + sizeof(uint32_t))) {
+		return m_error;
+	}
+
+	// write the header in front of the values
+	memset(m_buffer, 0, sizeof(SRscpFrameHeader));
+	SRscpFrame* tmpFrame = reinterpret_cast<SRscpFrame*>(m_buffer);
+	tmpFrame->header.magic = RSCP::MAGIC;
+	tmpFrame->header.ctrl.bits.crc = calcCRC;
+	tmpFrame->header.ctrl.bits.version = RSCP::VERSION;
+	tmpFrame->header.dataLength = (uint16_t) dataLength;
+	RscpProtocol protocol;
+	protocol.setHeaderTimestamp(tmpFrame);
+
+	if(calcCRC) {
+		uint32_t uCRC32 = protocol.calculateCRC32(m_buffer, m_length);
+		memcpy(m_buffer + m_length, &uCRC32, sizeof(uCRC32));
+		m_length += sizeof(uCRC32);
+	}
+
+	// hand the buffer over, it is freed with RscpProtocol::destroyFrameData()
+	frameBuffer->data = m_buffer;
+	frameBuffer->dataLength = m_length;
+	m_buffer = NULL;
+	m_capacity = 0;
+	reset();
+	return RSCP::OK;
+}
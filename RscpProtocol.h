@@ -13,6 +13,105 @@
 #include <string.h>
 #include "RscpTypes.h"
 
+/*
+ * Forward iterator over the RSCP values that are stored in line inside a raw data buffer.
+ * No memory is allocated, every value is returned as SRscpValueView pointing into the buffer.
+ * Iteration stops at the first value that does not fit into the buffer.
+ */
+class RscpValueIterator {
+public:
+	RscpValueIterator() : m_data(NULL), m_length(0), m_pos(0) {
+		memset(&m_value, 0, sizeof(m_value));
+	}
+	RscpValueIterator(const uint8_t * data, uint32_t length) : m_data(data), m_length(length), m_pos(0) {
+		load();
+	}
+	const SRscpValueView & operator*() const {
+		return m_value;
+	}
+	const SRscpValueView * operator->() const {
+		return &m_value;
+	}
+	RscpValueIterator & operator++() {
+		m_pos += RSCP_VALUE_HEADER_LENGTH + m_value.length;
+		load();
+		return *this;
+	}
+	// iterators are equal at the same value of the same buffer, all finished iterators equal end()
+	bool operator==(const RscpValueIterator & other) const {
+		return current() == other.current();
+	}
+	bool operator!=(const RscpValueIterator & other) const {
+		return current() != other.current();
+	}
+	/*
+	 * \brief Amount of bytes in front of the current value (equals the consumed bytes when the iteration is done).
+	 */
+	uint32_t position() const {
+		return m_pos;
+	}
+private:
+	// start of the current value, NULL when the iteration is done (m_pos stays valid for position())
+	const uint8_t * current() const {
+		return (m_data != NULL) ? m_data + m_pos : NULL;
+	}
+	void load() {
+		if((m_data == NULL) || (m_pos + RSCP_VALUE_HEADER_LENGTH > m_length)) {
+			m_data = NULL;
+			return;
+		}
+		const uint8_t * ptr = m_data + m_pos;
+		memcpy(&m_value.tag, ptr, sizeof(m_value.tag));
+		m_value.dataType = ptr[sizeof(SRscpTag)];
+		memcpy(&m_value.length, ptr + sizeof(SRscpTag) + sizeof(uint8_t), sizeof(m_value.length));
+		if(m_pos + RSCP_VALUE_HEADER_LENGTH + m_value.length > m_length) {
+			m_data = NULL;
+			return;
+		}
+		m_value.data = (m_value.length > 0) ? ptr + RSCP_VALUE_HEADER_LENGTH : NULL;
+	}
+	const uint8_t * m_data;
+	uint32_t m_length;
+	uint32_t m_pos;
+	SRscpValueView m_value;
+};
+
+/*
+ * Range of RSCP values inside a raw data buffer (frame payload or container content) for use in range based for loops.
+ */
+class RscpValueRange {
+public:
+	RscpValueRange() : m_data(NULL), m_length(0) {
+	}
+	RscpValueRange(const uint8_t * data, uint32_t length) : m_data(data), m_length(length) {
+	}
+	RscpValueIterator begin() const {
+		return RscpValueIterator(m_data, m_length);
+	}
+	RscpValueIterator end() const {
+		return RscpValueIterator();
+	}
+	bool empty() const {
+		return !(begin() != end());
+	}
+	/*
+	 * \brief Find the first value with \var tag on this level (no descent into containers).
+	 * @return True if found and \var value was set.
+	 */
+	bool find(const SRscpTag & tag, SRscpValueView * value) const {
+		for(RscpValueIterator it = begin(); it != end(); ++it) {
+			if(it->tag == tag) {
+				*value = *it;
+				return true;
+			}
+		}
+		return false;
+	}
+private:
+	const uint8_t * m_data;
+	uint32_t m_length;
+};
+
 class RscpProtocol {
 public:
     /*
@@ -111,6 +210,16 @@ public:
      * @return			- RSCP error code if the function fails or processed amount of bytes on success
      */
     int32_t parseData(const uint8_t* data, const uint32_t & length, std::vector<SRscpValue> & frameData);
+    /*
+     * \brief Function to validate the raw frame in \var data of length \var length (magic, version, length and CRC)
+     * 		  and to return a non-owning range over its values. Nothing is allocated or copied,
+     * 		  the range is valid as long as \var data is valid.
+     * @param data		- Pointer to the raw data frame buffer
+     * @param length	- Length of data in bytes
+     * @param values	- Range over the top level values of the frame (should be != NULL)
+     * @return			- RSCP error code if the function fails or processed amount of bytes on success
+     */
+    int32_t parseFrameView(const uint8_t* data, const uint32_t & length, RscpValueRange* values);
 	/*
 	 * \biref This function allocates memory of size \var size. If data is already allocated it will reallocate the requested size.
 	 * @param value  - Pointer to the RSCP value struct.
@@ -491,6 +600,93 @@ public:
     	parseData(value->data, value->length, dataValues);
     	return dataValues;
     }
+    /*
+     * \brief Function get \var value as a non-owning range over the values of the container.
+     * 		  Nested containers are only parsed when they are iterated (lazy descent), nothing is allocated.
+     * @param value - RSCP value struct or view
+     * @return      - Range over the container values. Empty on no or invalid data.
+     */
+    RscpValueRange getValueAsContainerView(const SRscpValue* value) {
+    	return RscpValueRange(value->data, value->length);
+    }
+	/*!
+	 * \copydoc RscpProtocol::getValueAsContainerView(const SRscpValue* value)
+	 */
+    RscpValueRange getValueAsContainerView(const SRscpValueView* value) {
+    	return RscpValueRange(value->data, value->length);
+    }
+    /*
+     * \brief Function to use a value view with the functions of the owning API (e.g. getValueAsInt32()).
+     * 		  The returned struct points into the frame buffer of the view and must NOT be destroyed with destroyValueData().
+     * @param value - RSCP value view
+     * @return      - RSCP value struct sharing the data of the view
+     */
+    SRscpValue getValueFromView(const SRscpValueView & value) {
+    	SRscpValue tmp;
+    	tmp.tag = value.tag;
+    	tmp.dataType = value.dataType;
+    	tmp.length = value.length;
+    	tmp.data = const_cast<uint8_t *>(value.data);
+    	return tmp;
+    }
+    /*
+     * \brief Get a value from the RSCP value view \var value as a defined return data type.
+     * @param value - The pointer to a RSCP value view.
+     * @return		- The value in the requested data type.
+     */
+    template <class cType>
+    cType getValue(const SRscpValueView* value) {
+    	SRscpValue tmp = getValueFromView(*value);
+    	return getValue<cType>(&tmp);
+    }
+	/*!
+	 * \copydoc RscpProtocol::getValue(const SRscpValueView* value)
+	 */
+    bool getValueAsBool(const SRscpValueView* value) {
+    	return getValue<bool>(value);
+    }
+	/*!
+	 * \copydoc RscpProtocol::getValue(const SRscpValueView* value)
+	 */
+    uint8_t getValueAsUChar8(const SRscpValueView* value) {
+    	return getValue<uint8_t>(value);
+    }
+	/*!
+	 * \copydoc RscpProtocol::getValue(const SRscpValueView* value)
+	 */
+    int32_t getValueAsInt32(const SRscpValueView* value) {
+    	return getValue<int32_t>(value);
+    }
+	/*!
+	 * \copydoc RscpProtocol::getValue(const SRscpValueView* value)
+	 */
+    uint32_t getValueAsUInt32(const SRscpValueView* value) {
+    	return getValue<uint32_t>(value);
+    }
+	/*!
+	 * \copydoc RscpProtocol::getValue(const SRscpValueView* value)
+	 */
+    uint64_t getValueAsUInt64(const SRscpValueView* value) {
+    	return getValue<uint64_t>(value);
+    }
+	/*!
+	 * \copydoc RscpProtocol::getValue(const SRscpValueView* value)
+	 */
+    float getValueAsFloat32(const SRscpValueView* value) {
+    	return getValue<float>(value);
+    }
+	/*!
+	 * \copydoc RscpProtocol::getValue(const SRscpValueView* value)
+	 */
+    double getValueAsDouble64(const SRscpValueView* value) {
+    	return getValue<double>(value);
+    }
+	/*!
+	 * \copydoc RscpProtocol::getValue(const SRscpValueView* value)
+	 */
+    std::string getValueAsString(const SRscpValueView* value) {
+    	return std::string((const char *)value->data, (value->data != NULL) ? value->length : 0);
+    }
     /*
      * \brief This function destroys all allocated data inside a RSCP value.
      * @param  - Pointer to the RSCP value.
@@ -537,13 +733,14 @@ public:
     	return destroyFrameData(&frameBuffer);
     }
 private:
+    friend class RscpFrameBuilder;
     /*
      * \brief This function calculates the ethernet protocol CRC32 hash from \var data over \var length bytes.
      * @param - Pointer to a data buffer
      * @param - Length of the buffer data
      * @return The calculated CRC32 value is returned.
      */
-    uint32_t calculateCRC32(const uint8_t *data, uint16_t length);
+    uint32_t calculateCRC32(const uint8_t *data, uint32_t length);
     /*
      * \brief This function sets the current time in seconds and nanoseconds to the frame.
      * @param - Pointer to an rscp frame object.
@@ -552,4 +749,107 @@ private:
     bool setHeaderTimestamp(SRscpFrame *frame);
 };
 
+/*
+ * Builder to create a complete RSCP frame in one buffer.
+ * Values are written in place directly behind the frame header, nested containers are opened with beginContainer()
+ * and their length is back-patched by endContainer(). The buffer grows geometrically, so a frame normally costs
+ * one allocation and no intermediate copies. finish() hands the buffer over to an SRscpFrameBuffer
+ * which is freed with RscpProtocol::destroyFrameData() as usual.
+ */
+class RscpFrameBuilder {
+public:
+	/*
+	 * @param capacity - Initial buffer size in bytes (header and CRC included).
+	 */
+	RscpFrameBuilder(size_t capacity = 256);
+	virtual ~RscpFrameBuilder();
+	/*
+	 * \brief Discard all values and start a new frame. The buffer is kept for reuse.
+	 */
+	void reset();
+	/*
+	 * \brief Open a new container \var tag. All following values are written into this container until endContainer().
+	 * @return - RSCP error code if the function fails else RSCP::OK
+	 */
+	int32_t beginContainer(const SRscpTag & tag);
+	/*
+	 * \brief Close the innermost open container and write its length.
+	 * @return - RSCP error code if the function fails (no open container, container too big) else RSCP::OK
+	 */
+	int32_t endContainer();
+	/*
+	 * \brief Append a value of data type \var dataType to the current container (or the frame itself).
+	 * @return - RSCP error code if the function fails else RSCP::OK
+	 */
+	int32_t appendValue(const SRscpTag & tag, const uint8_t * data, const uint16_t & dataLength, const uint8_t & dataType);
+	/*
+	 * \brief Append a value without data (e.g. a request tag).
+	 */
+	int32_t appendValue(const SRscpTag & tag) {
+		return appendValue(tag, NULL, 0, RSCP::eTypeNone);
+	}
+	/*!
+	 * \copydoc RscpFrameBuilder::appendValue(const SRscpTag & tag, const uint8_t * data, const uint16_t & dataLength, const uint8_t & dataType)
+	 */
+	int32_t appendValue(const SRscpTag & tag, const bool & value) {
+		return appendValue(tag, (const uint8_t *) &value, sizeof(value), RSCP::eTypeBool);
+	}
+	int32_t appendValue(const SRscpTag & tag, const char & value) {
+		return appendValue(tag, (const uint8_t *) &value, sizeof(value), RSCP::eTypeChar8);
+	}
+	int32_t appendValue(const SRscpTag & tag, const int8_t & value) {
+		return appendValue(tag, (const uint8_t *) &value, sizeof(value), RSCP::eTypeChar8);
+	}
+	int32_t appendValue(const SRscpTag & tag, const uint8_t & value) {
+		return appendValue(tag, (const uint8_t *) &value, sizeof(value), RSCP::eTypeUChar8);
+	}
+	int32_t appendValue(const SRscpTag & tag, const int16_t & value) {
+		return appendValue(tag, (const uint8_t *) &value, sizeof(value), RSCP::eTypeInt16);
+	}
+	int32_t appendValue(const SRscpTag & tag, const uint16_t & value) {
+		return appendValue(tag, (const uint8_t *) &value, sizeof(value), RSCP::eTypeUInt16);
+	}
+	int32_t appendValue(const SRscpTag & tag, const int32_t & value) {
+		return appendValue(tag, (const uint8_t *) &value, sizeof(value), RSCP::eTypeInt32);
+	}
+	int32_t appendValue(const SRscpTag & tag, const uint32_t & value) {
+		return appendValue(tag, (const uint8_t *) &value, sizeof(value), RSCP::eTypeUInt32);
+	}
+	int32_t appendValue(const SRscpTag & tag, const int64_t & value) {
+		return appendValue(tag, (const uint8_t *) &value, sizeof(value), RSCP::eTypeInt64);
+	}
+	int32_t appendValue(const SRscpTag & tag, const uint64_t & value) {
+		return appendValue(tag, (const uint8_t *) &value, sizeof(value), RSCP::eTypeUInt64);
+	}
+	int32_t appendValue(const SRscpTag & tag, const float & value) {
+		return appendValue(tag, (const uint8_t *) &value, sizeof(value), RSCP::eTypeFloat32);
+	}
+	int32_t appendValue(const SRscpTag & tag, const double & value) {
+		return appendValue(tag, (const uint8_t *) &value, sizeof(value), RSCP::eTypeDouble64);
+	}
+	int32_t appendValue(const SRscpTag & tag, const SRscpTimestamp & value) {
+		return appendValue(tag, (const uint8_t *) &value, sizeof(value), RSCP::eTypeTimestamp);
+	}
+	int32_t appendValue(const SRscpTag & tag, const char * value) {
+		return appendValue(tag, (const uint8_t *) value, (value != NULL) ? strlen(value) : 0, RSCP::eTypeString);
+	}
+	int32_t appendValue(const SRscpTag & tag, const std::string & value) {
+		return appendValue(tag, (const uint8_t *) value.c_str(), value.length(), RSCP::eTypeString);
+	}
+	/*
+	 * \brief Write the frame header (and CRC if \var calcCRC is set) and hand the buffer over to \var frameBuffer.
+	 * 		  All containers must be closed. Afterwards the builder is empty and allocates a new buffer on next use.
+	 * @return - RSCP error code if the function fails else RSCP::OK
+	 */
+	int32_t finish(SRscpFrameBuffer * frameBuffer, bool calcCRC);
+private:
+	bool reserve(size_t size);
+
+	uint8_t * m_buffer;
+	size_t m_capacity;
+	size_t m_length;
+	std::vector<size_t> m_openContainers;  // offsets of the values of all open containers
+	int32_t m_error;                       // first error, reported by finish()
+};
+
 #endif /* RSCPPROTOCOL_H_ */
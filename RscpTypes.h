@@ -96,6 +96,20 @@ struct SRscpValue {
 	uint8_t* data;
 }  __attribute__((packed));
 
+/*
+ * Non-owning view of an RSCP value inside a raw frame buffer.
+ * The data pointer points into the buffer the value was parsed from and is only valid as long as that buffer.
+ */
+struct SRscpValueView {
+	SRscpTag tag;
+	uint8_t dataType;
+	uint16_t length;
+	const uint8_t* data;
+};
+
+/* Size of the tag, data type and length fields of a value as they are transmitted */
+#define RSCP_VALUE_HEADER_LENGTH    (sizeof(SRscpTag) + sizeof(uint8_t) + sizeof(uint16_t))
+
 struct SRscpFrameHeader {
 	uint16_t magic;
 	SRscpControl ctrl;
@@ -1,27 +1,177 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
 #include <arpa/inet.h>
 #include <fcntl.h>
 #include <errno.h>
-#include <sys/select.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/tcp.h>
-#include <resolv.h>
+#include "SocketConnection.h"
 
 /*
- * This is a very simple example client socket connection.
- * This implementation is limited to Linux (POSIX) sockets only.
- * A Microsoft Windows implementation is not supplied in this example.
+ * TCP transport, limited to Linux (epoll).
+ * A Microsoft Windows implementation is not supplied.
  */
 
-int SocketConnect(const char *cpIpAddress, int iPort) {
+int64_t SocketNowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+SocketEventLoop::SocketEventLoop() {
+    m_epoll = epoll_create1(EPOLL_CLOEXEC);
+}
+
+SocketEventLoop::~SocketEventLoop() {
+    if(m_epoll >= 0) {
+        close(m_epoll);
+    }
+}
+
+bool SocketEventLoop::watch(int fd, uint32_t events, int64_t deadlineMs, const Handler & handler) {
+    if(m_epoll < 0 || fd < 0) {
+        return false;
+    }
+    std::map<int, Watch>::iterator it = m_watches.find(fd);
+    // EPOLLONESHOT has to be re-armed every time, otherwise unchanged events need no system call
+    if(it == m_watches.end() || it->second.events != events || (events & EPOLLONESHOT)) {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = events;
+        event.data.fd = fd;
+        int op = (it == m_watches.end()) ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+        int result = epoll_ctl(m_epoll, op, fd, &event);
+        // a closed socket leaves the epoll set by itself, its number may be in use again
+        if(result < 0 && op == EPOLL_CTL_MOD && errno == ENOENT) {
+            result = epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event);
+        } else if(result < 0 && op == EPOLL_CTL_ADD && errno == EEXIST) {
+            result = epoll_ctl(m_epoll, EPOLL_CTL_MOD, fd, &event);
+        }
+        if(result < 0) {
+            return false;
+        }
+    }
+    Watch & watch = m_watches[fd];
+    watch.events = events;
+    watch.deadline = deadlineMs;
+    watch.handler = handler;
+    return true;
+}
+
+void SocketEventLoop::unwatch(int fd) {
+    std::map<int, Watch>::iterator it = m_watches.find(fd);
+    if(it == m_watches.end()) {
+        return;
+    }
+    epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, NULL);
+    m_watches.erase(it);
+}
+
+int SocketEventLoop::runOnce(int64_t untilMs) {
+    if(m_epoll < 0) {
+        return -1;
+    }
+    int64_t deadline = untilMs;
+    for(std::map<int, Watch>::const_iterator it = m_watches.begin(); it != m_watches.end(); ++it) {
+        if(it->second.deadline >= 0 && (deadline < 0 || it->second.deadline < deadline)) {
+            deadline = it->second.deadline;
+        }
+    }
+    int timeout = -1;
+    if(deadline >= 0) {
+        int64_t remaining = deadline - SocketNowMs();
+        timeout = remaining > 0 ? (int) remaining : 0;
+    }
+
+    struct epoll_event events[32];
+    int n = epoll_wait(m_epoll, events, sizeof(events) / sizeof(events[0]), timeout);
+    if(n < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    int calls = 0;
+    for(int i = 0; i < n; i++) {
+        std::map<int, Watch>::iterator it = m_watches.find(events[i].data.fd);
+        if(it == m_watches.end()) {
+            continue;
+        }
+        // the operation the deadline belongs to is ready; the handler may unwatch the socket, it runs on a copy
+        it->second.deadline = -1;
+        Handler handler = it->second.handler;
+        handler(events[i].data.fd, events[i].events);
+        calls++;
+    }
+
+    // expired deadlines: collected first, the handlers may change the set
+    int64_t now = SocketNowMs();
+    int expired[32];
+    int expiredCount = 0;
+    for(std::map<int, Watch>::iterator it = m_watches.begin(); it != m_watches.end() && expiredCount < 32; ++it) {
+        if(it->second.deadline >= 0 && it->second.deadline <= now) {
+            it->second.deadline = -1;
+            expired[expiredCount++] = it->first;
+        }
+    }
+    for(int i = 0; i < expiredCount; i++) {
+        std::map<int, Watch>::iterator it = m_watches.find(expired[i]);
+        if(it != m_watches.end()) {
+            Handler handler = it->second.handler;
+            handler(expired[i], 0);
+            calls++;
+        }
+    }
+    return calls;
+}
+
+// event loop of the blocking-style functions, one per thread (exporter poller, daemon, fleet workers)
+static SocketEventLoop & threadLoop() {
+    static thread_local SocketEventLoop loop;
+    return loop;
+}
+
+// result of the current SocketWait() of this thread; a late event of a socket waited for before is ignored
+static thread_local struct {
+    int fd;
+    uint32_t events;
+    bool done;
+} t_wait;
+
+bool SocketWait(int iSocket, uint32_t events, int64_t deadlineMs) {
+    SocketEventLoop & loop = threadLoop();
+    t_wait.fd = iSocket;
+    t_wait.events = 0;
+    t_wait.done = false;
+    // one shot: after the event the socket does not wake up the loop again until the next wait
+    if(!loop.watch(iSocket, events | EPOLLONESHOT, deadlineMs, [](int fd, uint32_t ready) {
+            if(fd == t_wait.fd) {
+                t_wait.events = ready;
+                t_wait.done = true;
+            }
+        })) {
+        return false;
+    }
+    while(!t_wait.done) {
+        if(loop.runOnce(deadlineMs) < 0) {
+            return false;
+        }
+    }
+    if(t_wait.events == 0) {
+        errno = ETIMEDOUT;
+        return false;
+    }
+    // EPOLLERR/EPOLLHUP: the following send/recv/getsockopt reports the error
+    return true;
+}
+
+int SocketConnect(const char *cpIpAddress, int iPort, int iTimeoutMs) {
 
     unsigned char ucBuffer[sizeof(struct in6_addr)];
 
     if(inet_pton(AF_INET, cpIpAddress, ucBuffer) <= 0) {
-        printf("IP address %s cannot be converted.\n", cpIpAddress);
+        fprintf(stderr, "IP address %s cannot be converted.\n", cpIpAddress);
         return -1;
     }
 
@@ -31,32 +181,35 @@ int SocketConnect(const char *cpIpAddress, int iPort) {
     server_addr.sin_port = htons(iPort);
     server_addr.sin_addr = *((struct in_addr *) ucBuffer);
 
-    int iSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    int iSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
     if(iSocket < 0) {
-        printf("Cannot create socket. Error %i errno %i.\n", iSocket, errno);
+        fprintf(stderr, "Cannot create socket. Error %i errno %i.\n", iSocket, errno);
         return iSocket;
     }
 
-    // 3 secs receive timeout setup
-    struct timeval tv;
-    tv.tv_sec = 3;
-    tv.tv_usec = 0;
-    setsockopt(iSocket, SOL_SOCKET, SO_RCVTIMEO, (struct timeval *) &tv, sizeof(struct timeval));
-    // send time out should never occur on normal OS configurations but just in case set the timeout to 5 seconds
-    tv.tv_sec = 5;
-    tv.tv_usec = 0;
-    setsockopt(iSocket, SOL_SOCKET, SO_SNDTIMEO, (struct timeval *) &tv, sizeof(struct timeval));
-
     int enable = 1;
     setsockopt(iSocket, IPPROTO_TCP, TCP_NODELAY, (char *) &enable, sizeof(enable));
 
-
-    // wait 3 seconds for connection to get ready
-    int iRetries = 3;
+    // non-blocking connect: wait for the socket to become writable, at most iTimeoutMs
+    int64_t deadline = SocketNowMs() + iTimeoutMs;
     if(connect(iSocket, (struct sockaddr *) &server_addr, sizeof(struct sockaddr)) < 0) {
-        printf("Cannot connect to server. errno %i.\n", errno);
-        close(iSocket);
-        return -1;
+        if(errno != EINPROGRESS) {
+            fprintf(stderr, "Cannot connect to server. errno %i.\n", errno);
+            SocketClose(iSocket);
+            return -1;
+        }
+        if(!SocketWait(iSocket, EPOLLOUT, deadline)) {
+            fprintf(stderr, "Cannot connect to server. No answer within %i ms.\n", iTimeoutMs);
+            SocketClose(iSocket);
+            return -1;
+        }
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if(getsockopt(iSocket, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+            fprintf(stderr, "Cannot connect to server. errno %i.\n", error ? error : errno);
+            SocketClose(iSocket);
+            return -1;
+        }
     }
 
     return iSocket;
@@ -66,22 +219,34 @@ void SocketClose(int iSocket)
 {
     // sanity check
     if(iSocket >= 0) {
+        threadLoop().unwatch(iSocket);
         shutdown(iSocket, SHUT_RD);
         close(iSocket);
     }
 }
 
-int SocketSendData(int iSocket, const unsigned char * ucBuffer, int iLength)
+int SocketSendData(int iSocket, const unsigned char * ucBuffer, int iLength, int iTimeoutMs)
 {
     // sanity check
     if(iSocket < 0) {
         return iSocket;
     }
 
+    int64_t deadline = SocketNowMs() + iTimeoutMs;
     int iSentBytes = 0;
     while(iLength)
     {
-        int result = send(iSocket, ucBuffer, iLength, 0);
+        int result = send(iSocket, ucBuffer, iLength, MSG_NOSIGNAL);
+        if(result < 0 && errno == EINTR) {
+            continue;
+        }
+        if(result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // send buffer full: wait until the S10 has taken data or the deadline has passed
+            if(!SocketWait(iSocket, EPOLLOUT, deadline)) {
+                return -1;
+            }
+            continue;
+        }
         if(result <= 0) {
             return -1;
         }
@@ -92,12 +257,31 @@ int SocketSendData(int iSocket, const unsigned char * ucBuffer, int iLength)
     return iSentBytes;
 }
 
-int SocketRecvData(int iSocket, unsigned char * ucBuffer, int iLength)
+int SocketRecvData(int iSocket, unsigned char * ucBuffer, int iLength, int iTimeoutMs)
 {
     // sanity check
     if(iSocket < 0) {
         return iSocket;
     }
 
-    return recv(iSocket, ucBuffer, iLength, 0);
+    int64_t deadline = SocketNowMs() + iTimeoutMs;
+    while(true) {
+        int result = recv(iSocket, ucBuffer, iLength, 0);
+        if(result >= 0) {
+            return result;
+        }
+        if(errno == EINTR) {
+            continue;
+        }
+        if(errno != EAGAIN && errno != EWOULDBLOCK) {
+            return -1;
+        }
+        if(!SocketWait(iSocket, EPOLLIN, deadline)) {
+            // timeout is reported like the former SO_RCVTIMEO
+            if(errno == ETIMEDOUT) {
+                errno = EAGAIN;
+            }
+            return -1;
+        }
+    }
 }
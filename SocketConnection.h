@@ -1,17 +1,68 @@
 #ifndef __SOCKET_CONNECTION_H_
 #define __SOCKET_CONNECTION_H_
 
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <map>
+#include <functional>
+
 /*
- * This is a very simple example client socket connection.
- * Plain functions are used in this example instead of a well formed C++ class.
- * This should not be used as "the correct" way of doing TCP connection but it is sufficient for this example
- * and the demonstration of the RSCP protocol which is not limited to TCP or Ethernet at all.
+ * TCP transport of e3dcset.
+ *
+ * All sockets are non-blocking and driven by an epoll event loop. Every operation has its own deadline:
+ * connect() no longer waits for the kernel connect timeout (minutes for an unreachable S10), a receive returns
+ * with errno EAGAIN when the S10 does not answer in time, a send fails when the socket stays full.
+ *
+ * SocketConnect/SocketSendData/SocketRecvData keep the simple call style of the original example: they wait in a
+ * per-thread SocketEventLoop until the socket is ready or the deadline has passed. Code that serves several sockets
+ * from one thread registers them in its own SocketEventLoop and reacts to the events instead.
  */
 
-int SocketConnect(const char *cpIpAddress, int iPort);
+#define SOCKET_CONNECT_TIMEOUT_MS 3000
+#define SOCKET_RECV_TIMEOUT_MS    3000
+#define SOCKET_SEND_TIMEOUT_MS    5000
+
+// monotonic clock in milliseconds, base of all deadlines
+int64_t SocketNowMs();
+
+class SocketEventLoop {
+public:
+    // events: EPOLLIN, EPOLLOUT, EPOLLERR, EPOLLHUP as reported by epoll; 0 when the deadline has passed
+    typedef std::function<void(int fd, uint32_t events)> Handler;
+
+    SocketEventLoop();
+    virtual ~SocketEventLoop();
+
+    bool isOpen() const { return m_epoll >= 0; }
+
+    // registers \var fd or changes its events and deadline (-1 = none); the handler is called once per
+    // readiness or expired deadline, after an expired deadline the socket stays registered without deadline
+    bool watch(int fd, uint32_t events, int64_t deadlineMs, const Handler & handler);
+    void unwatch(int fd);
+    bool watching(int fd) const { return m_watches.count(fd) > 0; }
+    size_t size() const { return m_watches.size(); }
+
+    // waits for the next events, at most until \var untilMs (-1 = until the earliest deadline of a socket)
+    // and dispatches them; returns the number of handler calls or -1 on errors
+    int runOnce(int64_t untilMs);
+
+private:
+    struct Watch {
+        uint32_t events;
+        int64_t deadline;
+        Handler handler;
+    };
+
+    int m_epoll;
+    std::map<int, Watch> m_watches;
+};
+
+int SocketConnect(const char *cpIpAddress, int iPort, int iTimeoutMs = SOCKET_CONNECT_TIMEOUT_MS);
 void SocketClose(int iSocket);
-int SocketSendData(int iSocket, const unsigned char * ucBuffer, int iLength);
-int SocketRecvData(int iSocket, unsigned char * ucBuffer, int iLength);
+int SocketSendData(int iSocket, const unsigned char * ucBuffer, int iLength, int iTimeoutMs = SOCKET_SEND_TIMEOUT_MS);
+int SocketRecvData(int iSocket, unsigned char * ucBuffer, int iLength, int iTimeoutMs = SOCKET_RECV_TIMEOUT_MS);
+// waits until \var iSocket is ready for \var events (EPOLLIN/EPOLLOUT); false with errno ETIMEDOUT after the deadline
+bool SocketWait(int iSocket, uint32_t events, int64_t deadlineMs);
 
 
  #endif // __SOCKET_CONNECTION_H_
@@ -0,0 +1,257 @@
+#include "TagDatabase.h"
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+TagDatabase::TagDatabase() : m_data(NULL), m_size(0), m_header(NULL), m_tags(NULL), m_nameIndex(NULL),
+                             m_interpretations(NULL), m_strings(NULL) {
+}
+
+TagDatabase::~TagDatabase() {
+    close();
+}
+
+// true if count elements of elementSize at offset lie within the image and are aligned
+static bool tableInImage(uint32_t offset, uint32_t count, size_t elementSize, size_t imageSize) {
+    if(offset % 8 != 0 || offset > imageSize) {
+        return false;
+    }
+    return (uint64_t) count * elementSize <= imageSize - offset;
+}
+
+bool TagDatabase::open(const char *path, const struct stat *source) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(TagDbHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(data == MAP_FAILED) {
+        return false;
+    }
+    m_data = data;
+    m_size = st.st_size;
+
+    const TagDbHeader *header = (const TagDbHeader *) data;
+    bool valid = memcmp(header->magic, TAGDB_MAGIC, sizeof(header->magic)) == 0 &&
+                 header->version == TAGDB_VERSION && header->byteOrder == TAGDB_BYTE_ORDER &&
+                 tableInImage(header->tagOffset, header->tagCount, sizeof(TagDbEntry), m_size) &&
+                 tableInImage(header->nameIndexOffset, header->tagCount, sizeof(uint32_t), m_size) &&
+                 tableInImage(header->interpretationOffset, header->interpretationCount, sizeof(TagDbInterpretation), m_size) &&
+                 header->stringsSize > 0 && header->stringsOffset <= m_size &&
+                 header->stringsSize <= m_size - header->stringsOffset;
+    if(valid && source != NULL) {
+        valid = header->sourceSize == (uint64_t) source->st_size &&
+                header->sourceMtimeSec == (int64_t) source->st_mtim.tv_sec &&
+                header->sourceMtimeNsec == (int64_t) source->st_mtim.tv_nsec;
+    }
+    if(!valid) {
+        close();
+        return false;
+    }
+
+    const uint8_t *base = (const uint8_t *) data;
+    m_header = header;
+    m_tags = (const TagDbEntry *) (base + header->tagOffset);
+    m_nameIndex = (const uint32_t *) (base + header->nameIndexOffset);
+    m_interpretations = (const TagDbInterpretation *) (base + header->interpretationOffset);
+    m_strings = (const char *) (base + header->stringsOffset);
+
+    // all strings have to end within the pool, so the lookups need no further checks
+    uint32_t stringsSize = header->stringsSize;
+    valid = m_strings[stringsSize - 1] == '\0';
+    for(uint32_t i = 0; valid && i < header->tagCount; i++) {
+        valid = m_tags[i].name < stringsSize && m_tags[i].description < stringsSize && m_nameIndex[i] < header->tagCount;
+    }
+    for(uint32_t i = 0; valid && i < header->interpretationCount; i++) {
+        valid = m_interpretations[i].text < stringsSize;
+    }
+    if(!valid) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void TagDatabase::close() {
+    if(m_data != NULL) {
+        munmap(m_data, m_size);
+    }
+    m_data = NULL;
+    m_size = 0;
+    m_header = NULL;
+    m_tags = NULL;
+    m_nameIndex = NULL;
+    m_interpretations = NULL;
+    m_strings = NULL;
+}
+
+const TagDbEntry * TagDatabase::findByHex(uint32_t hex) const {
+    if(!isOpen()) {
+        return NULL;
+    }
+    const TagDbEntry *end = m_tags + m_header->tagCount;
+    const TagDbEntry *it = std::lower_bound(m_tags, end, hex,
+        [](const TagDbEntry &entry, uint32_t value) { return entry.hex < value; });
+    if(it == end || it->hex != hex || (it->flags & TAGDB_FLAG_HEADER_ONLY)) {
+        return NULL;
+    }
+    return it;
+}
+
+const TagDbEntry * TagDatabase::findByName(const char *name) const {
+    if(!isOpen()) {
+        return NULL;
+    }
+    const uint32_t *end = m_nameIndex + m_header->tagCount;
+    const uint32_t *it = std::lower_bound(m_nameIndex, end, name,
+        [this](uint32_t index, const char *value) { return strcasecmp(string(m_tags[index].name), value) < 0; });
+    if(it == end || strcasecmp(string(m_tags[*it].name), name) != 0) {
+        return NULL;
+    }
+    return &m_tags[*it];
+}
+
+const char * TagDatabase::findInterpretation(uint32_t tag, int64_t value) const {
+    if(!isOpen()) {
+        return NULL;
+    }
+    const TagDbInterpretation *end = m_interpretations + m_header->interpretationCount;
+    const TagDbInterpretation *it = std::lower_bound(m_interpretations, end, std::make_pair(tag, value),
+        [](const TagDbInterpretation &entry, const std::pair<uint32_t, int64_t> &key) {
+            return entry.tag < key.first || (entry.tag == key.first && entry.value < key.second);
+        });
+    if(it == end || it->tag != tag || it->value != value) {
+        return NULL;
+    }
+    return string(it->text);
+}
+
+TagDbWriter::TagDbWriter() : m_strings(1, '\0') {
+}
+
+TagDbWriter::~TagDbWriter() {
+}
+
+uint32_t TagDbWriter::addString(const char *text) {
+    if(text == NULL || text[0] == '\0') {
+        return 0;
+    }
+    uint32_t offset = (uint32_t) m_strings.size();
+    m_strings.append(text, strlen(text) + 1);
+    return offset;
+}
+
+void TagDbWriter::addTag(const char *name, uint32_t hex, const char *description, uint16_t category, uint16_t flags) {
+    TagDbEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.hex = hex;
+    entry.name = addString(name);
+    entry.description = addString(description);
+    entry.ordinal = (uint32_t) m_tags.size();
+    entry.category = category;
+    entry.flags = flags;
+    m_tags.push_back(entry);
+}
+
+void TagDbWriter::addInterpretation(uint32_t tag, int64_t value, const char *text) {
+    TagDbInterpretation interpretation;
+    memset(&interpretation, 0, sizeof(interpretation));
+    interpretation.tag = tag;
+    interpretation.value = value;
+    interpretation.text = addString(text);
+    m_interpretations.push_back(interpretation);
+}
+
+static uint32_t align8(size_t value) {
+    return (uint32_t) ((value + 7) & ~(size_t) 7);
+}
+
+bool TagDbWriter::write(const char *path, const struct stat *source) {
+    // order of the tags file decides between equal keys, RscpTags.h entries come last
+    std::vector<TagDbEntry> tags = m_tags;
+    std::sort(tags.begin(), tags.end(), [](const TagDbEntry &a, const TagDbEntry &b) {
+        if(a.hex != b.hex) return a.hex < b.hex;
+        if((a.flags & TAGDB_FLAG_HEADER_ONLY) != (b.flags & TAGDB_FLAG_HEADER_ONLY)) return !(a.flags & TAGDB_FLAG_HEADER_ONLY);
+        return a.ordinal < b.ordinal;
+    });
+    const char *pool = m_strings.data();
+    std::vector<uint32_t> nameIndex(tags.size());
+    for(uint32_t i = 0; i < nameIndex.size(); i++) {
+        nameIndex[i] = i;
+    }
+    std::sort(nameIndex.begin(), nameIndex.end(), [&tags, pool](uint32_t a, uint32_t b) {
+        int result = strcasecmp(pool + tags[a].name, pool + tags[b].name);
+        if(result != 0) return result < 0;
+        if((tags[a].flags & TAGDB_FLAG_HEADER_ONLY) != (tags[b].flags & TAGDB_FLAG_HEADER_ONLY)) return !(tags[a].flags & TAGDB_FLAG_HEADER_ONLY);
+        return tags[a].ordinal < tags[b].ordinal;
+    });
+    // the last entry of a (tag, value) wins, like the interpretation map of the tags file loader
+    std::vector<TagDbInterpretation> interpretations;
+    interpretations.reserve(m_interpretations.size());
+    std::vector<TagDbInterpretation> sorted = m_interpretations;
+    std::stable_sort(sorted.begin(), sorted.end(), [](const TagDbInterpretation &a, const TagDbInterpretation &b) {
+        return a.tag < b.tag || (a.tag == b.tag && a.value < b.value);
+    });
+    for(size_t i = 0; i < sorted.size(); i++) {
+        if(!interpretations.empty() && interpretations.back().tag == sorted[i].tag && interpretations.back().value == sorted[i].value) {
+            interpretations.back() = sorted[i];
+        } else {
+            interpretations.push_back(sorted[i]);
+        }
+    }
+
+    TagDbHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TAGDB_MAGIC, sizeof(header.magic));
+    header.version = TAGDB_VERSION;
+    header.byteOrder = TAGDB_BYTE_ORDER;
+    if(source != NULL) {
+        header.sourceSize = source->st_size;
+        header.sourceMtimeSec = source->st_mtim.tv_sec;
+        header.sourceMtimeNsec = source->st_mtim.tv_nsec;
+    }
+    header.tagCount = (uint32_t) tags.size();
+    header.tagOffset = align8(sizeof(header));
+    header.nameIndexOffset = align8(header.tagOffset + tags.size() * sizeof(TagDbEntry));
+    header.interpretationCount = (uint32_t) interpretations.size();
+    header.interpretationOffset = align8(header.nameIndexOffset + nameIndex.size() * sizeof(uint32_t));
+    header.stringsOffset = align8(header.interpretationOffset + interpretations.size() * sizeof(TagDbInterpretation));
+    header.stringsSize = (uint32_t) m_strings.size();
+
+    std::string image(header.stringsOffset + header.stringsSize, '\0');
+    memcpy(&image[0], &header, sizeof(header));
+    if(!tags.empty()) {
+        memcpy(&image[header.tagOffset], &tags[0], tags.size() * sizeof(TagDbEntry));
+        memcpy(&image[header.nameIndexOffset], &nameIndex[0], nameIndex.size() * sizeof(uint32_t));
+    }
+    if(!interpretations.empty()) {
+        memcpy(&image[header.interpretationOffset], &interpretations[0], interpretations.size() * sizeof(TagDbInterpretation));
+    }
+    memcpy(&image[header.stringsOffset], m_strings.data(), m_strings.size());
+
+    // write to a temporary file and rename, a running process keeps its mapping of the old image
+    std::string tempPath = std::string(path) + ".tmp";
+    FILE *fp = fopen(tempPath.c_str(), "wb");
+    if(fp == NULL) {
+        return false;
+    }
+    bool ok = fwrite(image.data(), 1, image.size(), fp) == image.size();
+    ok = (fclose(fp) == 0) && ok;
+    if(!ok || rename(tempPath.c_str(), path) != 0) {
+        unlink(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,117 @@
+#ifndef __TAG_DATABASE_H_
+#define __TAG_DATABASE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+
+/*
+ * Compiled tag database (e3dcset --compile-tags).
+ * Binary image of e3dcset.tags and the TAG_* definitions of RscpTags.h, used with mmap without any parsing:
+ *
+ *   TagDbHeader
+ *   TagDbEntry          tags[tagCount]          sorted by hex, entries of the tags file before RscpTags.h entries
+ *   uint32_t            nameIndex[tagCount]     entry numbers sorted by name (case insensitive)
+ *   TagDbInterpretation interpretations[...]    sorted by tag and value
+ *   char                strings[stringsSize]    string pool, NUL terminated strings, offset 0 is ""
+ *
+ * All numbers are in host byte order, an image of another byte order is rejected.
+ * Lookups are binary searches on the mapped tables.
+ */
+
+#define TAGDB_MAGIC "E3DCTAGS"
+#define TAGDB_VERSION 1
+#define TAGDB_BYTE_ORDER 0x01020304
+
+// entry only comes from RscpTags.h: usable by name, no description, not listed
+#define TAGDB_FLAG_HEADER_ONLY 0x0001
+
+struct TagDbHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t sourceSize;        // size and modification time of the tags file the image was built from
+    int64_t sourceMtimeSec;
+    int64_t sourceMtimeNsec;
+    uint32_t tagCount;
+    uint32_t tagOffset;
+    uint32_t nameIndexOffset;
+    uint32_t interpretationCount;
+    uint32_t interpretationOffset;
+    uint32_t stringsOffset;
+    uint32_t stringsSize;
+    uint32_t reserved;
+};
+
+struct TagDbEntry {
+    uint32_t hex;
+    uint32_t name;              // offsets into the string pool
+    uint32_t description;
+    uint32_t ordinal;           // position in the tags file, for listings in file order
+    uint16_t category;
+    uint16_t flags;
+    uint32_t reserved;
+};
+
+struct TagDbInterpretation {
+    uint32_t tag;
+    uint32_t text;
+    int64_t value;
+};
+
+class TagDatabase {
+public:
+    TagDatabase();
+    virtual ~TagDatabase();
+
+    // Maps the image and checks all offsets. With source != NULL the image is only accepted if it was
+    // built from a tags file of this size and modification time. Returns false if the image can not be used.
+    bool open(const char *path, const struct stat *source);
+    void close();
+    bool isOpen() const { return m_data != NULL; }
+
+    // first entry of the tags file with this hex value, RscpTags.h entries are not returned
+    const TagDbEntry * findByHex(uint32_t hex) const;
+    // case insensitive, tags file before RscpTags.h
+    const TagDbEntry * findByName(const char *name) const;
+    // NULL if there is no interpretation
+    const char * findInterpretation(uint32_t tag, int64_t value) const;
+
+    uint32_t tagCount() const { return m_header ? m_header->tagCount : 0; }
+    uint32_t interpretationCount() const { return m_header ? m_header->interpretationCount : 0; }
+    const TagDbEntry * entry(uint32_t index) const { return &m_tags[index]; }
+    const char * string(uint32_t offset) const { return m_strings + offset; }
+
+private:
+    void *m_data;
+    size_t m_size;
+    const TagDbHeader *m_header;
+    const TagDbEntry *m_tags;
+    const uint32_t *m_nameIndex;
+    const TagDbInterpretation *m_interpretations;
+    const char *m_strings;
+};
+
+// Collects tags and interpretations and writes the image
+class TagDbWriter {
+public:
+    TagDbWriter();
+    virtual ~TagDbWriter();
+
+    void addTag(const char *name, uint32_t hex, const char *description, uint16_t category, uint16_t flags);
+    // the same (tag, value) added again replaces the earlier text
+    void addInterpretation(uint32_t tag, int64_t value, const char *text);
+    // source: stat of the tags file, written into the header for the staleness check
+    bool write(const char *path, const struct stat *source);
+
+private:
+    uint32_t addString(const char *text);
+
+    std::vector<TagDbEntry> m_tags;
+    std::vector<TagDbInterpretation> m_interpretations;
+    std::string m_strings;
+};
+
+#endif // __TAG_DATABASE_H_
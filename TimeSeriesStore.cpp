@@ -0,0 +1,539 @@
+#include "TimeSeriesStore.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <vector>
+#include <algorithm>
+
+// space for one point in each column: worst case 68 bits for a timestamp, 77 bits for a value
+#define TSDB_POINT_RESERVE 16
+
+// uncommitted bits of an interrupted append can be at most this far behind the committed end
+#define TSDB_CLEAR_BYTES 32
+
+// MSB first bit streams. The writer only sets bits, the bytes behind the committed end are always zero.
+static inline void putBits(uint8_t *buffer, uint64_t *position, uint64_t value, int bits) {
+    while(bits > 0) {
+        uint64_t byteIndex = *position >> 3;
+        int free = 8 - (int) (*position & 7);
+        int take = bits < free ? bits : free;
+        uint8_t chunk = (uint8_t) ((value >> (bits - take)) & ((1u << take) - 1));
+        buffer[byteIndex] |= (uint8_t) (chunk << (free - take));
+        *position += take;
+        bits -= take;
+    }
+}
+
+static inline uint64_t getBits(const uint8_t *buffer, uint64_t *position, int bits) {
+    uint64_t value = 0;
+    while(bits > 0) {
+        uint64_t byteIndex = *position >> 3;
+        int available = 8 - (int) (*position & 7);
+        int take = bits < available ? bits : available;
+        uint8_t chunk = (uint8_t) ((buffer[byteIndex] >> (available - take)) & ((1u << take) - 1));
+        value = (value << take) | chunk;
+        *position += take;
+        bits -= take;
+    }
+    return value;
+}
+
+static inline int64_t signExtend(uint64_t value, int bits) {
+    uint64_t sign = (uint64_t) 1 << (bits - 1);
+    return (int64_t) ((value ^ sign) - sign);
+}
+
+static inline uint64_t doubleBits(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static inline double bitsDouble(uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static void encodeTimestamp(uint8_t *buffer, uint64_t *position, int64_t dod) {
+    if(dod == 0) {
+        putBits(buffer, position, 0x0, 1);
+    } else if(dod >= -64 && dod <= 63) {
+        putBits(buffer, position, 0x2, 2);
+        putBits(buffer, position, (uint64_t) dod, 7);
+    } else if(dod >= -256 && dod <= 255) {
+        putBits(buffer, position, 0x6, 3);
+        putBits(buffer, position, (uint64_t) dod, 9);
+    } else if(dod >= -2048 && dod <= 2047) {
+        putBits(buffer, position, 0xe, 4);
+        putBits(buffer, position, (uint64_t) dod, 12);
+    } else {
+        putBits(buffer, position, 0xf, 4);
+        putBits(buffer, position, (uint64_t) dod, 64);
+    }
+}
+
+static int64_t decodeTimestamp(const uint8_t *buffer, uint64_t *position) {
+    if(getBits(buffer, position, 1) == 0) {
+        return 0;
+    }
+    if(getBits(buffer, position, 1) == 0) {
+        return signExtend(getBits(buffer, position, 7), 7);
+    }
+    if(getBits(buffer, position, 1) == 0) {
+        return signExtend(getBits(buffer, position, 9), 9);
+    }
+    if(getBits(buffer, position, 1) == 0) {
+        return signExtend(getBits(buffer, position, 12), 12);
+    }
+    return (int64_t) getBits(buffer, position, 64);
+}
+
+// leading and trailing describe the window of the previous xor, leading < 0 means there is none yet
+static void encodeValue(uint8_t *buffer, uint64_t *position, uint64_t xorValue, int *leading, int *trailing) {
+    if(xorValue == 0) {
+        putBits(buffer, position, 0x0, 1);
+        return;
+    }
+    int newLeading = __builtin_clzll(xorValue);
+    int newTrailing = __builtin_ctzll(xorValue);
+    if(newLeading > 31) {
+        newLeading = 31;
+    }
+    if(*leading >= 0 && newLeading >= *leading && newTrailing >= *trailing) {
+        putBits(buffer, position, 0x2, 2);
+        putBits(buffer, position, xorValue >> *trailing, 64 - *leading - *trailing);
+        return;
+    }
+    int length = 64 - newLeading - newTrailing;
+    putBits(buffer, position, 0x3, 2);
+    putBits(buffer, position, (uint64_t) newLeading, 5);
+    putBits(buffer, position, (uint64_t) (length - 1), 6);
+    putBits(buffer, position, xorValue >> newTrailing, length);
+    *leading = newLeading;
+    *trailing = newTrailing;
+}
+
+static uint64_t decodeValue(const uint8_t *buffer, uint64_t *position, int *leading, int *trailing) {
+    if(getBits(buffer, position, 1) == 0) {
+        return 0;
+    }
+    if(getBits(buffer, position, 1) == 0) {
+        return getBits(buffer, position, 64 - *leading - *trailing) << *trailing;
+    }
+    *leading = (int) getBits(buffer, position, 5);
+    int length = (int) getBits(buffer, position, 6) + 1;
+    *trailing = 64 - *leading - length;
+    return getBits(buffer, position, length) << *trailing;
+}
+
+TsSegment::TsSegment() : m_data(NULL), m_size(0), m_header(NULL), m_times(NULL), m_values(NULL),
+                         m_timeBits(0), m_valueBits(0), m_lastTime(0), m_lastDelta(0), m_lastValue(0),
+                         m_leading(-1), m_trailing(0) {
+}
+
+TsSegment::~TsSegment() {
+    close();
+}
+
+bool TsSegment::map(int fd, size_t size, bool writable) {
+    void *data = mmap(NULL, size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    if(data == MAP_FAILED) {
+        return false;
+    }
+    m_data = (uint8_t *) data;
+    m_size = size;
+    m_header = (TsSegmentHeader *) data;
+    return true;
+}
+
+bool TsSegment::create(const char *path, uint32_t tag, int64_t firstTime, uint32_t capacity) {
+    close();
+    int fd = ::open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if(fd < 0) {
+        return false;
+    }
+    size_t size = TSDB_HEADER_SIZE + 2 * (size_t) capacity;
+    // ftruncate leaves a sparse file, disk space is only used for written pages
+    if(ftruncate(fd, size) != 0 || !map(fd, size, true)) {
+        ::close(fd);
+        unlink(path);
+        return false;
+    }
+    ::close(fd);
+    m_times = m_data + TSDB_HEADER_SIZE;
+    m_values = m_times + capacity;
+    memcpy(m_header->magic, TSDB_MAGIC, sizeof(m_header->magic));
+    m_header->version = TSDB_VERSION;
+    m_header->tag = tag;
+    m_header->capacity = capacity;
+    m_header->firstTime = firstTime;
+    m_header->lastTime = firstTime;
+    m_header->count = 0;
+    return true;
+}
+
+bool TsSegment::open(const char *path, bool writable) {
+    close();
+    int fd = ::open(path, writable ? O_RDWR : O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t) st.st_size < TSDB_HEADER_SIZE || !map(fd, st.st_size, writable)) {
+        ::close(fd);
+        return false;
+    }
+    ::close(fd);
+    if(memcmp(m_header->magic, TSDB_MAGIC, sizeof(m_header->magic)) != 0 || m_header->version != TSDB_VERSION ||
+       m_header->capacity <= TSDB_POINT_RESERVE ||
+       TSDB_HEADER_SIZE + 2 * (uint64_t) m_header->capacity != (uint64_t) m_size) {
+        close();
+        return false;
+    }
+    m_times = m_data + TSDB_HEADER_SIZE;
+    m_values = m_times + m_header->capacity;
+
+    if(writable && !decode(INT64_MIN, INT64_MIN, NULL)) {
+        // committed points beyond the end of a column: the header is broken
+        close();
+        return false;
+    }
+
+    if(writable) {
+        // remove bits of an append which was interrupted before it was committed
+        uint64_t positions[2] = { m_timeBits, m_valueBits };
+        uint8_t *columns[2] = { m_times, m_values };
+        for(int c = 0; c < 2; c++) {
+            uint64_t byteIndex = positions[c] >> 3;
+            int used = (int) (positions[c] & 7);
+            if(used != 0) {
+                columns[c][byteIndex] &= (uint8_t) (0xff << (8 - used));
+                byteIndex++;
+            }
+            uint64_t end = std::min<uint64_t>(byteIndex + TSDB_CLEAR_BYTES, m_header->capacity);
+            if(byteIndex < end) {
+                memset(columns[c] + byteIndex, 0, end - byteIndex);
+            }
+        }
+        if(count() > 0) {
+            m_header->lastTime = m_lastTime;
+        }
+    }
+    return true;
+}
+
+void TsSegment::close() {
+    if(m_data != NULL) {
+        munmap(m_data, m_size);
+    }
+    m_data = NULL;
+    m_size = 0;
+    m_header = NULL;
+    m_times = NULL;
+    m_values = NULL;
+    m_timeBits = 0;
+    m_valueBits = 0;
+    m_lastTime = 0;
+    m_lastDelta = 0;
+    m_lastValue = 0;
+    m_leading = -1;
+    m_trailing = 0;
+}
+
+bool TsSegment::append(int64_t time, double value) {
+    if(m_header == NULL) {
+        return false;
+    }
+    uint32_t count = this->count();
+    uint64_t limit = (uint64_t) (m_header->capacity - TSDB_POINT_RESERVE) * 8;
+    if(m_timeBits > limit || m_valueBits > limit || count == UINT32_MAX) {
+        return false;
+    }
+    if(count > 0 && time <= m_lastTime) {
+        return false;
+    }
+
+    uint64_t timeBits = m_timeBits, valueBits = m_valueBits;
+    uint64_t bits = doubleBits(value);
+    int64_t delta = 0;
+    int leading = m_leading, trailing = m_trailing;
+    if(count == 0) {
+        putBits(m_times, &timeBits, (uint64_t) time, 64);
+        putBits(m_values, &valueBits, bits, 64);
+    } else {
+        delta = time - m_lastTime;
+        encodeTimestamp(m_times, &timeBits, delta - m_lastDelta);
+        encodeValue(m_values, &valueBits, bits ^ m_lastValue, &leading, &trailing);
+    }
+
+    // commit: lastTime first, so readers never skip a segment because of an old lastTime
+    m_header->lastTime = time;
+    __atomic_store_n(&m_header->count, count + 1, __ATOMIC_RELEASE);
+    m_timeBits = timeBits;
+    m_valueBits = valueBits;
+    m_lastTime = time;
+    m_lastDelta = delta;
+    m_lastValue = bits;
+    m_leading = leading;
+    m_trailing = trailing;
+    return true;
+}
+
+// Decodes all committed points, calls callback for those within [from, to] and stores the encoder state of the
+// last point. Returns false if the points do not fit into the columns.
+bool TsSegment::decode(int64_t from, int64_t to, const TsPointCallback *callback) {
+    uint32_t count = this->count();
+    uint64_t limit = (uint64_t) (m_header->capacity - TSDB_POINT_RESERVE) * 8;
+    uint64_t timeBits = 0, valueBits = 0;
+    int64_t time = 0, delta = 0;
+    uint64_t value = 0;
+    int leading = -1, trailing = 0;
+    bool ok = true;
+    for(uint32_t i = 0; i < count; i++) {
+        if(timeBits > limit || valueBits > limit) {
+            ok = false;
+            break;
+        }
+        if(i == 0) {
+            time = (int64_t) getBits(m_times, &timeBits, 64);
+            value = getBits(m_values, &valueBits, 64);
+        } else {
+            delta += decodeTimestamp(m_times, &timeBits);
+            time += delta;
+            value ^= decodeValue(m_values, &valueBits, &leading, &trailing);
+        }
+        if(callback != NULL && time >= from) {
+            if(time > to) {
+                break;
+            }
+            (*callback)(time, bitsDouble(value));
+        }
+    }
+    m_timeBits = timeBits;
+    m_valueBits = valueBits;
+    m_lastTime = time;
+    m_lastDelta = delta;
+    m_lastValue = value;
+    m_leading = leading;
+    m_trailing = trailing;
+    return ok;
+}
+
+void TsSegment::read(int64_t from, int64_t to, const TsPointCallback & callback) {
+    if(count() == 0 || m_header->firstTime > to || m_header->lastTime < from) {
+        return;
+    }
+    decode(from, to, &callback);
+}
+
+uint64_t TsSegment::usedBytes() {
+    if(m_header == NULL) {
+        return 0;
+    }
+    decode(INT64_MIN, INT64_MIN, NULL);
+    return (m_timeBits + 7) / 8 + (m_valueBits + 7) / 8;
+}
+
+TimeSeriesStore::TimeSeriesStore() : m_capacity(TSDB_DEFAULT_CAPACITY) {
+}
+
+TimeSeriesStore::~TimeSeriesStore() {
+    close();
+}
+
+bool TimeSeriesStore::open(const char *directory, uint32_t capacity) {
+    close();
+    if(mkdir(directory, 0755) != 0 && errno != EEXIST) {
+        return false;
+    }
+    struct stat st;
+    if(stat(directory, &st) != 0 || !S_ISDIR(st.st_mode) || capacity <= TSDB_POINT_RESERVE) {
+        return false;
+    }
+    m_directory = directory;
+    m_capacity = capacity;
+    return true;
+}
+
+void TimeSeriesStore::close() {
+    for(std::map<uint32_t, TsSegment *>::iterator it = m_active.begin(); it != m_active.end(); ++it) {
+        delete it->second;
+    }
+    m_active.clear();
+    m_directory.clear();
+}
+
+std::string TimeSeriesStore::tagDirectory(uint32_t tag) const {
+    char name[16];
+    snprintf(name, sizeof(name), "%08X", tag);
+    return m_directory + "/" + name;
+}
+
+// segment files of a tag sorted by time
+static std::vector<std::string> listSegments(const std::string & directory) {
+    std::vector<std::pair<int64_t, std::string> > segments;
+    DIR *dir = opendir(directory.c_str());
+    if(dir != NULL) {
+        struct dirent *entry;
+        while((entry = readdir(dir)) != NULL) {
+            long long firstTime;
+            char suffix[8];
+            if(sscanf(entry->d_name, "%lld.%7s", &firstTime, suffix) == 2 && strcmp(suffix, "seg") == 0) {
+                segments.push_back(std::make_pair((int64_t) firstTime, directory + "/" + entry->d_name));
+            }
+        }
+        closedir(dir);
+    }
+    std::sort(segments.begin(), segments.end());
+    std::vector<std::string> paths;
+    for(size_t i = 0; i < segments.size(); i++) {
+        paths.push_back(segments[i].second);
+    }
+    return paths;
+}
+
+TsSegment * TimeSeriesStore::activeSegment(uint32_t tag, int64_t time) {
+    std::map<uint32_t, TsSegment *>::iterator it = m_active.find(tag);
+    if(it != m_active.end()) {
+        return it->second;
+    }
+    if(m_directory.empty()) {
+        return NULL;
+    }
+    // after a restart appends continue in the newest segment
+    std::string directory = tagDirectory(tag);
+    if(mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        return NULL;
+    }
+    TsSegment *segment = new TsSegment();
+    std::vector<std::string> segments = listSegments(directory);
+    if(segments.empty() || !segment->open(segments.back().c_str(), true)) {
+        char name[32];
+        snprintf(name, sizeof(name), "/%013lld.seg", (long long) time);
+        if(!segment->create((directory + name).c_str(), tag, time, m_capacity)) {
+            delete segment;
+            return NULL;
+        }
+    }
+    m_active[tag] = segment;
+    return segment;
+}
+
+bool TimeSeriesStore::append(uint32_t tag, int64_t time, double value) {
+    TsSegment *segment = activeSegment(tag, time);
+    if(segment == NULL) {
+        return false;
+    }
+    if(segment->count() > 0 && time <= segment->lastTime()) {
+        return false;
+    }
+    if(segment->append(time, value)) {
+        return true;
+    }
+    // segment is full: the next one starts with this point
+    char name[32];
+    snprintf(name, sizeof(name), "/%013lld.seg", (long long) time);
+    TsSegment *next = new TsSegment();
+    if(!next->create((tagDirectory(tag) + name).c_str(), tag, time, m_capacity) || !next->append(time, value)) {
+        delete next;
+        return false;
+    }
+    delete segment;
+    m_active[tag] = next;
+    return true;
+}
+
+bool TimeSeriesStore::query(uint32_t tag, int64_t from, int64_t to, const TsPointCallback & callback) const {
+    std::string directory = tagDirectory(tag);
+    struct stat st;
+    if(m_directory.empty() || stat(directory.c_str(), &st) != 0) {
+        return false;
+    }
+    std::vector<std::string> segments = listSegments(directory);
+    for(size_t i = 0; i < segments.size(); i++) {
+        // the next segment starts after the last point of this one
+        if(i + 1 < segments.size()) {
+            long long nextFirst = 0;
+            const char *name = strrchr(segments[i + 1].c_str(), '/') + 1;
+            if(sscanf(name, "%lld", &nextFirst) == 1 && nextFirst <= from) {
+                continue;
+            }
+        }
+        TsSegment segment;
+        if(!segment.open(segments[i].c_str(), false)) {
+            continue;
+        }
+        if(segment.firstTime() > to) {
+            break;
+        }
+        segment.read(from, to, callback);
+    }
+    return true;
+}
+
+bool TimeSeriesStore::queryDownsampled(uint32_t tag, int64_t from, int64_t to, int64_t step, TsAggregation aggregation,
+                                       const TsPointCallback & callback) const {
+    if(step <= 0) {
+        return query(tag, from, to, callback);
+    }
+    bool active = false;
+    int64_t bucket = 0;
+    double result = 0;
+    uint64_t count = 0;
+    auto flush = [&]() {
+        if(active) {
+            callback(bucket, aggregation == TS_AGG_AVG ? result / count : result);
+        }
+    };
+    bool ok = query(tag, from, to, [&](int64_t time, double value) {
+        // floor division, also for times before 1970
+        int64_t start = time - ((time % step) + step) % step;
+        if(!active || start != bucket) {
+            flush();
+            active = true;
+            bucket = start;
+            count = 0;
+            result = (aggregation == TS_AGG_COUNT || aggregation == TS_AGG_SUM || aggregation == TS_AGG_AVG) ? 0 : value;
+        }
+        count++;
+        switch(aggregation) {
+            case TS_AGG_AVG:
+            case TS_AGG_SUM:   result += value; break;
+            case TS_AGG_MIN:   result = std::min(result, value); break;
+            case TS_AGG_MAX:   result = std::max(result, value); break;
+            case TS_AGG_FIRST: break;
+            case TS_AGG_LAST:  result = value; break;
+            case TS_AGG_COUNT: result = count; break;
+        }
+    });
+    flush();
+    return ok;
+}
+
+bool TimeSeriesStore::statistics(uint32_t tag, uint64_t *points, uint64_t *bytes, uint32_t *segments) const {
+    *points = 0;
+    *bytes = 0;
+    *segments = 0;
+    std::string directory = tagDirectory(tag);
+    struct stat st;
+    if(m_directory.empty() || stat(directory.c_str(), &st) != 0) {
+        return false;
+    }
+    std::vector<std::string> paths = listSegments(directory);
+    for(size_t i = 0; i < paths.size(); i++) {
+        TsSegment segment;
+        if(segment.open(paths[i].c_str(), false)) {
+            *points += segment.count();
+            *bytes += TSDB_HEADER_SIZE + segment.usedBytes();
+            (*segments)++;
+        }
+    }
+    return true;
+}
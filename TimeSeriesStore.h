@@ -0,0 +1,138 @@
+#ifndef __TIME_SERIES_STORE_H_
+#define __TIME_SERIES_STORE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <functional>
+
+/*
+ * Append-only time series store for polled values (e3dcset --exporter ... --store <dir>).
+ *
+ * Every tag has its own directory <dir>/<TAG>/ with segment files <first timestamp in ms>.seg.
+ * A segment is a memory mapped file of fixed size with two columns:
+ *
+ *   page 0                      TsSegmentHeader
+ *   [4096, 4096 + capacity)     timestamps (ms), delta-of-delta encoded
+ *   [4096 + capacity, end)      values (double), XOR encoded as in Facebook Gorilla
+ *
+ * Both columns are bit streams which only grow. The file is created sparse, pages which were never written do not
+ * use disk space. When one column is full, the next point starts a new segment.
+ *
+ * Timestamp column: first point 64 bits, afterwards delta-of-delta dod = (t[n] - t[n-1]) - (t[n-1] - t[n-2]):
+ *   '0'                   dod == 0
+ *   '10'   + 7 bits       -64 .. 63
+ *   '110'  + 9 bits       -256 .. 255
+ *   '1110' + 12 bits      -2048 .. 2047
+ *   '1111' + 64 bits      otherwise
+ * Value column: first point 64 bits, afterwards xor = bits[n] ^ bits[n-1]:
+ *   '0'                   xor == 0 (same value)
+ *   '10' + meaningful bits           the meaningful bits fit into the window of the previous xor
+ *   '11' + 5 bits leading zeros + 6 bits (length - 1) + meaningful bits
+ *
+ * A point is committed by increasing count in the header after its bits were written. Readers decode exactly
+ * count points, so a concurrent query or a crash during an append never sees a partial point.
+ */
+
+#define TSDB_MAGIC "E3DCTSDB"
+#define TSDB_VERSION 1
+#define TSDB_HEADER_SIZE 4096
+#define TSDB_DEFAULT_CAPACITY (128 * 1024)   // bytes per column
+
+struct TsSegmentHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t tag;
+    uint32_t capacity;        // bytes per column
+    uint32_t count;           // committed points
+    int64_t firstTime;        // ms since epoch
+    int64_t lastTime;         // >= time of every committed point, used to skip segments in queries
+};
+
+enum TsAggregation {
+    TS_AGG_AVG,
+    TS_AGG_MIN,
+    TS_AGG_MAX,
+    TS_AGG_FIRST,
+    TS_AGG_LAST,
+    TS_AGG_SUM,
+    TS_AGG_COUNT
+};
+
+// Point callback of the queries: time in ms since epoch, value
+typedef std::function<void(int64_t time, double value)> TsPointCallback;
+
+// One mapped segment file, used for appending and for reading
+class TsSegment {
+public:
+    TsSegment();
+    virtual ~TsSegment();
+
+    // new segment file, the first point will be at firstTime
+    bool create(const char *path, uint32_t tag, int64_t firstTime, uint32_t capacity);
+    // existing segment; writable restores the encoder state by decoding all committed points
+    bool open(const char *path, bool writable);
+    void close();
+
+    // false if the segment is full (or time is not after the last point: check lastTime() before)
+    bool append(int64_t time, double value);
+    // calls callback for all committed points within [from, to]
+    void read(int64_t from, int64_t to, const TsPointCallback & callback);
+
+    uint32_t count() const { return m_header ? __atomic_load_n(&m_header->count, __ATOMIC_ACQUIRE) : 0; }
+    int64_t firstTime() const { return m_header ? m_header->firstTime : 0; }
+    int64_t lastTime() const { return m_header ? m_header->lastTime : 0; }
+    // bytes of both columns which are in use
+    uint64_t usedBytes();
+
+private:
+    bool map(int fd, size_t size, bool writable);
+    bool decode(int64_t from, int64_t to, const TsPointCallback *callback);
+
+    uint8_t *m_data;
+    size_t m_size;
+    TsSegmentHeader *m_header;
+    uint8_t *m_times;
+    uint8_t *m_values;
+    // encoder state of the last decoded or appended point
+    uint64_t m_timeBits;
+    uint64_t m_valueBits;
+    int64_t m_lastTime;
+    int64_t m_lastDelta;
+    uint64_t m_lastValue;
+    int m_leading;
+    int m_trailing;
+};
+
+class TimeSeriesStore {
+public:
+    TimeSeriesStore();
+    virtual ~TimeSeriesStore();
+
+    // directory is created if necessary
+    bool open(const char *directory, uint32_t capacity = TSDB_DEFAULT_CAPACITY);
+    void close();
+
+    // appends one point; points which are not newer than the last point of the tag are dropped (false)
+    bool append(uint32_t tag, int64_t time, double value);
+
+    // raw points of [from, to] in time order
+    bool query(uint32_t tag, int64_t from, int64_t to, const TsPointCallback & callback) const;
+    // points aggregated into buckets of step ms (aligned to multiples of step), time of a bucket is its start
+    bool queryDownsampled(uint32_t tag, int64_t from, int64_t to, int64_t step, TsAggregation aggregation,
+                          const TsPointCallback & callback) const;
+
+    // number of points and used bytes of a tag (all segments)
+    bool statistics(uint32_t tag, uint64_t *points, uint64_t *bytes, uint32_t *segments) const;
+
+private:
+    std::string tagDirectory(uint32_t tag) const;
+    TsSegment * activeSegment(uint32_t tag, int64_t time);
+
+    std::string m_directory;
+    uint32_t m_capacity;
+    std::map<uint32_t, TsSegment *> m_active;   // segment which receives the appends of a tag
+};
+
+#endif // __TIME_SERIES_STORE_H_
@@ -0,0 +1,140 @@
+/*
+ * Microbenchmark for the Rijndael-256 CBC decryption of the RSCP frames.
+ * Compares the T-table code of the AES class (DecryptBlock() per block, chained like Decrypt() without AES-NI) with
+ * AES::Decrypt(), which uses the AES round instructions if the CPU has them (AESNI.h), on frames of
+ * RSCP_MAX_FRAME_LENGTH (64 KiB) and on a small frame. Before measuring, both are checked for the same result:
+ * random keys and IVs, 1 to 40 blocks, unaligned and in-place buffers and the round trip with Encrypt().
+ *
+ * make aesbench && ./aesbench [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "AES.h"
+#include "AESNI.h"
+#include "RscpTypes.h"
+
+#define BLOCK_SIZE 32
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// CBC decryption with the T-tables of the AES class, the reference for AES::Decrypt()
+static void decryptTables(AES & aes, const uint8_t *iv, const uint8_t *in, uint8_t *out, uint32_t blocks) {
+    uint8_t previous[BLOCK_SIZE], cipher[BLOCK_SIZE];
+    memcpy(previous, iv, BLOCK_SIZE);
+    for(uint32_t b = 0; b < blocks; b++) {
+        memcpy(cipher, in + b * BLOCK_SIZE, BLOCK_SIZE);
+        aes.DecryptBlock(cipher, out + b * BLOCK_SIZE);
+        for(int i = 0; i < BLOCK_SIZE; i++) {
+            out[b * BLOCK_SIZE + i] ^= previous[i];
+        }
+        memcpy(previous, cipher, BLOCK_SIZE);
+    }
+}
+
+static void decryptClass(AES & aes, const uint8_t *iv, const uint8_t *in, uint8_t *out, uint32_t blocks) {
+    aes.SetIV(iv, BLOCK_SIZE);
+    aes.Decrypt(in, out, blocks);
+}
+
+static void fillRandom(uint8_t *data, size_t length) {
+    for(size_t i = 0; i < length; i++) {
+        data[i] = (uint8_t) rand();
+    }
+}
+
+static bool verify() {
+    uint8_t key[32], iv[BLOCK_SIZE];
+    std::vector<uint8_t> plain(40 * BLOCK_SIZE + 1), cipher(40 * BLOCK_SIZE + 1);
+    std::vector<uint8_t> expected(40 * BLOCK_SIZE), result(40 * BLOCK_SIZE + 1);
+    for(int round = 0; round < 200; round++) {
+        AES encrypter, decrypter;
+        fillRandom(key, sizeof(key));
+        fillRandom(iv, sizeof(iv));
+        encrypter.SetParameters(256, 256);
+        decrypter.SetParameters(256, 256);
+        encrypter.StartEncryption(key);
+        decrypter.StartDecryption(key);
+
+        uint32_t blocks = 1 + round % 40;
+        size_t length = blocks * BLOCK_SIZE;
+        // odd offset: the frames are not aligned in the receive buffer
+        size_t offset = round & 1;
+        fillRandom(&plain[offset], length);
+        encrypter.SetIV(iv, BLOCK_SIZE);
+        encrypter.Encrypt(&plain[offset], &cipher[offset], blocks);
+
+        decryptTables(decrypter, iv, &cipher[offset], &expected[0], blocks);
+        decryptClass(decrypter, iv, &cipher[offset], &result[offset], blocks);
+        if(memcmp(&expected[0], &plain[offset], length) != 0 || memcmp(&result[offset], &expected[0], length) != 0) {
+            printf("Abweichung: Schluessel %d, %u Bloecke\n", round, blocks);
+            return false;
+        }
+        // in place like the simulator with a shared buffer
+        decryptClass(decrypter, iv, &cipher[offset], &cipher[offset], blocks);
+        if(memcmp(&cipher[offset], &expected[0], length) != 0) {
+            printf("Abweichung in place: Schluessel %d, %u Bloecke\n", round, blocks);
+            return false;
+        }
+    }
+    return true;
+}
+
+static double runBenchmark(const char *name, void (*function)(AES &, const uint8_t *, const uint8_t *, uint8_t *, uint32_t),
+                           AES & aes, const uint8_t *iv, const uint8_t *in, uint8_t *out, size_t length, int iterations) {
+    uint32_t blocks = length / BLOCK_SIZE;
+    double start = nowSeconds();
+    for(int i = 0; i < iterations; i++) {
+        function(aes, iv, in, out, blocks);
+    }
+    double elapsed = nowSeconds() - start;
+    double mbPerSecond = (double) length * iterations / elapsed / (1024.0 * 1024.0);
+    printf("  %-12s %10.1f MiB/s  %10.0f ns/Frame\n", name, mbPerSecond, elapsed * 1e9 / iterations);
+    return mbPerSecond;
+}
+
+int main(int argc, char *argv[]) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 500;
+    if(iterations <= 0) {
+        fprintf(stderr, "Fehler: Ungueltige Anzahl Iterationen\n");
+        return EXIT_FAILURE;
+    }
+    srand(0xE3DC);
+
+    printf("Rijndael-256 CBC Entschluesselung, %d Iterationen (AES::Decrypt() nutzt: %s)\n", iterations,
+           AES::DecryptImplementation());
+    bool ok = verify();
+    printf("Ergebnis: %s\n", ok ? "identisch" : "FEHLER - Abweichung");
+    if(!ok) {
+        return EXIT_FAILURE;
+    }
+
+    uint8_t key[32], iv[BLOCK_SIZE];
+    memset(key, 0xff, sizeof(key));
+    memcpy(key, "benchmark", 9);
+    memset(iv, 0xff, sizeof(iv));
+    AES aes;
+    aes.SetParameters(256, 256);
+    aes.StartDecryption(key);
+
+    // whole frame (DCB dump, history range) and a frame with a few values (-r)
+    const size_t lengths[] = { ROUNDDOWN(RSCP_MAX_FRAME_LENGTH, BLOCK_SIZE), 4 * BLOCK_SIZE };
+    for(size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        size_t length = lengths[i];
+        std::vector<uint8_t> in(length), out(length);
+        fillRandom(&in[0], length);
+        int count = (int) ((int64_t) iterations * lengths[0] / length);
+        printf("%zu Bytes:\n", length);
+        double tables = runBenchmark("t-tables", decryptTables, aes, iv, &in[0], &out[0], length, count);
+        double dispatch = runBenchmark("Decrypt()", decryptClass, aes, iv, &in[0], &out[0], length, count);
+        printf("  Faktor Decrypt(): %.1fx\n", dispatch / tables);
+    }
+    return EXIT_SUCCESS;
+}
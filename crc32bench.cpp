@@ -0,0 +1,71 @@
+/*
+ * Microbenchmark for the RSCP CRC32 implementations.
+ * Compares the former nibble implementation with slicing-by-8 and the runtime selected Crc32()
+ * on frames of RSCP_MAX_FRAME_LENGTH (64 KiB) and checks that all of them return the same value.
+ *
+ * make crcbench && ./crcbench [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "Crc32.h"
+#include "RscpTypes.h"
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double runBenchmark(const char *name, uint32_t (*function)(const uint8_t *, size_t),
+                           const uint8_t *data, size_t length, int iterations, uint32_t *result) {
+    uint32_t crc = 0;
+    double start = nowSeconds();
+    for(int i = 0; i < iterations; i++) {
+        // the result is folded in to keep the compiler from dropping calls
+        crc ^= function(data, length);
+    }
+    double elapsed = nowSeconds() - start;
+    double mbPerSecond = (double) length * iterations / elapsed / (1024.0 * 1024.0);
+    printf("%-14s %10.1f MiB/s  %10.0f ns/Frame\n", name, mbPerSecond, elapsed * 1e9 / iterations);
+    *result = function(data, length);
+    (void) crc;
+    return mbPerSecond;
+}
+
+int main(int argc, char *argv[]) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 2000;
+    if(iterations <= 0) {
+        fprintf(stderr, "Fehler: Ungueltige Anzahl Iterationen\n");
+        return EXIT_FAILURE;
+    }
+
+    const size_t length = RSCP_MAX_FRAME_LENGTH;
+    uint8_t *data = (uint8_t *) malloc(length);
+    if(data == NULL) {
+        return EXIT_FAILURE;
+    }
+    srand(0xE3DC);
+    for(size_t i = 0; i < length; i++) {
+        data[i] = (uint8_t) rand();
+    }
+
+    printf("CRC32 ueber %zu Bytes, %d Iterationen (Crc32() nutzt: %s)\n", length, iterations, Crc32Implementation());
+    uint32_t crcNibble, crcSlice8, crcDispatch;
+    double nibble = runBenchmark("nibble", Crc32Nibble, data, length, iterations / 10 + 1, &crcNibble);
+    double slice8 = runBenchmark("slicing-by-8", Crc32Slice8, data, length, iterations, &crcSlice8);
+    double dispatch = runBenchmark("Crc32()", Crc32, data, length, iterations, &crcDispatch);
+    printf("Faktor slicing-by-8: %.1fx, Crc32(): %.1fx\n", slice8 / nibble, dispatch / nibble);
+
+    // all implementations have to agree, also for lengths which are no multiple of 8
+    bool ok = (crcNibble == crcSlice8) && (crcNibble == crcDispatch);
+    for(size_t len = 0; len < 64 && ok; len++) {
+        uint32_t expected = Crc32Nibble(data + 3, len);
+        ok = (Crc32Slice8(data + 3, len) == expected) && (Crc32(data + 3, len) == expected);
+    }
+    printf("Ergebnis: %s (0x%08X)\n", ok ? "identisch" : "FEHLER - Abweichung", crcNibble);
+
+    free(data);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
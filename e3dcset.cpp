@@ -1,17 +1,39 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <stdarg.h>
+#include <ctype.h>
 #include <unistd.h>
 #include <strings.h>
 #include <time.h>
+#include <limits.h>
+#include <signal.h>
+#include <getopt.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <algorithm>
 #include <cmath>
 #include <map>
+#include <unordered_map>
 #include <string>
 #include <vector>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+#include <atomic>
 #include "RscpProtocol.h"
 #include "RscpTags.h"
 #include "SocketConnection.h"
 #include "AES.h"
+#include "TagDatabase.h"
+#include "TimeSeriesStore.h"
+#include "HistoryCache.h"
+#include "OutputWriter.h"
 
 #define DEBUG(...)if(debug) {printf(__VA_ARGS__);}
 
@@ -29,6 +51,35 @@
 #define HISTORY_INTERVAL_YEAR     604800  // 1 week
 #define HISTORY_SPAN_YEAR         31536000// 365 days
 
+// Mehrere History-Perioden pro Frame (-H mit --from/--to): die Antwort des S10 darf die maximale Containerlänge
+// nicht überschreiten, ein DB_VALUE_CONTAINER der Antwort umfasst ca. 110-160 Bytes
+#define HISTORY_RESPONSE_LIMIT    0xFFF8
+#define HISTORY_POINT_BYTES       160     // DB_VALUE_CONTAINER je Intervall
+#define HISTORY_PERIOD_BYTES      256     // History-Container und DB_SUM_CONTAINER
+#define HISTORY_MAX_PERIODS       4000    // z.B. 10 Jahre in Tagen
+
+// Abgeschlossene Perioden werden im History-Cache abgelegt (history_cache bzw. --cache). Das S10 schreibt die
+// Datenbankwerte mit etwas Verzögerung, deshalb gilt eine Periode erst eine Stunde nach ihrem Ende als abgeschlossen.
+#define HISTORY_CACHE_MARGIN      3600
+
+// Neuaufbau einer abgebrochenen Sitzung: Wartezeit vor dem n-ten Versuch RECONNECT_BASE_MS * 2^(n-1), höchstens
+// RECONNECT_MAX_MS, zufällig auf 50-100 % verkürzt (mehrere Clients verbinden sich nicht im selben Takt neu)
+#define RECONNECT_ATTEMPTS        6
+#define RECONNECT_BASE_MS         500
+#define RECONNECT_MAX_MS          30000
+
+// Daemon (--daemon): Frist in Sekunden für den Empfang einer Client-Anfrage und deren maximale Größe
+// (eine Zeile je -r Tag, 64 KiB reichen für mehrere tausend Tags)
+#define DAEMON_RECEIVE_TIMEOUT    2
+#define DAEMON_REQUEST_MAX        65536
+
+// Halte-Modus (--hold): eine Auffrischung, die mehr als HOLD_LATE_MS nach ihrem Sollzeitpunkt gesendet wird, wird gemeldet
+#define HOLD_LATE_MS              500
+
+// Maximale Anzahl TAG_BAT_REQ_DCB_INFO Anfragen pro Frame (-m)
+// Eine DCB-Antwort umfasst ca. 1 KB, damit bleibt die Antwort deutlich unter RSCP_MAX_FRAME_LENGTH
+#define MAX_DCB_REQUESTS_PER_FRAME 16
+
 typedef struct {
 
         uint32_t MIN_LEISTUNG;
@@ -41,9 +92,25 @@ typedef struct {
     char         e3dc_password[128];
     char         aes_password[128];
     bool         debug;
+    char         history_cache[256];   // Verzeichnis des History-Caches, leer = aus
+    uint32_t     history_cache_mb;     // maximale Größe des History-Caches in MB
+    uint32_t     reconnect_attempts;   // Verbindungsversuche nach einem Abbruch einer Sitzung, 0 = kein Neuaufbau
 
 } e3dc_config_t;
 
+// Eine abzufragende History-Periode (Tag, Woche, Monat oder Jahr)
+struct HistoryPeriod {
+    time_t start;    // Beginn der Periode, 00:00 Uhr Ortszeit
+    uint32_t span;   // Dauer in Sekunden
+};
+
+// Ausgabe der DB_VALUE_CONTAINER einer History-Abfrage (--series)
+enum HistorySeriesFormat {
+    SERIES_NONE,     // nur Zusammenfassung je Periode
+    SERIES_CSV,      // eine CSV-Zeile je Intervall, Kopfzeile einmal vorweg
+    SERIES_JSONL     // ein JSON-Objekt je Intervall und Zeile
+};
+
 // Command Context - kapselt alle Kommandozeilen-bezogenen Zustände
 struct CommandContext {
     // Control modes
@@ -60,11 +127,14 @@ struct CommandContext {
     bool batContainerQuery;  // True wenn BAT_REQ_* Tag abgefragt wird
     bool modulInfoDump;      // True wenn alle Modul-Werte abgefragt werden (-m)
     bool setEPReserve;       // True wenn Notstromreserve gesetzt werden soll (-E)
+    bool daemonMode;         // True wenn die RSCP-Sitzung dauerhaft gehalten wird (--daemon)
+    bool exporterMode;       // True wenn die -r Tags als Prometheus-Metriken bereitgestellt werden (--exporter)
     
     // Multi-DCB support
     bool needMoreDCBRequests;  // True wenn weitere DCB-Requests nötig sind
     uint8_t currentDCBIndex;   // Aktueller DCB-Index für Multi-Request
     uint8_t totalDCBs;         // Gesamtanzahl DCBs (aus DCB_COUNT)
+    uint8_t dcbBatchEnd;       // Erster DCB-Index nach dem aktuell angefragten Block
     bool isFirstModuleDumpRequest;  // True für ersten Request (Battery-Level-Daten)
     
     // Power and energy settings
@@ -72,20 +142,33 @@ struct CommandContext {
     uint32_t ladeLeistung;
     uint32_t entladeLeistung;
     uint32_t leseTag;
+    std::vector<uint32_t> leseTags;  // Alle mit -r angefragten Tags in Reihenfolge (leseTag = erster Tag)
+    std::vector<int> leseIntervalle; // Abfrageintervall je Tag in Sekunden (-r TAG@intervall), 0 = --interval
     uint16_t batIndex;  // Batterie-Modul Index (0 = erstes Modul)
     float epReserveWh;  // Notstromreserve in Wh (-E)
     
     // History query parameters
     char *historieDatum;        // Format: "YYYY-MM-DD" or "today"
     char *historieTyp;          // "day", "week", "month", "year"
-    uint32_t historieInterval;  // Actual interval sent to device
-    uint32_t historieSpan;      // Actual span sent to device
-    time_t historieStartTime;   // Start timestamp for display
+    char *historieVon;          // --from: erste Periode eines Zeitraums (YYYY-MM-DD oder "today")
+    char *historieBis;          // --to: letzte Periode des Zeitraums (einschließlich)
+    std::vector<HistoryPeriod> historiePerioden;  // abzufragende Perioden in zeitlicher Reihenfolge
+    size_t historieAngefragt;   // Anzahl Perioden, die bereits angefragt wurden
+    size_t historieEmpfangen;   // Anzahl Perioden, deren Antwort ausgegeben wurde
+    HistorySeriesFormat historieSerie;  // --series: Intervallwerte statt Zusammenfassung
+    OutputFormat ausgabeFormat;  // --format: Textausgabe oder JSON/JSONL/CSV-Datensätze
+    bool historieSerieKopf;     // CSV-Kopfzeile wurde bereits ausgegeben
     
     // Configuration paths
     char *configPath;
     char *tagfilePath;
-    char *tagName;  // Speichert Tag-Namen für spätere Konvertierung
+    std::vector<std::string> tagNamen;  // Speichert -r Argumente für spätere Konvertierung
+    char *socketPath;  // Unix-Socket des Daemons (--daemon bzw. --socket)
+    char *exporterListen;  // [adresse:]port des HTTP-Listeners (--exporter)
+    int pollInterval;      // Abfrageintervall des Exporters in Sekunden (--interval)
+    int holdInterval;      // Sekunden zwischen zwei Auffrischungen von -c/-d (--hold), 0 = einmal setzen
+    unsigned holdRefreshes;  // im Halte-Modus bereits gesendete Auffrischungen
+    char *storePath;       // Verzeichnis des Zeitreihen-Speichers (--store)
     
     // Constructor with defaults
     CommandContext() : 
@@ -102,9 +185,12 @@ struct CommandContext {
         batContainerQuery(false),
         modulInfoDump(false),
         setEPReserve(false),
+        daemonMode(false),
+        exporterMode(false),
         needMoreDCBRequests(false),
         currentDCBIndex(0),
         totalDCBs(0),
+        dcbBatchEnd(0),
         isFirstModuleDumpRequest(true),
         ladungsMenge(0),
         ladeLeistung(0),
@@ -112,32 +198,82 @@ struct CommandContext {
         leseTag(0),
         batIndex(0),
         epReserveWh(0.0f),
-        historieInterval(HISTORY_INTERVAL_DAY),
-        historieSpan(HISTORY_SPAN_DAY),
-        historieStartTime(0),
+        historieAngefragt(0),
+        historieEmpfangen(0),
+        historieSerie(SERIES_NONE),
+        ausgabeFormat(OUTPUT_TEXT),
+        historieSerieKopf(false),
         configPath(strdup("e3dcset.config")),
         tagfilePath(strdup("e3dcset.tags")),
-        tagName(NULL),
+        socketPath(NULL),
+        exporterListen(NULL),
+        pollInterval(10),
+        holdInterval(0),
+        holdRefreshes(0),
+        storePath(NULL),
         historieDatum(NULL),
-        historieTyp(NULL)
+        historieTyp(NULL),
+        historieVon(NULL),
+        historieBis(NULL)
     {}
 };
 
-static int iSocket = -1;
-static int iAuthenticated = 0;
+// Zustand einer RSCP-Sitzung: Verbindung, Verschlüsselung, Empfangspuffer, Konfiguration, Kommando und Ausgabe.
+// Je Thread eine Sitzung (thread_local): der Fleet-Modus (--fleet) fragt mehrere S10 gleichzeitig in Worker-Threads ab,
+// der Poller-Thread des Exporters hält seine eigene Sitzung. Neue Threads übernehmen Kommando und Konfiguration des
+// Haupt-Threads mit startSession().
+static thread_local int iSocket = -1;
+static thread_local int iAuthenticated = 0;
+static thread_local bool bConnectionLost = false;  // Socket-Fehler oder Verbindung vom S10 getrennt
+static thread_local bool bRequestFailed = false;   // Abfrage abgebrochen: History-Periode ohne Antwort oder ungültiger Frame
 
-static AES aesEncrypter;
-static AES aesDecrypter;
+static thread_local AES aesEncrypter;
+static thread_local AES aesDecrypter;
 
-static uint8_t ucEncryptionIV[AES_BLOCK_SIZE];
-static uint8_t ucDecryptionIV[AES_BLOCK_SIZE];
+static thread_local uint8_t ucEncryptionIV[AES_BLOCK_SIZE];
+static thread_local uint8_t ucDecryptionIV[AES_BLOCK_SIZE];
 
-static e3dc_config_t e3dc_config;
+// Schlüssel, für den aesEncrypter/aesDecrypter den Key-Schedule enthalten (Reconnect im Daemon-Modus)
+static thread_local uint8_t ucScheduledAesKey[AES_KEY_SIZE];
+static thread_local bool bAesKeyScheduled = false;
+
+static thread_local e3dc_config_t e3dc_config;
 
 static bool debug = false;
 
-// Globale Command Context Instanz
-static CommandContext g_ctx;
+// SIGINT/SIGTERM im Daemon- und Exporter-Modus, beendet auch das Warten auf einen Neuaufbau der Verbindung
+static volatile sig_atomic_t bDaemonStop = 0;
+
+// abgeschlossene History-Perioden je S10, nur geöffnet wenn ein Cache-Verzeichnis konfiguriert ist
+static thread_local HistoryCache g_historyCache;
+static thread_local bool g_historyReplay = false;    // Antwort stammt aus dem Cache und wird nicht erneut gespeichert
+
+// Ausgabe der Response-Handler, ein Puffer für alle Ausgaben eines Frames
+static thread_local OutputWriter g_output;
+
+// Command Context der Sitzung
+static thread_local CommandContext g_ctx;
+
+// Ergebniscodes der Antwort TAG_EMS_SET_POWER_SETTINGS je Einstellung: 0 = übernommen, > 0 = vom S10 angepasst,
+// < 0 = abgelehnt; POWER_RESULT_NONE wenn die Einstellung in der Antwort fehlt
+#define POWER_RESULT_NONE INT_MIN
+struct PowerSettingsResult {
+    bool received;
+    bool error;               // Fehlerwert statt Container (z.B. fehlende Berechtigung)
+    int limitsUsed;
+    int maxCharge;
+    int maxDischarge;
+};
+static thread_local PowerSettingsResult g_powerResult;
+static void resetPowerSettingsResult(void);
+static bool checkPowerSettingsResult(const char* prefix);
+
+// Übernimmt Kommando und Konfiguration für die Sitzung des aktuellen Threads
+static void startSession(const CommandContext & ctx, const e3dc_config_t & config)
+{
+    g_ctx = ctx;
+    e3dc_config = config;
+}
 
 // Tag-Kategorien als Enum statt Magic Numbers
 enum TagCategory {
@@ -182,7 +318,51 @@ struct TagInfo {
 };
 
 std::map<int, std::vector<TagInfo>> loadedTags;  // category -> tags
-std::map<std::string, std::string> loadedInterpretations;  // "hex:value" -> interpretation
+
+// Schlüssel einer Interpretation: Tag und Wert als Zahlen statt "0x%08X:%lld" Strings
+struct TagValueKey {
+    uint32_t tag;
+    int64_t value;
+    bool operator==(const TagValueKey& other) const { return tag == other.tag && value == other.value; }
+};
+
+struct TagValueKeyHash {
+    size_t operator()(const TagValueKey& key) const {
+        return std::hash<uint64_t>()(((uint64_t)key.tag * 0x9E3779B97F4A7C15ULL) ^ (uint64_t)key.value);
+    }
+};
+
+// Index über die geladenen Tags, wird einmal am Ende von loadTagsFile() aufgebaut (loadedTags bleibt danach unverändert)
+struct TagRegistry {
+    std::unordered_map<uint32_t, const TagInfo*> byHex;             // hex -> TagInfo (erster Eintrag gewinnt)
+    std::unordered_map<std::string, uint32_t> byName;               // Name in Großbuchstaben -> hex
+    std::unordered_map<TagValueKey, std::string, TagValueKeyHash> interpretations;  // (tag, wert) -> Interpretation
+};
+
+static TagRegistry g_tagRegistry;
+
+// Kompilierte Tag-Datenbank (--compile-tags), wenn aktuell wird die Textdatei nicht geparst
+static TagDatabase g_tagDb;
+
+static std::string upperCaseTagName(const char* name) {
+    std::string result(name);
+    for (size_t i = 0; i < result.size(); i++) {
+        result[i] = toupper((unsigned char)result[i]);
+    }
+    return result;
+}
+
+static void buildTagRegistry() {
+    g_tagRegistry.byHex.clear();
+    g_tagRegistry.byName.clear();
+    // gleiche Reihenfolge wie die frühere lineare Suche: Kategorien aufsteigend, dann Dateireihenfolge
+    for (const auto& categoryPair : loadedTags) {
+        for (const auto& tagInfo : categoryPair.second) {
+            g_tagRegistry.byHex.emplace(tagInfo.hex, &tagInfo);
+            g_tagRegistry.byName.emplace(upperCaseTagName(tagInfo.name.c_str()), tagInfo.hex);
+        }
+    }
+}
 
 // DCB-Daten-Struktur für Multi-Request-Sammlung
 struct DCBData {
@@ -249,7 +429,14 @@ void loadTagsFile(const char* filename) {
                 char* i = interp; while (*i == ' ') i++;
                 char* iEnd = i + strlen(i) - 1; while (iEnd > i && *iEnd == ' ') *iEnd-- = 0;
                 
-                loadedInterpretations[std::string(h)] = std::string(i);
+                // Schlüssel "0x01000009:2" -> (0x01000009, 2)
+                char* valueStr = strchr(h, ':');
+                if (valueStr) {
+                    TagValueKey key;
+                    key.tag = (uint32_t)strtoul(h, NULL, 16);
+                    key.value = strtoll(valueStr + 1, NULL, 10);
+                    g_tagRegistry.interpretations[key] = std::string(i);
+                }
             }
         } else if (currentCategory >= 1 && currentCategory <= 9) {
             // Tag: EMS_POWER_PV = 0x01000001 # PV-Leistung in Watt
@@ -283,7 +470,126 @@ void loadTagsFile(const char* filename) {
     }
     
     fclose(fp);
-    DEBUG("Tag-Datei '%s' erfolgreich geladen\n", filename);
+    buildTagRegistry();
+    DEBUG("Tag-Datei '%s' erfolgreich geladen (%zu Tags, %zu Interpretationen)\n", filename,
+          g_tagRegistry.byHex.size(), g_tagRegistry.interpretations.size());
+}
+
+// Tags laden: die kompilierte Datenbank <tags>.bin wird bevorzugt, wenn sie zur Textdatei passt
+// (Größe und Änderungszeit), sonst wird die Textdatei geparst
+void loadTags(const char* filename) {
+    std::string dbPath = std::string(filename) + ".bin";
+    struct stat st;
+    bool haveTextFile = (stat(filename, &st) == 0);
+    if (g_tagDb.open(dbPath.c_str(), haveTextFile ? &st : NULL)) {
+        DEBUG("Tag-Datenbank '%s' geladen (%u Tags, %u Interpretationen)\n", dbPath.c_str(),
+              g_tagDb.tagCount(), g_tagDb.interpretationCount());
+        return;
+    }
+    if (haveTextFile && access(dbPath.c_str(), F_OK) == 0) {
+        DEBUG("Tag-Datenbank '%s' veraltet oder ungültig, verwende '%s'\n", dbPath.c_str(), filename);
+    }
+    loadTagsFile(filename);
+}
+
+// Für -l: loadedTags aus der Datenbank in der Reihenfolge der Tags-Datei füllen
+static void loadTagsFromDatabase() {
+    std::vector<const TagDbEntry*> entries;
+    for (uint32_t i = 0; i < g_tagDb.tagCount(); i++) {
+        const TagDbEntry* entry = g_tagDb.entry(i);
+        if (!(entry->flags & TAGDB_FLAG_HEADER_ONLY)) {
+            entries.push_back(entry);
+        }
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const TagDbEntry* a, const TagDbEntry* b) { return a->ordinal < b->ordinal; });
+    loadedTags.clear();
+    for (const TagDbEntry* entry : entries) {
+        TagInfo info;
+        info.name = g_tagDb.string(entry->name);
+        info.hex = entry->hex;
+        info.description = g_tagDb.string(entry->description);
+        loadedTags[entry->category].push_back(info);
+    }
+}
+
+// RscpTags.h im Verzeichnis der Tags-Datei, sonst im aktuellen Verzeichnis
+static std::string findRscpHeader(const char* tagfile) {
+    std::string path(tagfile);
+    size_t slash = path.rfind('/');
+    path = (slash == std::string::npos) ? std::string("RscpTags.h") : path.substr(0, slash + 1) + "RscpTags.h";
+    if (access(path.c_str(), R_OK) != 0 && access("RscpTags.h", R_OK) == 0) {
+        path = "RscpTags.h";
+    }
+    return path;
+}
+
+// --compile-tags: Tags-Datei und die TAG_* Definitionen aus RscpTags.h in eine Binärdatei schreiben
+int compileTagDatabase(const char* tagfile, const char* output) {
+    loadTagsFile(tagfile);
+
+    TagDbWriter writer;
+    uint32_t tagCount = 0, headerCount = 0;
+    for (const auto& categoryPair : loadedTags) {
+        for (const auto& tagInfo : categoryPair.second) {
+            writer.addTag(tagInfo.name.c_str(), tagInfo.hex, tagInfo.description.c_str(), (uint16_t)categoryPair.first, 0);
+            tagCount++;
+        }
+    }
+
+    // Namen aus RscpTags.h ohne "TAG_" Prefix, nur wenn die Tags-Datei den Namen nicht schon definiert
+    std::string headerPath = findRscpHeader(tagfile);
+    FILE* fp = fopen(headerPath.c_str(), "r");
+    if (fp) {
+        char line[256], name[128];
+        unsigned int hex;
+        while (fgets(line, sizeof(line), fp)) {
+            if (sscanf(line, " #define TAG_%127s %x", name, &hex) != 2) continue;
+            std::string key = upperCaseTagName(name);
+            if (g_tagRegistry.byName.count(key)) continue;
+            g_tagRegistry.byName.emplace(key, hex);
+            writer.addTag(name, hex, "", 0, TAGDB_FLAG_HEADER_ONLY);
+            headerCount++;
+        }
+        fclose(fp);
+    } else {
+        fprintf(stderr, "Warnung: '%s' nicht gefunden, nur die Tags-Datei wird übernommen\n", headerPath.c_str());
+    }
+
+    for (const auto& interpretation : g_tagRegistry.interpretations) {
+        writer.addInterpretation(interpretation.first.tag, interpretation.first.value, interpretation.second.c_str());
+    }
+
+    struct stat st;
+    if (stat(tagfile, &st) != 0 || !writer.write(output, &st)) {
+        fprintf(stderr, "Fehler: Tag-Datenbank '%s' konnte nicht geschrieben werden\n", output);
+        return EXIT_FAILURE;
+    }
+
+    // Prüfung: die kompilierte Datenbank liefert für jeden Wert dieselbe Interpretation wie die Tags-Datei
+    TagDatabase check;
+    if (!check.open(output, &st)) {
+        fprintf(stderr, "Fehler: Tag-Datenbank '%s' konnte nicht gelesen werden\n", output);
+        return EXIT_FAILURE;
+    }
+    for (const auto& interpretation : g_tagRegistry.interpretations) {
+        const char* text = check.findInterpretation(interpretation.first.tag, interpretation.first.value);
+        if (text == NULL || interpretation.second != text) {
+            fprintf(stderr, "Fehler: Interpretation 0x%08X:%lld weicht in '%s' von der Tags-Datei ab\n",
+                    interpretation.first.tag, (long long)interpretation.first.value, output);
+            unlink(output);
+            return EXIT_FAILURE;
+        }
+    }
+    if (check.interpretationCount() != g_tagRegistry.interpretations.size()) {
+        fprintf(stderr, "Fehler: '%s' enthält %u statt %zu Interpretationen\n", output,
+                check.interpretationCount(), g_tagRegistry.interpretations.size());
+        unlink(output);
+        return EXIT_FAILURE;
+    }
+    printf("Tag-Datenbank '%s' geschrieben: %u Tags aus '%s', %u aus '%s', %zu Interpretationen\n", output,
+           tagCount, tagfile, headerCount, headerPath.c_str(), g_tagRegistry.interpretations.size());
+    return 0;
 }
 
 // Berechnet Tage im Monat (unter Berücksichtigung von Schaltjahren)
@@ -306,77 +612,249 @@ int getDaysInMonth(int month, int year) {
     return days;
 }
 
-// Konvertiert Datum zu Unix-Timestamp mit History-Typ-Anpassung (Anfang der Periode)
-time_t dateToTimestamp(const char* dateStr, const char* historyType = "day") {
+// Zerlegt "today" oder "YYYY-MM-DD" in ein Datum um 00:00 Uhr Ortszeit, beendet das Programm bei Fehlern
+static struct tm parseHistoryDate(const char* dateStr) {
     struct tm tm_date = {0};
-    time_t now;
-    int year = 0, month = 0;  // Speichern für Monats-Berechnung
-    
+
     if (strcmp(dateStr, "today") == 0) {
+        time_t now;
         time(&now);
-        struct tm* tm_now = localtime(&now);
-        tm_date = *tm_now;
-        year = tm_now->tm_year + 1900;
-        month = tm_now->tm_mon + 1;
+        localtime_r(&now, &tm_date);
     } else {
         // Parse YYYY-MM-DD Format
-        int day;
+        int year, month, day;
         if (sscanf(dateStr, "%d-%d-%d", &year, &month, &day) != 3) {
             fprintf(stderr, "Fehler: Ungültiges Datumsformat '%s'\n", dateStr);
             fprintf(stderr, "Verwenden Sie 'today' oder 'YYYY-MM-DD' (z.B. 2024-11-20)\n");
             exit(EXIT_FAILURE);
         }
-        
         tm_date.tm_year = year - 1900;  // Jahre seit 1900
         tm_date.tm_mon = month - 1;     // Monat 0-11
         tm_date.tm_mday = day;
-        tm_date.tm_isdst = -1;  // Auto-detect DST
     }
-    
+
     // Setze auf Mitternacht (00:00:00)
     tm_date.tm_hour = 0;
     tm_date.tm_min = 0;
     tm_date.tm_sec = 0;
-    
+    tm_date.tm_isdst = -1;  // Auto-detect DST
+    return tm_date;
+}
+
+// Periode des History-Typs, in der das Datum liegt (Anfang der Periode und Dauer).
+// date wird auf den Periodenbeginn normalisiert, damit nextHistoryPeriod() von dort weiterzählen kann.
+static HistoryPeriod historyPeriodAt(struct tm* date, const char* historyType) {
+    HistoryPeriod period;
+    period.span = HISTORY_SPAN_DAY;
+
     // Anpassung basierend auf History-Typ - BEVOR mktime()
     if (strcmp(historyType, "week") == 0) {
         // Berechne tm_wday erst durch mktime()
-        time_t temp = mktime(&tm_date);
-        struct tm* pTemp = localtime(&temp);
-        if (pTemp) {
+        struct tm temp = *date;
+        if (mktime(&temp) != -1) {
             // Gehe zum Montag der aktuellen Woche (tm_wday: 0=Sonntag, 1=Montag)
-            int daysToMonday = (pTemp->tm_wday == 0) ? 6 : pTemp->tm_wday - 1;
-            tm_date.tm_mday -= daysToMonday;
+            int daysToMonday = (temp.tm_wday == 0) ? 6 : temp.tm_wday - 1;
+            date->tm_mday -= daysToMonday;
         }
+        period.span = HISTORY_SPAN_WEEK;
     } else if (strcmp(historyType, "month") == 0) {
-        // Gehe zum 1. des Monats
-        tm_date.tm_mday = 1;
-        // Speichere die Tage des Monats global für später (wird in createRequestExample verwendet)
-        int daysInMonth = getDaysInMonth(month, year);
-        g_ctx.historieSpan = daysInMonth * 86400;  // Tage * Sekunden pro Tag
-        DEBUG("Monat %d/%d hat %d Tage, SPAN = %u Sekunden\n", month, year, daysInMonth, g_ctx.historieSpan);
+        // Gehe zum 1. des Monats, die Dauer hängt vom Monat ab
+        date->tm_mday = 1;
+        struct tm temp = *date;
+        mktime(&temp);
+        int daysInMonth = getDaysInMonth(temp.tm_mon + 1, temp.tm_year + 1900);
+        period.span = daysInMonth * 86400;  // Tage * Sekunden pro Tag
+        DEBUG("Monat %d/%d hat %d Tage, SPAN = %u Sekunden\n", temp.tm_mon + 1, temp.tm_year + 1900, daysInMonth, period.span);
     } else if (strcmp(historyType, "year") == 0) {
         // Gehe zum 1. Januar
-        tm_date.tm_mon = 0;
-        tm_date.tm_mday = 1;
+        date->tm_mon = 0;
+        date->tm_mday = 1;
+        period.span = HISTORY_SPAN_YEAR;
     }
-    
+
     // Jetzt finalen Timestamp berechnen
-    time_t timestamp = mktime(&tm_date);
-    if (timestamp == -1) {
+    date->tm_isdst = -1;
+    period.start = mktime(date);
+    if (period.start == -1) {
         fprintf(stderr, "Fehler: Konnte Datum nicht konvertieren\n");
         exit(EXIT_FAILURE);
     }
-    
-    DEBUG("Konvertiere Datum '%s' (Typ: %s) zu Timestamp: %ld\n", dateStr, historyType, timestamp);
-    return timestamp;
+    DEBUG("Periode (Typ: %s) ab Timestamp %ld, Dauer %u s\n", historyType, (long)period.start, period.span);
+    return period;
 }
 
-int createRequestExample(SRscpFrameBuffer * frameBuffer) {
+// Erste Periode nach der Periode, deren Beginn in date steht
+static HistoryPeriod nextHistoryPeriod(struct tm* date, const char* historyType) {
+    if (strcmp(historyType, "week") == 0) {
+        date->tm_mday += 7;
+    } else if (strcmp(historyType, "month") == 0) {
+        date->tm_mon += 1;
+    } else if (strcmp(historyType, "year") == 0) {
+        date->tm_year += 1;
+    } else {
+        date->tm_mday += 1;
+    }
+    return historyPeriodAt(date, historyType);
+}
+
+// Perioden der History-Abfrage: eine Periode für -D, alle Perioden von --from bis --to (einschließlich)
+static void setupHistoryPeriods(void) {
+    g_ctx.historiePerioden.clear();
+    g_ctx.historieAngefragt = 0;
+    g_ctx.historieEmpfangen = 0;
+
+    const char* type = g_ctx.historieTyp;
+    struct tm date = parseHistoryDate(g_ctx.historieVon ? g_ctx.historieVon : g_ctx.historieDatum);
+    HistoryPeriod period = historyPeriodAt(&date, type);
+    time_t last = period.start;
+    if (g_ctx.historieBis) {
+        struct tm end = parseHistoryDate(g_ctx.historieBis);
+        last = historyPeriodAt(&end, type).start;
+        if (last < period.start) {
+            fprintf(stderr, "Fehler: [--to] %s liegt vor [--from] %s\n", g_ctx.historieBis, g_ctx.historieVon);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    while (period.start <= last) {
+        if (g_ctx.historiePerioden.size() >= HISTORY_MAX_PERIODS) {
+            fprintf(stderr, "Fehler: Zeitraum umfasst mehr als %d Perioden\n", HISTORY_MAX_PERIODS);
+            exit(EXIT_FAILURE);
+        }
+        g_ctx.historiePerioden.push_back(period);
+        period = nextHistoryPeriod(&date, type);
+    }
+}
+
+// Request-Tag und Intervall je History-Typ, false bei unbekanntem Typ
+static bool historyRequestTag(const char* historyType, uint32_t* tag, uint32_t* interval) {
+    if (strcmp(historyType, "day") == 0) {
+        *tag = TAG_DB_REQ_HISTORY_DATA_DAY;
+        *interval = HISTORY_INTERVAL_DAY;
+    } else if (strcmp(historyType, "week") == 0) {
+        *tag = TAG_DB_REQ_HISTORY_DATA_WEEK;
+        *interval = HISTORY_INTERVAL_WEEK;
+    } else if (strcmp(historyType, "month") == 0) {
+        *tag = TAG_DB_REQ_HISTORY_DATA_MONTH;
+        *interval = HISTORY_INTERVAL_MONTH;
+    } else if (strcmp(historyType, "year") == 0) {
+        *tag = TAG_DB_REQ_HISTORY_DATA_YEAR;
+        *interval = HISTORY_INTERVAL_YEAR;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Weitere Frames nötig: DCB-Blöcke des Modul-Dumps oder noch nicht angefragte History-Perioden
+static bool needMoreRequests(void) {
+    return g_ctx.needMoreDCBRequests ||
+           (g_ctx.historieAbfrage && g_ctx.historieAngefragt < g_ctx.historiePerioden.size());
+}
+
+int handleResponseValue(RscpProtocol *protocol, SRscpValue *response);
+
+// Cache-Schlüssel einer History-Periode: genau die Parameter der Anfrage an das S10
+static bool historyCacheKey(size_t index, HistoryCacheKey *key) {
+    uint32_t interval;
+    if (!historyRequestTag(g_ctx.historieTyp, &key->requestTag, &interval)) {
+        return false;
+    }
+    key->start = (uint64_t)g_ctx.historiePerioden[index].start;
+    key->interval = interval;
+    key->span = g_ctx.historiePerioden[index].span;
+    return true;
+}
+
+// Abgeschlossene Perioden ändern sich nicht mehr und dürfen aus dem Cache beantwortet werden
+static bool historyPeriodComplete(const HistoryPeriod & period) {
+    return (time_t)(period.start + period.span + HISTORY_CACHE_MARGIN) <= time(NULL);
+}
+
+static bool historyPeriodCached(size_t index) {
+    HistoryCacheKey key;
+    return g_historyCache.isOpen() && historyPeriodComplete(g_ctx.historiePerioden[index]) &&
+           historyCacheKey(index, &key) && g_historyCache.contains(key);
+}
+
+// Öffnet den History-Cache des konfigurierten S10 (<history_cache>/<server_ip>_<port>)
+static void openHistoryCache(void) {
+    if (e3dc_config.history_cache[0] == '\0' || g_historyCache.isOpen()) {
+        return;
+    }
+    if (mkdir(e3dc_config.history_cache, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Warnung: History-Cache %s kann nicht angelegt werden (errno %i)\n", e3dc_config.history_cache, errno);
+        return;
+    }
+    char directory[320];
+    snprintf(directory, sizeof(directory), "%s/%s_%u", e3dc_config.history_cache, e3dc_config.server_ip, e3dc_config.server_port);
+    uint64_t maxBytes = e3dc_config.history_cache_mb > 0 ? (uint64_t)e3dc_config.history_cache_mb * 1024 * 1024 : HISTORY_CACHE_DEFAULT_SIZE;
+    if (!g_historyCache.open(directory, maxBytes)) {
+        fprintf(stderr, "Warnung: History-Cache %s kann nicht geöffnet werden (errno %i)\n", directory, errno);
+        return;
+    }
+    DEBUG("History-Cache %s: %zu Perioden, %llu Bytes\n", directory, g_historyCache.entries(), (unsigned long long)g_historyCache.bytes());
+}
+
+// Beantwortet die nächsten Perioden aus dem Cache, solange keine Antwort des S10 aussteht (die Ausgabe bleibt in
+// zeitlicher Reihenfolge). true, wenn danach alle Perioden beantwortet sind.
+static bool answerHistoryFromCache(void) {
+    if (g_ctx.historiePerioden.empty()) {
+        setupHistoryPeriods();
+    }
     RscpProtocol protocol;
-    SRscpValue rootValue;
-    // The root container is create with the TAG ID 0 which is not used by any device.
-    protocol.createContainerValue(&rootValue, 0);
+    std::vector<uint8_t> data;
+    while (g_ctx.historieEmpfangen == g_ctx.historieAngefragt && g_ctx.historieAngefragt < g_ctx.historiePerioden.size() &&
+           historyPeriodCached(g_ctx.historieAngefragt)) {
+        HistoryCacheKey key;
+        historyCacheKey(g_ctx.historieAngefragt, &key);
+        uint32_t tag;
+        uint8_t dataType;
+        if (!g_historyCache.load(key, &tag, &dataType, data)) {
+            break;   // beschädigter Eintrag wurde entfernt, die Periode wird beim S10 angefragt
+        }
+        SRscpValue value;
+        value.tag = tag;
+        value.dataType = dataType;
+        value.length = (uint16_t)data.size();
+        value.data = data.data();
+        DEBUG("Periode %zu aus dem History-Cache\n", g_ctx.historieAngefragt);
+        g_ctx.historieAngefragt++;
+        g_historyReplay = true;
+        handleResponseValue(&protocol, &value);
+        g_historyReplay = false;
+    }
+    // alle Perioden aus dem Cache mit einem Schreibaufruf
+    g_output.flush();
+    return g_ctx.historieEmpfangen == g_ctx.historiePerioden.size();
+}
+
+// Speichert die Antwort einer abgeschlossenen Periode; Antworten mit Fehlern werden nicht gespeichert
+static void storeHistoryResponse(RscpProtocol *protocol, size_t index, const SRscpValue *response) {
+    HistoryCacheKey key;
+    if (g_historyReplay || !g_historyCache.isOpen() || !historyPeriodComplete(g_ctx.historiePerioden[index]) ||
+        !historyCacheKey(index, &key)) {
+        return;
+    }
+    RscpValueRange historyData = protocol->getValueAsContainerView(response);
+    for (RscpValueIterator history = historyData.begin(); history != historyData.end(); ++history) {
+        if (history->dataType == RSCP::eTypeError) {
+            return;
+        }
+    }
+    if (!g_historyCache.store(key, response->tag, response->dataType, response->data, response->length)) {
+        DEBUG("History-Periode %zu konnte nicht im Cache gespeichert werden (errno %i)\n", index, errno);
+    }
+}
+
+// BAT_REQ_* Tags (0x0300xxxx) müssen in einem BAT_REQ_DATA Container angefragt werden
+static bool isBatRequestTag(uint32_t tag) {
+    return (tag & 0xFF000000) == 0x03000000 && (tag & 0x00FF0000) == 0x00000000;
+}
+
+int createRequestExample(SRscpFrameBuffer * frameBuffer) {
+    // All values are written in place into one frame buffer, container lengths are patched in endContainer()
+    RscpFrameBuilder builder;
 
     //---------------------------------------------------------------------------------------------------------
     // Create a request frame
@@ -384,102 +862,136 @@ int createRequestExample(SRscpFrameBuffer * frameBuffer) {
     if(iAuthenticated == 0){
         DEBUG("Request authentication\n");
         // authentication request
-        SRscpValue authenContainer;
-        protocol.createContainerValue(&authenContainer, TAG_RSCP_REQ_AUTHENTICATION);
-        protocol.appendValue(&authenContainer, TAG_RSCP_AUTHENTICATION_USER, e3dc_config.e3dc_user);
-        protocol.appendValue(&authenContainer, TAG_RSCP_AUTHENTICATION_PASSWORD, e3dc_config.e3dc_password);
-        // append sub-container to root container
-        protocol.appendValue(&rootValue, authenContainer);
-        // free memory of sub-container as it is now copied to rootValue
-        protocol.destroyValueData(authenContainer);
+        builder.beginContainer(TAG_RSCP_REQ_AUTHENTICATION);
+        builder.appendValue(TAG_RSCP_AUTHENTICATION_USER, e3dc_config.e3dc_user);
+        builder.appendValue(TAG_RSCP_AUTHENTICATION_PASSWORD, e3dc_config.e3dc_password);
+        builder.endContainer();
 
     }else{
 
-        if (g_ctx.werteAbfragen){
+        if (g_ctx.werteAbfragen && g_ctx.leseTags.size() > 1){
+                // Mehrere Tags in einem Frame: BAT_REQ_* Tags gemeinsam in einem BAT_REQ_DATA Container
+                bool hasBatTags = false;
+
+                for (size_t i = 0; i < g_ctx.leseTags.size(); i++) {
+                    uint32_t tag = g_ctx.leseTags[i];
+                    DEBUG("Anfrage Tag 0x%08X\n", tag);
+                    if (isBatRequestTag(tag)) {
+                        hasBatTags = true;
+                    } else {
+                        builder.appendValue(tag);
+                    }
+                }
+
+                if (hasBatTags) {
+                    builder.beginContainer(TAG_BAT_REQ_DATA);
+                    builder.appendValue(TAG_BAT_INDEX, g_ctx.batIndex);
+                    for (size_t i = 0; i < g_ctx.leseTags.size(); i++) {
+                        if (isBatRequestTag(g_ctx.leseTags[i])) {
+                            builder.appendValue(g_ctx.leseTags[i]);
+                        }
+                    }
+                    builder.endContainer();
+                }
+        } else if (g_ctx.werteAbfragen){
                 DEBUG("Anfrage Tag 0x%08X\n", g_ctx.leseTag);
                 
                 // Check if this is a BAT_REQ_* tag (0x0300xxxx range) - needs BAT_REQ_DATA container
-                if ((g_ctx.leseTag & 0xFF000000) == 0x03000000 && (g_ctx.leseTag & 0x00FF0000) == 0x00000000) {
+                if (isBatRequestTag(g_ctx.leseTag)) {
                     DEBUG("BAT_REQ_* Tag erkannt - erstelle BAT_REQ_DATA Container\n");
-                    SRscpValue batContainer;
-                    protocol.createContainerValue(&batContainer, TAG_BAT_REQ_DATA);
-                    protocol.appendValue(&batContainer, TAG_BAT_INDEX, g_ctx.batIndex);
-                    protocol.appendValue(&batContainer, g_ctx.leseTag);
-                    protocol.appendValue(&rootValue, batContainer);
-                    protocol.destroyValueData(batContainer);
+                    builder.beginContainer(TAG_BAT_REQ_DATA);
+                    builder.appendValue(TAG_BAT_INDEX, g_ctx.batIndex);
+                    builder.appendValue(g_ctx.leseTag);
+                    builder.endContainer();
                     g_ctx.batContainerQuery = true;
                 } else {
-                    protocol.appendValue(&rootValue, g_ctx.leseTag);
+                    builder.appendValue(g_ctx.leseTag);
                     g_ctx.batContainerQuery = false;
                 }
         }
         
         if (g_ctx.modulInfoDump){
-                SRscpValue batContainer;
-                protocol.createContainerValue(&batContainer, TAG_BAT_REQ_DATA);
-                protocol.appendValue(&batContainer, TAG_BAT_INDEX, g_ctx.batIndex);
-                
+                builder.beginContainer(TAG_BAT_REQ_DATA);
+                builder.appendValue(TAG_BAT_INDEX, g_ctx.batIndex);
+
                 if (g_ctx.isFirstModuleDumpRequest) {
                     // FIRST REQUEST: Get battery-level data + DCB_COUNT
-                    protocol.appendValue(&batContainer, TAG_BAT_REQ_RSOC);           // Relativer SOC
-                    protocol.appendValue(&batContainer, TAG_BAT_REQ_ASOC);           // Absoluter SOC / SOH
-                    protocol.appendValue(&batContainer, TAG_BAT_REQ_CHARGE_CYCLES);  // Ladezyklen
-                    protocol.appendValue(&batContainer, TAG_BAT_REQ_CURRENT);        // Strom
-                    protocol.appendValue(&batContainer, TAG_BAT_REQ_MODULE_VOLTAGE); // Modulspannung
-                    protocol.appendValue(&batContainer, TAG_BAT_REQ_MAX_BAT_VOLTAGE);// Max. Spannung
-                    protocol.appendValue(&batContainer, TAG_BAT_REQ_STATUS_CODE);    // Statuscode
-                    protocol.appendValue(&batContainer, TAG_BAT_REQ_ERROR_CODE);     // Fehlercode
-                    protocol.appendValue(&batContainer, TAG_BAT_REQ_DCB_COUNT);      // Anzahl DCBs - CRITICAL!
+                    builder.appendValue(TAG_BAT_REQ_RSOC);           // Relativer SOC
+                    builder.appendValue(TAG_BAT_REQ_ASOC);           // Absoluter SOC / SOH
+                    builder.appendValue(TAG_BAT_REQ_CHARGE_CYCLES);  // Ladezyklen
+                    builder.appendValue(TAG_BAT_REQ_CURRENT);        // Strom
+                    builder.appendValue(TAG_BAT_REQ_MODULE_VOLTAGE); // Modulspannung
+                    builder.appendValue(TAG_BAT_REQ_MAX_BAT_VOLTAGE);// Max. Spannung
+                    builder.appendValue(TAG_BAT_REQ_STATUS_CODE);    // Statuscode
+                    builder.appendValue(TAG_BAT_REQ_ERROR_CODE);     // Fehlercode
+                    builder.appendValue(TAG_BAT_REQ_DCB_COUNT);      // Anzahl DCBs - CRITICAL!
                 } else {
-                    // SUBSEQUENT REQUESTS: Get specific DCB data
-                    protocol.appendValue(&batContainer, TAG_BAT_REQ_DCB_INFO, (uint8_t)g_ctx.currentDCBIndex);
+                    // SUBSEQUENT REQUESTS: all DCBs in one frame, responses are matched by TAG_BAT_DCB_INDEX
+                    uint32_t batchEnd = g_ctx.currentDCBIndex + MAX_DCB_REQUESTS_PER_FRAME;
+                    if (batchEnd > g_ctx.totalDCBs) {
+                        batchEnd = g_ctx.totalDCBs;
+                    }
+                    g_ctx.dcbBatchEnd = (uint8_t)batchEnd;
+                    DEBUG("Anfrage DCB %u bis %u\n", g_ctx.currentDCBIndex, g_ctx.dcbBatchEnd - 1);
+                    for (uint32_t dcb = g_ctx.currentDCBIndex; dcb < batchEnd; dcb++) {
+                        builder.appendValue(TAG_BAT_REQ_DCB_INFO, (uint8_t)dcb);
+                    }
                 }
                 
-                protocol.appendValue(&rootValue, batContainer);
-                protocol.destroyValueData(batContainer);
+                builder.endContainer();
                 g_ctx.batContainerQuery = true;
         }
         
         if (g_ctx.historieAbfrage){
                 DEBUG("Anfrage Historie: Typ=%s, Datum=%s\n", 
-                      g_ctx.historieTyp, g_ctx.historieDatum);
+                      g_ctx.historieTyp, g_ctx.historieVon ? g_ctx.historieVon : g_ctx.historieDatum);
                 
-                // Determine which history tag to use based on type and set appropriate interval and span
-                uint32_t historyTag;
-                if (strcmp(g_ctx.historieTyp, "day") == 0) {
-                    historyTag = TAG_DB_REQ_HISTORY_DATA_DAY;
-                    g_ctx.historieInterval = HISTORY_INTERVAL_DAY;
-                    g_ctx.historieSpan = HISTORY_SPAN_DAY;
-                } else if (strcmp(g_ctx.historieTyp, "week") == 0) {
-                    historyTag = TAG_DB_REQ_HISTORY_DATA_WEEK;
-                    g_ctx.historieInterval = HISTORY_INTERVAL_WEEK;
-                    g_ctx.historieSpan = HISTORY_SPAN_WEEK;
-                } else if (strcmp(g_ctx.historieTyp, "month") == 0) {
-                    historyTag = TAG_DB_REQ_HISTORY_DATA_MONTH;
-                    g_ctx.historieInterval = HISTORY_INTERVAL_MONTH;
-                    // historieSpan wird dynamisch in dateToTimestamp() berechnet!
-                } else if (strcmp(g_ctx.historieTyp, "year") == 0) {
-                    historyTag = TAG_DB_REQ_HISTORY_DATA_YEAR;
-                    g_ctx.historieInterval = HISTORY_INTERVAL_YEAR;
-                    g_ctx.historieSpan = HISTORY_SPAN_YEAR;
-                } else {
+                // Determine which history tag to use based on type and set appropriate interval
+                uint32_t historyTag, interval;
+                if (!historyRequestTag(g_ctx.historieTyp, &historyTag, &interval)) {
                     fprintf(stderr, "FEHLER: Unbekannter History-Typ: %s\n", g_ctx.historieTyp);
                     exit(EXIT_FAILURE);
                 }
+
+                if (g_ctx.historiePerioden.empty()) {
+                    setupHistoryPeriods();
+                }
+                // abgeschlossene Perioden aus dem Cache beantworten, bevor die nächsten angefragt werden
+                answerHistoryFromCache();
+                if (g_ctx.historieEmpfangen < g_ctx.historieAngefragt) {
+                    // die Antworten werden über ihre Reihenfolge zugeordnet, ohne sie ist keine Zuordnung möglich
+                    fprintf(stderr, "Fehler: Keine Antwort für %zu History-Periode(n), Abbruch\n",
+                            g_ctx.historieAngefragt - g_ctx.historieEmpfangen);
+                    bRequestFailed = true;
+                    return -1;
+                }
                 
-                // Convert date to timestamp with correct period start
-                g_ctx.historieStartTime = dateToTimestamp(g_ctx.historieDatum, g_ctx.historieTyp);
-                
-                // Create DB_REQ_HISTORY container
-                SRscpValue historyContainer;
-                protocol.createContainerValue(&historyContainer, historyTag);
-                protocol.appendValue(&historyContainer, TAG_DB_REQ_HISTORY_TIME_START, (uint64_t)g_ctx.historieStartTime);
-                protocol.appendValue(&historyContainer, TAG_DB_REQ_HISTORY_TIME_INTERVAL, g_ctx.historieInterval);
-                protocol.appendValue(&historyContainer, TAG_DB_REQ_HISTORY_TIME_SPAN, g_ctx.historieSpan);
-                
-                // Append history container to root
-                protocol.appendValue(&rootValue, historyContainer);
-                protocol.destroyValueData(historyContainer);
+                // so viele Perioden pro Frame, wie in die Antwort des S10 passen (mindestens eine)
+                size_t perFrame = 1;
+                size_t first = g_ctx.historieAngefragt;
+                if (first < g_ctx.historiePerioden.size()) {
+                    size_t responseBytes = HISTORY_PERIOD_BYTES + (size_t)(g_ctx.historiePerioden[first].span / interval) * HISTORY_POINT_BYTES;
+                    perFrame = std::max((size_t)1, (size_t)HISTORY_RESPONSE_LIMIT / responseBytes);
+                }
+                size_t batchEnd = std::min(first + perFrame, g_ctx.historiePerioden.size());
+                for (size_t i = first; i < batchEnd; i++) {
+                    if (historyPeriodCached(i)) {
+                        // die Periode wird nach den Antworten dieses Frames aus dem Cache beantwortet
+                        batchEnd = i;
+                        break;
+                    }
+                }
+                DEBUG("Anfrage Perioden %zu bis %zu von %zu\n", first, batchEnd - 1, g_ctx.historiePerioden.size());
+
+                // Create DB_REQ_HISTORY containers, the responses come back in the same order
+                for (size_t i = first; i < batchEnd; i++) {
+                    builder.beginContainer(historyTag);
+                    builder.appendValue(TAG_DB_REQ_HISTORY_TIME_START, (uint64_t)g_ctx.historiePerioden[i].start);
+                    builder.appendValue(TAG_DB_REQ_HISTORY_TIME_INTERVAL, interval);
+                    builder.appendValue(TAG_DB_REQ_HISTORY_TIME_SPAN, g_ctx.historiePerioden[i].span);
+                    builder.endContainer();
+                }
+                g_ctx.historieAngefragt = batchEnd;
         }
 
         if (g_ctx.manuelleSpeicherladung){
@@ -490,45 +1002,42 @@ int createRequestExample(SRscpFrameBuffer * frameBuffer) {
                 } else {
                     DEBUG("  -> Anforderung: Manuelles Laden STARTEN mit %u Wh\n", g_ctx.ladungsMenge);
                 }
-                protocol.appendValue(&rootValue, TAG_EMS_REQ_START_MANUAL_CHARGE, g_ctx.ladungsMenge);
+                builder.appendValue(TAG_EMS_REQ_START_MANUAL_CHARGE, g_ctx.ladungsMenge);
         }
 
         if (g_ctx.leistungAendern){
 
-                SRscpValue PMContainer;
-                protocol.createContainerValue(&PMContainer, TAG_EMS_REQ_SET_POWER_SETTINGS);
+                builder.beginContainer(TAG_EMS_REQ_SET_POWER_SETTINGS);
 
             if (g_ctx.automatischLeistungEinstellen){
 
-              printf("Setze Lade-/EntladeLeistung auf Automatik\n");
-              protocol.appendValue(&PMContainer, TAG_EMS_POWER_LIMITS_USED, false);
+              if (g_ctx.holdRefreshes == 0) g_output.print("Setze Lade-/EntladeLeistung auf Automatik\n");
+              builder.appendValue(TAG_EMS_POWER_LIMITS_USED, false);
 
             }
 
             if (g_ctx.ladeLeistungGesetzt || g_ctx.entladeLeistungGesetzt){
 
-              protocol.appendValue(&PMContainer, TAG_EMS_POWER_LIMITS_USED, true);
+              builder.appendValue(TAG_EMS_POWER_LIMITS_USED, true);
 
               if (g_ctx.ladeLeistungGesetzt){
 
-                printf("Setze LadeLeistung auf %iW\n",g_ctx.ladeLeistung);
-                protocol.appendValue(&PMContainer, TAG_EMS_MAX_CHARGE_POWER, g_ctx.ladeLeistung);
+                if (g_ctx.holdRefreshes == 0) g_output.print("Setze LadeLeistung auf %iW\n",g_ctx.ladeLeistung);
+                builder.appendValue(TAG_EMS_MAX_CHARGE_POWER, g_ctx.ladeLeistung);
 
               }
 
               if (g_ctx.entladeLeistungGesetzt){
 
-                printf("Setze EntladeLeistung auf %iW\n",g_ctx.entladeLeistung);
-                protocol.appendValue(&PMContainer, TAG_EMS_MAX_DISCHARGE_POWER, g_ctx.entladeLeistung);
+                if (g_ctx.holdRefreshes == 0) g_output.print("Setze EntladeLeistung auf %iW\n",g_ctx.entladeLeistung);
+                builder.appendValue(TAG_EMS_MAX_DISCHARGE_POWER, g_ctx.entladeLeistung);
 
               }
 
             }
 
-                // append sub-container to root container
-            protocol.appendValue(&rootValue, PMContainer);
-            // free memory of sub-container as it is now copied to rootValue
-            protocol.destroyValueData(PMContainer);
+            // close sub-container, the length is written now
+            builder.endContainer();
 
         }
 
@@ -537,28 +1046,27 @@ int createRequestExample(SRscpFrameBuffer * frameBuffer) {
                       TAG_EP_REQ_SET_EP_RESERVE, g_ctx.epReserveWh);
                 
                 // Create EP_REQ_SET_EP_RESERVE container
-                SRscpValue epContainer;
-                protocol.createContainerValue(&epContainer, TAG_EP_REQ_SET_EP_RESERVE);
+                builder.beginContainer(TAG_EP_REQ_SET_EP_RESERVE);
                 
                 // Add parameter index (always 0 for main parameter)
-                protocol.appendValue(&epContainer, TAG_EP_PARAM_INDEX, (uint8_t)0);
+                builder.appendValue(TAG_EP_PARAM_INDEX, (uint8_t)0);
                 
                 // Add reserve energy value in Wh
-                protocol.appendValue(&epContainer, TAG_EP_PARAM_EP_RESERVE_ENERGY, g_ctx.epReserveWh);
+                builder.appendValue(TAG_EP_PARAM_EP_RESERVE_ENERGY, g_ctx.epReserveWh);
                 
-                // Append container to root
-                protocol.appendValue(&rootValue, epContainer);
-                protocol.destroyValueData(epContainer);
+                builder.endContainer();
                 
-                printf("Setze Notstromreserve auf %.0f Wh\n", g_ctx.epReserveWh);
+                g_output.print("Setze Notstromreserve auf %.0f Wh\n", g_ctx.epReserveWh);
         }
 
     }
 
-    // create buffer frame to send data to the S10
-    protocol.createFrameAsBuffer(frameBuffer, rootValue.data, rootValue.length, true); // true to calculate CRC on for transfer
-    // the root value object should be destroyed after the data is copied into the frameBuffer and is not needed anymore
-    protocol.destroyValueData(rootValue);
+    // write header and CRC, the frame buffer takes over the memory of the builder
+    int32_t iResult = builder.finish(frameBuffer, true); // true to calculate CRC on for transfer
+    if(iResult != RSCP::OK) {
+        fprintf(stderr, "Fehler beim Erstellen des Request-Frames (%i)\n", iResult);
+        return -1;
+    }
 
     return 0;
 }
@@ -571,29 +1079,41 @@ const char* getTagDescription(uint32_t tag) {
         requestTag = tag & ~0x00800000;  // Clear response bit
     }
     
-    // Search through all categories for REQUEST tag first
-    for (auto& categoryPair : loadedTags) {
-        for (auto& tagInfo : categoryPair.second) {
-            if (tagInfo.hex == requestTag) {
-                return tagInfo.description.c_str();
-            }
+    if (g_tagDb.isOpen()) {
+        const TagDbEntry* entry = g_tagDb.findByHex(requestTag);
+        if (!entry && requestTag != tag) {
+            entry = g_tagDb.findByHex(tag);
         }
+        return entry ? g_tagDb.string(entry->description) : NULL;
+    }
+
+    // Look up the REQUEST tag first
+    auto it = g_tagRegistry.byHex.find(requestTag);
+    if (it != g_tagRegistry.byHex.end()) {
+        return it->second->description.c_str();
     }
     
     // If not found and this was a RESPONSE tag, try original tag
     if (requestTag != tag) {
-        for (auto& categoryPair : loadedTags) {
-            for (auto& tagInfo : categoryPair.second) {
-                if (tagInfo.hex == tag) {
-                    return tagInfo.description.c_str();
-                }
-            }
+        it = g_tagRegistry.byHex.find(tag);
+        if (it != g_tagRegistry.byHex.end()) {
+            return it->second->description.c_str();
         }
     }
     
     return NULL;
 }
 
+// Get tag name from loaded tags (exact tag, no REQUEST/RESPONSE mapping)
+const char* getTagName(uint32_t tag) {
+    if (g_tagDb.isOpen()) {
+        const TagDbEntry* entry = g_tagDb.findByHex(tag);
+        return entry ? g_tagDb.string(entry->name) : NULL;
+    }
+    auto it = g_tagRegistry.byHex.find(tag);
+    return (it != g_tagRegistry.byHex.end()) ? it->second->name.c_str() : NULL;
+}
+
 // Format millisecond Unix epoch timestamp to human-readable string
 std::string formatTimestamp(uint64_t milliseconds) {
     time_t seconds = milliseconds / 1000;
@@ -608,10 +1128,20 @@ std::string formatTimestamp(uint64_t milliseconds) {
 
 const char* interpretValue(uint32_t tag, int64_t value) {
     // Suche Interpretation in geladenen Daten aus e3dcset.tags
-    char key[64];
-    snprintf(key, sizeof(key), "0x%08X:%lld", tag, (long long)value);
-    auto it = loadedInterpretations.find(std::string(key));
-    if (it != loadedInterpretations.end()) {
+    if (g_tagDb.isOpen()) {
+        const char* text = g_tagDb.findInterpretation(tag, value);
+        uint8_t secondByte = (tag >> 16) & 0xFF;
+        if (!text && secondByte >= 0x80) {
+            text = g_tagDb.findInterpretation((tag & 0xFF00FFFF) | (((secondByte & 0x7F) << 16)), value);
+        }
+        return text;
+    }
+    if (g_tagRegistry.interpretations.empty()) {
+        return NULL;
+    }
+    TagValueKey key = { tag, value };
+    auto it = g_tagRegistry.interpretations.find(key);
+    if (it != g_tagRegistry.interpretations.end()) {
         return it->second.c_str();
     }
     
@@ -619,10 +1149,9 @@ const char* interpretValue(uint32_t tag, int64_t value) {
     uint8_t secondByte = (tag >> 16) & 0xFF;
     if (secondByte >= 0x80) {
         // Konvertiere RESPONSE zu REQUEST: zweites Byte AND 0x7F
-        uint32_t requestTag = (tag & 0xFF00FFFF) | (((secondByte & 0x7F) << 16));
-        snprintf(key, sizeof(key), "0x%08X:%lld", requestTag, (long long)value);
-        it = loadedInterpretations.find(std::string(key));
-        if (it != loadedInterpretations.end()) {
+        key.tag = (tag & 0xFF00FFFF) | (((secondByte & 0x7F) << 16));
+        it = g_tagRegistry.interpretations.find(key);
+        if (it != g_tagRegistry.interpretations.end()) {
             return it->second.c_str();
         }
     }
@@ -631,41 +1160,523 @@ const char* interpretValue(uint32_t tag, int64_t value) {
     return NULL;
 }
 
+// DCB_COUNT der ersten Modul-Dump-Antwort (-m): Zellblöcke in weiteren Frames anfragen
+static void noteDcbCount(uint8_t dcbCount) {
+    g_ctx.totalDCBs = dcbCount;
+
+    // If we have DCBs and this is the first request, set up the multi-request loop
+    if (dcbCount > 0 && g_ctx.isFirstModuleDumpRequest) {
+        g_ctx.needMoreDCBRequests = true;
+        g_ctx.currentDCBIndex = 0;
+        g_ctx.isFirstModuleDumpRequest = false;
+    } else if (dcbCount == 0) {
+        // No DCBs - reset state
+        g_ctx.needMoreDCBRequests = false;
+        g_ctx.isFirstModuleDumpRequest = true;
+    }
+}
+
+// Antwort mit Zellblöcken empfangen: nächster Block von DCBs oder Ende des Modul-Dumps
+static void noteDcbBatchReceived(void) {
+    if (g_ctx.needMoreDCBRequests && g_ctx.modulInfoDump) {
+        g_ctx.currentDCBIndex = g_ctx.dcbBatchEnd;
+
+        // Check if we've queried all DCBs
+        if (g_ctx.currentDCBIndex >= g_ctx.totalDCBs) {
+            g_ctx.needMoreDCBRequests = false;
+            g_ctx.isFirstModuleDumpRequest = true;  // Reset for next dump
+        }
+    }
+}
+
+// Eine Wertzeile: prefix, Wert und ggf. " (Interpretation)"
+static void printValueLine(const char* prefix, const char* valueStr, const char* interp) {
+    g_output.write(prefix);
+    g_output.write(valueStr);
+    if (interp) {
+        g_output.write(" (");
+        g_output.write(interp);
+        g_output.write(')');
+    }
+    g_output.write('\n');
+}
+
+// Bezeichnung eines Werts im Modul-Dump: Beschreibung aus e3dcset.tags oder der Tag als Hex-Wert
+static void printTagLabel(uint32_t tag) {
+    const char* label = getTagDescription(tag);
+    if (label) {
+        g_output.write(label);
+        g_output.write('\n');
+    } else {
+        g_output.print("Tag 0x%08X:\n", tag);
+    }
+}
+
+// Werte eines Zellblocks in einem TAG_BAT_DCB_INFO Container: ab first bis zum nächsten BAT_DCB_INDEX
+struct DcbSection {
+    uint8_t index;
+    RscpValueIterator first;
+};
+
+// Wert eines Zellblocks im Modul-Dump, mit 2 Leerzeichen Abstand
+static void printDcbValue(RscpProtocol *protocol, SRscpValue *value) {
+    g_output.write("  ");
+    switch(value->dataType) {
+        case RSCP::eTypeBool:
+            g_output.write(protocol->getValueAsBool(value) ? "true" : "false");
+            break;
+        case RSCP::eTypeChar8:
+            g_output.writeInt(protocol->getValueAsChar8(value));
+            break;
+        case RSCP::eTypeUChar8:
+            g_output.writeUInt(protocol->getValueAsUChar8(value));
+            break;
+        case RSCP::eTypeInt16:
+            g_output.writeInt(protocol->getValueAsInt16(value));
+            break;
+        case RSCP::eTypeUInt16:
+            g_output.writeUInt(protocol->getValueAsUInt16(value));
+            break;
+        case RSCP::eTypeInt32:
+            g_output.writeInt(protocol->getValueAsInt32(value));
+            break;
+        case RSCP::eTypeUInt32:
+            g_output.writeUInt(protocol->getValueAsUInt32(value));
+            break;
+        case RSCP::eTypeInt64:
+            g_output.writeInt(protocol->getValueAsInt64(value));
+            break;
+        case RSCP::eTypeUInt64: {
+            uint64_t uValue = protocol->getValueAsUInt64(value);
+            // Special formatting for timestamp tags
+            if (value->tag == TAG_BAT_DCB_LAST_MESSAGE_TIMESTAMP) {
+                time_t seconds = uValue / 1000;
+                struct tm timeinfo;
+                localtime_r(&seconds, &timeinfo);
+                char timeStr[64];
+                g_output.write(timeStr, strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &timeinfo));
+            } else {
+                g_output.writeUInt(uValue);
+            }
+            break;
+        }
+        case RSCP::eTypeFloat32:
+            g_output.writeFixed(protocol->getValueAsFloat32(value), 2);
+            break;
+        case RSCP::eTypeDouble64:
+            g_output.writeFixed(protocol->getValueAsDouble64(value), 4);
+            break;
+        case RSCP::eTypeString: {
+            size_t length = value->data ? strnlen((const char*)value->data, value->length) : 0;
+            if (length == 0) {
+                g_output.write("(leer)");
+            } else {
+                g_output.write((const char*)value->data, length);
+            }
+            break;
+        }
+        case RSCP::eTypeBitfield: {
+            // Bitfield als Hex ausgeben
+            uint32_t bitfield = 0;
+            if (value->length == 1) {
+                bitfield = protocol->getValueAsUChar8(value);
+            } else if (value->length == 2) {
+                bitfield = protocol->getValueAsUInt16(value);
+            } else if (value->length == 4) {
+                bitfield = protocol->getValueAsUInt32(value);
+            }
+            g_output.print("0x%0*X", value->length * 2, bitfield);
+            break;
+        }
+        case RSCP::eTypeByteArray: {
+            // ByteArray als Hex ausgeben
+            static const char hex[] = "0123456789ABCDEF";
+            g_output.write("0x");
+            for (uint16_t k = 0; k < value->length; k++) {
+                g_output.write(hex[value->data[k] >> 4]);
+                g_output.write(hex[value->data[k] & 0x0F]);
+            }
+            break;
+        }
+        default:
+            g_output.print("(Typ %d)", value->dataType);
+            break;
+    }
+    g_output.write('\n');
+}
+
 // Unified value formatter - eliminiert Code-Duplikation in Response-Handling
 void printFormattedValue(uint32_t tag, const char* valueStr, int64_t numericValue) {
-    if (g_ctx.quietMode) {
-        printf("%s\n", valueStr);
+    printValueLine("", valueStr, g_ctx.quietMode ? NULL : interpretValue(tag, numericValue));
+}
+
+// Spalten der Intervallwerte (--series) in Ausgabereihenfolge
+static const struct {
+    uint32_t tag;
+    const char *name;
+} historySeriesColumns[] = {
+    {TAG_DB_GRAPH_INDEX,      "graph_index"},
+    {TAG_DB_DC_POWER,         "pv"},
+    {TAG_DB_BAT_POWER_IN,     "bat_in"},
+    {TAG_DB_BAT_POWER_OUT,    "bat_out"},
+    {TAG_DB_GRID_POWER_IN,    "grid_in"},
+    {TAG_DB_GRID_POWER_OUT,   "grid_out"},
+    {TAG_DB_CONSUMPTION,      "consumption"},
+    {TAG_DB_BAT_CHARGE_LEVEL, "soc"},
+    {TAG_DB_AUTARKY,          "autarky"},
+};
+#define HISTORY_SERIES_COLUMNS (sizeof(historySeriesColumns) / sizeof(historySeriesColumns[0]))
+
+// Zahlenwert eines DB-Tags; das S10 liefert Floats, GRAPH_INDEX je nach Firmware auch als Ganzzahl
+static double historySeriesNumber(RscpProtocol *protocol, const SRscpValueView *value) {
+    switch (value->dataType) {
+        case RSCP::eTypeFloat32:  return protocol->getValueAsFloat32(value);
+        case RSCP::eTypeDouble64: return protocol->getValueAsDouble64(value);
+        case RSCP::eTypeUChar8:   return protocol->getValueAsUChar8(value);
+        case RSCP::eTypeInt32:    return protocol->getValueAsInt32(value);
+        case RSCP::eTypeUInt32:   return protocol->getValueAsUInt32(value);
+        case RSCP::eTypeUInt64:   return (double)protocol->getValueAsUInt64(value);
+        default:                  return NAN;
+    }
+}
+
+// Gibt einen DB_VALUE_CONTAINER als CSV- bzw. JSONL-Zeile aus. Die Werte werden direkt aus dem Frame
+// gelesen (Container-View), fehlende Werte bleiben in CSV leer bzw. sind in JSON null.
+// Zeitpunkt des Intervalls = Beginn der Periode + GRAPH_INDEX * Intervall
+static void printHistorySeriesRow(RscpProtocol *protocol, const SRscpValueView *container,
+                                  const HistoryPeriod & period, uint32_t interval) {
+    double values[HISTORY_SERIES_COLUMNS];
+    for (size_t c = 0; c < HISTORY_SERIES_COLUMNS; c++) {
+        values[c] = NAN;
+    }
+    RscpValueRange point = protocol->getValueAsContainerView(container);
+    for (RscpValueIterator value = point.begin(); value != point.end(); ++value) {
+        for (size_t c = 0; c < HISTORY_SERIES_COLUMNS; c++) {
+            if (historySeriesColumns[c].tag == value->tag) {
+                values[c] = historySeriesNumber(protocol, &*value);
+                break;
+            }
+        }
+    }
+
+    double index = std::isnan(values[0]) ? 0 : values[0];
+    time_t time = period.start + (time_t)llround(index * interval);
+    char timeStr[32] = "";
+    struct tm timeTm;
+    if (localtime_r(&time, &timeTm)) {
+        strftime(timeStr, sizeof(timeStr), "%Y-%m-%dT%H:%M:%S", &timeTm);
+    }
+
+    bool json = g_ctx.historieSerie == SERIES_JSONL;
+    if (json) {
+        g_output.write("{\"time\":\"");
+        g_output.write(timeStr);
+        g_output.write("\",\"ts\":");
     } else {
-        const char* interp = interpretValue(tag, numericValue);
-        if (interp) {
-            printf("%s (%s)\n", valueStr, interp);
+        g_output.write(timeStr);
+        g_output.write(',');
+    }
+    g_output.writeInt(time);
+    for (size_t c = 0; c < HISTORY_SERIES_COLUMNS; c++) {
+        if (json) {
+            g_output.write(",\"");
+            g_output.write(historySeriesColumns[c].name);
+            g_output.write("\":");
         } else {
-            printf("%s\n", valueStr);
+            g_output.write(',');
+        }
+        if (std::isfinite(values[c])) {
+            char number[32];
+            g_output.write(number, OutputWriter::formatGeneral(number, sizeof(number), values[c], 7));
+        } else if (json) {
+            g_output.write("null");
         }
     }
+    g_output.write(json ? "}\n" : "\n");
 }
 
-int handleResponseValue(RscpProtocol *protocol, SRscpValue *response) {
-    // check if any of the response has the error flag set and react accordingly
-    if(response->dataType == RSCP::eTypeError) {
-        // handle error for example access denied errors
-        uint32_t uiErrorCode = protocol->getValueAsUInt32(response);
-        printf("Tag 0x%08X received error code %u.\n", response->tag, uiErrorCode);
-        return -1;
+// RSCP-Datentyp als Text (--format)
+static const char* rscpTypeName(uint8_t dataType) {
+    static const char* names[] = {
+        "None", "Bool", "Char8", "UChar8", "Int16", "UInt16", "Int32", "UInt32", "Int64", "UInt64",
+        "Float32", "Double64", "Bitfield", "String", "Container", "Timestamp", "ByteArray"
+    };
+    if (dataType < sizeof(names) / sizeof(names[0])) {
+        return names[dataType];
     }
+    return dataType == RSCP::eTypeError ? "Error" : "Unknown";
+}
 
-    // check the SRscpValue TAG to detect which response it is
-    switch(response->tag){
-    case TAG_RSCP_AUTHENTICATION: {
-        // It is possible to check the response->dataType value to detect correct data type
-        // and call the correct function. If data type is known,
-        // the correct function can be called directly like in this case.
-        uint8_t ucAccessLevel = protocol->getValueAsUChar8(response);
-        if(ucAccessLevel > 0) {
-            iAuthenticated = 1;
+// Einheit aus der Beschreibung in e3dcset.tags, z.B. "Modulspannung (V)" oder "PV-Leistung in Watt"
+static const char* tagUnit(uint32_t tag) {
+    static const struct {
+        const char* pattern;
+        const char* unit;
+    } units[] = {
+        {"(Wh)", "Wh"}, {"(W)", "W"}, {"(V)", "V"}, {"(A)", "A"}, {"(%)", "%"}, {"(°C)", "°C"},
+        {"in Wh", "Wh"}, {"in Watt", "W"}, {"in Prozent", "%"}, {"in Sekunden", "s"}
+    };
+    const char* description = getTagDescription(tag);
+    if (!description) {
+        return NULL;
+    }
+    for (size_t i = 0; i < sizeof(units) / sizeof(units[0]); i++) {
+        if (strstr(description, units[i].pattern)) {
+            return units[i].unit;
         }
-        DEBUG("RSCP authentitication level %i\n", ucAccessLevel);
-        break;
+    }
+    return NULL;
+}
+
+// Millisekunden-Zeitstempel (2020-2040) wie in der Textausgabe als Ortszeit
+static const char* formatMillisecondTime(uint64_t value, char* buffer, size_t size) {
+    if (value <= 1577836800000ULL || value >= 2209075200000ULL) {
+        return NULL;
+    }
+    time_t seconds = (time_t)(value / 1000);
+    struct tm timeinfo;
+    localtime_r(&seconds, &timeinfo);
+    size_t n = strftime(buffer, size, "%Y-%m-%d %H:%M:%S", &timeinfo);
+    snprintf(buffer + n, size - n, ".%03u", (unsigned)(value % 1000));
+    return buffer;
+}
+
+// --format: ein Wert als Datensatz. Container werden rekursiv ausgegeben, BAT_INDEX und BAT_DCB_INDEX sind
+// keine eigenen Datensätze, sondern bat bzw. dcb der folgenden Werte.
+static void outputValue(RscpProtocol *protocol, SRscpValue *value, int bat, int dcb, const char *period) {
+    if (value->dataType == RSCP::eTypeContainer) {
+        RscpValueRange children = protocol->getValueAsContainerView(value);
+        for (RscpValueIterator it = children.begin(); it != children.end(); ++it) {
+            SRscpValue child = protocol->getValueFromView(*it);
+            if (child.tag == TAG_BAT_INDEX && child.dataType != RSCP::eTypeError) {
+                bat = protocol->getValueAsUInt16(&child);
+            } else if (child.tag == TAG_BAT_DCB_INDEX && child.dataType != RSCP::eTypeError) {
+                dcb = protocol->getValueAsUChar8(&child);
+            } else {
+                outputValue(protocol, &child, bat, dcb, period);
+            }
+        }
+        return;
+    }
+
+    OutputRecord record;
+    record.tag = value->tag;
+    record.name = getTagName(value->tag);
+    if (!record.name && (value->tag & 0x00800000)) {
+        // e3dcset.tags kennt viele Werte nur unter dem Namen des REQUEST Tags
+        record.name = getTagName(value->tag & ~0x00800000);
+    }
+    record.type = rscpTypeName(value->dataType);
+    record.unit = tagUnit(value->tag);
+    record.bat = bat;
+    record.dcb = dcb;
+    record.period = period;
+    // einzeln abgefragte BAT_* Werte (-r) gehören zum Modul -i
+    if (record.bat < 0 && (value->tag & 0xFFF00000) == 0x03800000) {
+        record.bat = g_ctx.batIndex;
+    }
+
+    char text[80];
+    std::string str;
+    switch (value->dataType) {
+        case RSCP::eTypeBool:
+            record.kind = OUTPUT_VALUE_BOOL;
+            record.boolean = protocol->getValueAsBool(value);
+            record.interpretation = interpretValue(value->tag, record.boolean ? 1 : 0);
+            break;
+        case RSCP::eTypeChar8:
+        case RSCP::eTypeInt16:
+        case RSCP::eTypeInt32:
+            record.kind = OUTPUT_VALUE_INT;
+            record.integer = value->dataType == RSCP::eTypeChar8 ? protocol->getValueAsChar8(value) :
+                             value->dataType == RSCP::eTypeInt16 ? protocol->getValueAsInt16(value) :
+                                                                   protocol->getValueAsInt32(value);
+            record.interpretation = interpretValue(value->tag, record.integer);
+            break;
+        case RSCP::eTypeUChar8:
+        case RSCP::eTypeUInt16:
+        case RSCP::eTypeUInt32:
+            record.kind = OUTPUT_VALUE_UINT;
+            record.unsignedInteger = value->dataType == RSCP::eTypeUChar8 ? protocol->getValueAsUChar8(value) :
+                                     value->dataType == RSCP::eTypeUInt16 ? protocol->getValueAsUInt16(value) :
+                                                                            protocol->getValueAsUInt32(value);
+            record.interpretation = interpretValue(value->tag, (int64_t)record.unsignedInteger);
+            break;
+        case RSCP::eTypeInt64:
+            record.kind = OUTPUT_VALUE_INT;
+            record.integer = protocol->getValueAsInt64(value);
+            record.interpretation = record.integer > 0 ? formatMillisecondTime(record.integer, text, sizeof(text)) : NULL;
+            break;
+        case RSCP::eTypeUInt64:
+            record.kind = OUTPUT_VALUE_UINT;
+            record.unsignedInteger = protocol->getValueAsUInt64(value);
+            record.interpretation = formatMillisecondTime(record.unsignedInteger, text, sizeof(text));
+            break;
+        case RSCP::eTypeBitfield:
+            record.kind = OUTPUT_VALUE_UINT;
+            record.unsignedInteger = value->length == 1 ? protocol->getValueAsUChar8(value) :
+                                     value->length == 2 ? protocol->getValueAsUInt16(value) :
+                                                          protocol->getValueAsUInt32(value);
+            break;
+        case RSCP::eTypeFloat32:
+            record.kind = OUTPUT_VALUE_FLOAT;
+            record.number = protocol->getValueAsFloat32(value);
+            record.precision = 7;
+            record.interpretation = interpretValue(value->tag, std::llround(record.number));
+            break;
+        case RSCP::eTypeDouble64:
+            record.kind = OUTPUT_VALUE_FLOAT;
+            record.number = protocol->getValueAsDouble64(value);
+            record.precision = 17;
+            break;
+        case RSCP::eTypeTimestamp: {
+            // Sekunden mit Millisekunden als Zahl, Ortszeit als Interpretation
+            SRscpTimestamp ts = protocol->getValueAsTimestamp(value);
+            record.kind = OUTPUT_VALUE_FLOAT;
+            record.number = ts.seconds + (ts.nanoseconds / 1000000) / 1000.0;
+            record.precision = 16;
+            record.interpretation = formatMillisecondTime(ts.seconds * 1000ULL + ts.nanoseconds / 1000000, text, sizeof(text));
+            break;
+        }
+        case RSCP::eTypeString:
+            record.kind = OUTPUT_VALUE_STRING;
+            record.text = (const char*)value->data;
+            record.textLength = value->data ? value->length : 0;
+            break;
+        case RSCP::eTypeByteArray:
+            // Hex-String
+            for (uint16_t i = 0; i < value->length; i++) {
+                snprintf(text, sizeof(text), "%02X", value->data[i]);
+                str += text;
+            }
+            record.kind = OUTPUT_VALUE_STRING;
+            record.text = str.c_str();
+            record.textLength = str.size();
+            break;
+        case RSCP::eTypeError:
+            record.kind = OUTPUT_VALUE_UINT;
+            record.unsignedInteger = protocol->getValueAsUInt32(value);
+            record.unit = NULL;
+            break;
+        default:
+            break;
+    }
+    g_output.record(record);
+}
+
+// --format mit -H: Summen einer Periode, period = erster Tag der Periode
+static void outputHistorySums(RscpProtocol *protocol, SRscpValue *response, const HistoryPeriod & period) {
+    char periodStr[16] = "";
+    time_t start = period.start;
+    struct tm startTm;
+    if (localtime_r(&start, &startTm)) {
+        strftime(periodStr, sizeof(periodStr), "%Y-%m-%d", &startTm);
+    }
+    RscpValueRange historyData = protocol->getValueAsContainerView(response);
+    for (RscpValueIterator history = historyData.begin(); history != historyData.end(); ++history) {
+        SRscpValue value = protocol->getValueFromView(*history);
+        if (value.dataType == RSCP::eTypeError) {
+            outputValue(protocol, &value, -1, -1, periodStr);
+        } else if (value.tag == TAG_DB_SUM_CONTAINER) {
+            RscpValueRange sumData = protocol->getValueAsContainerView(&value);
+            for (RscpValueIterator sum = sumData.begin(); sum != sumData.end(); ++sum) {
+                if (sum->tag != TAG_DB_GRAPH_INDEX) {
+                    SRscpValue sumValue = protocol->getValueFromView(*sum);
+                    outputValue(protocol, &sumValue, -1, -1, periodStr);
+                }
+            }
+        }
+    }
+}
+
+// --format mit BAT_DATA: alle Werte des Moduls und der Zellblöcke, Zustand des Modul-Dumps wie in der Textausgabe
+static void outputBatteryData(RscpProtocol *protocol, SRscpValue *response) {
+    outputValue(protocol, response, -1, -1, NULL);
+
+    bool receivedDCBData = false;
+    RscpValueRange batteryData = protocol->getValueAsContainerView(response);
+    for (RscpValueIterator it = batteryData.begin(); it != batteryData.end(); ++it) {
+        if (it->dataType == RSCP::eTypeError) {
+            continue;
+        }
+        if (it->tag == TAG_BAT_DCB_COUNT && g_ctx.modulInfoDump) {
+            noteDcbCount(protocol->getValueAsUChar8(&*it));
+        } else if (it->tag == TAG_BAT_DCB_INFO) {
+            receivedDCBData = true;
+        }
+    }
+    if (receivedDCBData) {
+        noteDcbBatchReceived();
+    }
+    g_ctx.batContainerQuery = false;
+}
+
+// Ergebniscodes der Antwort TAG_EMS_SET_POWER_SETTINGS, geprüft von checkPowerSettingsResult()
+static void recordPowerSettingsResult(RscpProtocol *protocol, SRscpValue *response) {
+    g_powerResult.received = true;
+    std::vector<SRscpValue> settings = protocol->getValueAsContainer(response);
+    for (size_t i = 0; i < settings.size(); i++) {
+        if (settings[i].dataType == RSCP::eTypeError) {
+            g_powerResult.error = true;
+        } else if (settings[i].tag == TAG_EMS_RES_POWER_LIMITS_USED) {
+            g_powerResult.limitsUsed = protocol->getValueAsChar8(&settings[i]);
+        } else if (settings[i].tag == TAG_EMS_RES_MAX_CHARGE_POWER) {
+            g_powerResult.maxCharge = protocol->getValueAsChar8(&settings[i]);
+        } else if (settings[i].tag == TAG_EMS_RES_MAX_DISCHARGE_POWER) {
+            g_powerResult.maxDischarge = protocol->getValueAsChar8(&settings[i]);
+        }
+    }
+    protocol->destroyValueData(settings);
+}
+
+int handleResponseValue(RscpProtocol *protocol, SRscpValue *response) {
+    // check if any of the response has the error flag set and react accordingly
+    if(response->dataType == RSCP::eTypeError) {
+        // handle error for example access denied errors
+        uint32_t uiErrorCode = protocol->getValueAsUInt32(response);
+        if (g_output.structured()) {
+            outputValue(protocol, response, -1, -1, NULL);
+        } else if (g_ctx.historieSerie != SERIES_NONE) {
+            // mit --series bleibt stdout reines CSV/JSONL
+            fprintf(stderr, "Tag 0x%08X received error code %u.\n", response->tag, uiErrorCode);
+        } else {
+            g_output.print("Tag 0x%08X received error code %u.\n", response->tag, uiErrorCode);
+        }
+        if (g_ctx.historieAbfrage && (response->tag == TAG_DB_HISTORY_DATA_DAY || response->tag == TAG_DB_HISTORY_DATA_WEEK ||
+                                      response->tag == TAG_DB_HISTORY_DATA_MONTH || response->tag == TAG_DB_HISTORY_DATA_YEAR)) {
+            // abgelehnte Periode: die folgenden Antworten gehören zu den nächsten Perioden
+            g_ctx.historieEmpfangen++;
+        }
+        if (response->tag == TAG_EMS_SET_POWER_SETTINGS) {
+            g_powerResult.received = true;
+            g_powerResult.error = true;
+        }
+        return -1;
+    }
+
+    // --format: Datensätze statt Text; BAT_DATA und History-Antworten führen zusätzlich ihren Abfragezustand
+    if (g_output.structured() && response->tag != TAG_RSCP_AUTHENTICATION && response->tag != TAG_BAT_DATA &&
+        response->tag != TAG_DB_HISTORY_DATA_DAY && response->tag != TAG_DB_HISTORY_DATA_WEEK &&
+        response->tag != TAG_DB_HISTORY_DATA_MONTH && response->tag != TAG_DB_HISTORY_DATA_YEAR) {
+        if (response->tag == TAG_EMS_SET_POWER_SETTINGS) {
+            recordPowerSettingsResult(protocol, response);
+        }
+        outputValue(protocol, response, -1, -1, NULL);
+        return 0;
+    }
+
+    // check the SRscpValue TAG to detect which response it is
+    switch(response->tag){
+    case TAG_RSCP_AUTHENTICATION: {
+        // It is possible to check the response->dataType value to detect correct data type
+        // and call the correct function. If data type is known,
+        // the correct function can be called directly like in this case.
+        uint8_t ucAccessLevel = protocol->getValueAsUChar8(response);
+        if(ucAccessLevel > 0) {
+            iAuthenticated = 1;
+        }
+        DEBUG("RSCP authentitication level %i\n", ucAccessLevel);
+        break;
     }
     case TAG_EMS_START_MANUAL_CHARGE: {
         DEBUG("Empfange TAG_EMS_START_MANUAL_CHARGE (0x%08X) Response\n", response->tag);
@@ -676,14 +1687,14 @@ int handleResponseValue(RscpProtocol *protocol, SRscpValue *response) {
         
         if (result){
                 if (g_ctx.ladungsMenge == 0){
-                        printf("Manuelles Laden gestoppt\n");
+                        g_output.print("Manuelles Laden gestoppt\n");
                         DEBUG("  -> Erfolgreich: Ladevorgang wurde gestoppt\n");
                 }else{
-                        printf("Manuelles Laden gestartet\n");
+                        g_output.print("Manuelles Laden gestartet\n");
                         DEBUG("  -> Erfolgreich: Ladevorgang mit %u Wh gestartet\n", g_ctx.ladungsMenge);
                 }
         }else{
-                printf("Manuelles Laden abgelehnt.\n");
+                g_output.print("Manuelles Laden abgelehnt.\n");
                 DEBUG("  -> ABGELEHNT: E3DC hat den Ladebefehl nicht akzeptiert!\n");
                 DEBUG("     Mögliche Gründe:\n");
                 DEBUG("     - Batterie bereits voll (SOC 100%%)\n");
@@ -714,56 +1725,61 @@ int handleResponseValue(RscpProtocol *protocol, SRscpValue *response) {
             protocol->destroyValueData(epData[i]);
         }
         
-        printf("Notstromreserve gesetzt: %.0f Wh (%.1f%%)\n", reserveWh, reservePercent);
+        g_output.print("Notstromreserve gesetzt: %.0f Wh (%.1f%%)\n", reserveWh, reservePercent);
         break;
     }
     case TAG_EMS_POWER_PV: {    // response for TAG_EMS_REQ_POWER_PV
         int32_t iPower = protocol->getValueAsInt32(response);
         if (g_ctx.quietMode) {
-            printf("%i\n", iPower);
+            g_output.print("%i\n", iPower);
         } else {
-            printf("EMS PV power is %i W\n", iPower);
+            g_output.print("EMS PV power is %i W\n", iPower);
         }
         break;
     }
     case TAG_EMS_POWER_BAT: {    // response for TAG_EMS_REQ_POWER_BAT
         int32_t iPower = protocol->getValueAsInt32(response);
         if (g_ctx.quietMode) {
-            printf("%i\n", iPower);
+            g_output.print("%i\n", iPower);
         } else {
-            printf("EMS BAT power is %i W\n", iPower);
+            g_output.print("EMS BAT power is %i W\n", iPower);
         }
         break;
     }
     case TAG_EMS_POWER_HOME: {    // response for TAG_EMS_REQ_POWER_HOME
         int32_t iPower = protocol->getValueAsInt32(response);
         if (g_ctx.quietMode) {
-            printf("%i\n", iPower);
+            g_output.print("%i\n", iPower);
         } else {
-            printf("EMS house power is %i W\n", iPower);
+            g_output.print("EMS house power is %i W\n", iPower);
         }
         break;
     }
     case TAG_EMS_POWER_GRID: {    // response for TAG_EMS_REQ_POWER_GRID
         int32_t iPower = protocol->getValueAsInt32(response);
         if (g_ctx.quietMode) {
-            printf("%i\n", iPower);
+            g_output.print("%i\n", iPower);
         } else {
-            printf("EMS grid power is %i W\n", iPower);
+            g_output.print("EMS grid power is %i W\n", iPower);
         }
         break;
     }
     case TAG_EMS_POWER_ADD: {    // response for TAG_EMS_REQ_POWER_ADD
         int32_t iPower = protocol->getValueAsInt32(response);
         if (g_ctx.quietMode) {
-            printf("%i\n", iPower);
+            g_output.print("%i\n", iPower);
         } else {
-            printf("EMS add power meter power is %i W\n", iPower);
+            g_output.print("EMS add power meter power is %i W\n", iPower);
         }
         break;
     }
     case TAG_BAT_DATA: {        // response for TAG_BAT_REQ_DATA
-        std::vector<SRscpValue> batteryData = protocol->getValueAsContainer(response);
+        if (g_output.structured()) {
+            outputBatteryData(protocol, response);
+            break;
+        }
+        // the values are read in place inside the receive buffer, nothing is copied
+        RscpValueRange batteryData = protocol->getValueAsContainerView(response);
         
         // Calculate expected response tag from request tag (REQUEST 0x03xxxx -> RESPONSE 0x38xxxx)
         uint32_t expectedResponseTag = 0;
@@ -774,290 +1790,126 @@ int handleResponseValue(RscpProtocol *protocol, SRscpValue *response) {
         bool foundRequestedTag = false;
         bool receivedDCBData = false;  // Track if this response contained actual DCB data
         
+        // DCB sections of all TAG_BAT_DCB_INFO containers in this response, printed in DCB index order below;
+        // the vector keeps its capacity from frame to frame
+        static thread_local std::vector<DcbSection> dcbSections;
+        dcbSections.clear();
+        
         // Print header for module info dump (only on first call for this module)
         if (g_ctx.modulInfoDump && !g_ctx.quietMode && g_ctx.isFirstModuleDumpRequest) {
-            printf("Batterie Modul %u:\n", g_ctx.batIndex);
+            g_output.print("Batterie Modul %u:\n", g_ctx.batIndex);
         }
         
-        for(size_t i = 0; i < batteryData.size(); ++i) {
+        for(RscpValueIterator it = batteryData.begin(); it != batteryData.end(); ++it) {
+            SRscpValue value = protocol->getValueFromView(*it);
             // Check for errors first - stop processing if error found
-            if(batteryData[i].dataType == RSCP::eTypeError) {
-                uint32_t uiErrorCode = protocol->getValueAsUInt32(&batteryData[i]);
+            if(value.dataType == RSCP::eTypeError) {
+                uint32_t uiErrorCode = protocol->getValueAsUInt32(&value);
                 // Always output errors to stderr (quiet-mode contract)
-                fprintf(stderr, "Fehler: Tag 0x%08X, Code %u\n", batteryData[i].tag, uiErrorCode);
-                // Clean up vector elements
-                for(size_t j = 0; j < batteryData.size(); ++j) {
-                    protocol->destroyValueData(&batteryData[j]);
-                }
+                fprintf(stderr, "Fehler: Tag 0x%08X, Code %u\n", it->tag, uiErrorCode);
                 g_ctx.batContainerQuery = false;  // Reset flag
                 return -1;  // Stop processing after error
             }
             
             // Skip BAT_INDEX in output (BAT_DCB_INFO is handled in container case)
-            if (batteryData[i].tag == TAG_BAT_INDEX) {
+            if (it->tag == TAG_BAT_INDEX) {
                 continue;
             }
             
             // Special handling for DCB_COUNT in module dump mode
-            if (batteryData[i].tag == TAG_BAT_DCB_COUNT && g_ctx.modulInfoDump) {
-                uint8_t dcbCount = protocol->getValueAsUChar8(&batteryData[i]);
-                g_ctx.totalDCBs = dcbCount;
-                
-                // If we have DCBs and this is the first request, set up the multi-request loop
-                if (dcbCount > 0 && g_ctx.isFirstModuleDumpRequest) {
-                    g_ctx.needMoreDCBRequests = true;
-                    g_ctx.currentDCBIndex = 0;
-                    g_ctx.isFirstModuleDumpRequest = false;
-                } else if (dcbCount == 0) {
-                    // No DCBs - reset state
-                    g_ctx.needMoreDCBRequests = false;
-                    g_ctx.isFirstModuleDumpRequest = true;
-                }
+            if (it->tag == TAG_BAT_DCB_COUNT && g_ctx.modulInfoDump) {
+                noteDcbCount(protocol->getValueAsUChar8(&value));
                 // Continue to print DCB_COUNT in output
             }
             
             // In quiet mode (single tag query), only process the requested tag's value
-            if (g_ctx.quietMode && !g_ctx.modulInfoDump && batteryData[i].tag != expectedResponseTag) {
+            if (g_ctx.quietMode && !g_ctx.modulInfoDump && it->tag != expectedResponseTag) {
                 continue;
             }
             
             // Mark that we found the requested tag
-            if (batteryData[i].tag == expectedResponseTag) {
+            if (it->tag == expectedResponseTag) {
                 foundRequestedTag = true;
             }
             
             // Print tag prefix - formatted for module dump, raw for single query
             // Skip printing BAT_DCB_INFO tag itself (only print its contents)
-            if (!g_ctx.quietMode && batteryData[i].tag != TAG_BAT_DCB_INFO) {
+            if (!g_ctx.quietMode && it->tag != TAG_BAT_DCB_INFO) {
                 if (g_ctx.modulInfoDump) {
                     // Friendly label for module info dump
-                    const char* label = getTagDescription(batteryData[i].tag);
-                    if (label) {
-                        printf("%s\n", label);
-                    } else {
-                        printf("Tag 0x%08X:\n", batteryData[i].tag);
-                    }
+                    printTagLabel(it->tag);
                 } else {
-                    printf("Tag 0x%08X: ", batteryData[i].tag);
+                    g_output.print("Tag 0x%08X: ", it->tag);
                 }
             }
             
-            // Process battery value based on datatype - uses printFormattedValue for interpretations
-            switch(batteryData[i].dataType) {
+            // Process battery value based on datatype - uses printValueLine for interpretations
+            const char* indent = (g_ctx.modulInfoDump && !g_ctx.quietMode) ? "  " : "";
+            char buf[64];
+            switch(value.dataType) {
                 case RSCP::eTypeFloat32: {
-                    float value = protocol->getValueAsFloat32(&batteryData[i]);
-                    char buf[32];
-                    snprintf(buf, sizeof(buf), "%.2f", value);
+                    float fValue = protocol->getValueAsFloat32(&value);
+                    OutputWriter::formatFixed(buf, sizeof(buf), fValue, 2);
                     // Use std::llround for proper rounding (handles negative values)
-                    int64_t roundedValue = std::llround(value);
-                    const char* interp = interpretValue(batteryData[i].tag, roundedValue);
-                    if (g_ctx.quietMode) {
-                        printf("%s\n", buf);
-                    } else if (g_ctx.modulInfoDump && interp) {
-                        printf("  %s (%s)\n", buf, interp);
-                    } else if (g_ctx.modulInfoDump) {
-                        printf("  %s\n", buf);
-                    } else if (interp) {
-                        printf("%s (%s)\n", buf, interp);
-                    } else {
-                        printf("%s\n", buf);
-                    }
+                    const char* interp = g_ctx.quietMode ? NULL : interpretValue(it->tag, std::llround(fValue));
+                    printValueLine(indent, buf, interp);
                     break;
                 }
-                case RSCP::eTypeUChar8: {
-                    uint8_t value = protocol->getValueAsUChar8(&batteryData[i]);
-                    char buf[32];
-                    snprintf(buf, sizeof(buf), "%u", value);
-                    if (g_ctx.quietMode) {
-                        printf("%s\n", buf);
-                    } else if (g_ctx.modulInfoDump) {
-                        const char* interp = interpretValue(batteryData[i].tag, value);
-                        if (interp) {
-                            printf("  %s (%s)\n", buf, interp);
-                        } else {
-                            printf("  %s\n", buf);
-                        }
-                    } else {
-                        printFormattedValue(batteryData[i].tag, buf, value);
-                    }
+                case RSCP::eTypeUChar8:
+                case RSCP::eTypeUInt32: {
+                    uint32_t uValue = value.dataType == RSCP::eTypeUChar8 ? protocol->getValueAsUChar8(&value) :
+                                                                            protocol->getValueAsUInt32(&value);
+                    OutputWriter::formatUInt(buf, sizeof(buf), uValue);
+                    printValueLine(indent, buf, g_ctx.quietMode ? NULL : interpretValue(it->tag, uValue));
                     break;
                 }
                 case RSCP::eTypeInt32: {
-                    int32_t value = protocol->getValueAsInt32(&batteryData[i]);
-                    char buf[32];
-                    snprintf(buf, sizeof(buf), "%d", value);
-                    if (g_ctx.quietMode) {
-                        printf("%s\n", buf);
-                    } else if (g_ctx.modulInfoDump) {
-                        const char* interp = interpretValue(batteryData[i].tag, value);
-                        if (interp) {
-                            printf("  %s (%s)\n", buf, interp);
-                        } else {
-                            printf("  %s\n", buf);
-                        }
-                    } else {
-                        printFormattedValue(batteryData[i].tag, buf, value);
-                    }
-                    break;
-                }
-                case RSCP::eTypeUInt32: {
-                    uint32_t value = protocol->getValueAsUInt32(&batteryData[i]);
-                    char buf[32];
-                    snprintf(buf, sizeof(buf), "%u", value);
-                    if (g_ctx.quietMode) {
-                        printf("%s\n", buf);
-                    } else if (g_ctx.modulInfoDump) {
-                        const char* interp = interpretValue(batteryData[i].tag, value);
-                        if (interp) {
-                            printf("  %s (%s)\n", buf, interp);
-                        } else {
-                            printf("  %s\n", buf);
-                        }
-                    } else {
-                        printFormattedValue(batteryData[i].tag, buf, value);
-                    }
+                    int32_t iValue = protocol->getValueAsInt32(&value);
+                    OutputWriter::formatInt(buf, sizeof(buf), iValue);
+                    printValueLine(indent, buf, g_ctx.quietMode ? NULL : interpretValue(it->tag, iValue));
                     break;
                 }
                 case RSCP::eTypeString: {
-                    std::string str = protocol->getValueAsString(&batteryData[i]);
-                    if (g_ctx.modulInfoDump) {
-                        printf("  %s\n", str.c_str());
-                    } else {
-                        printf("%s\n", str.c_str());
-                    }
+                    g_output.write(g_ctx.modulInfoDump ? "  " : "");
+                    // wie %s: Ende am ersten Nullbyte
+                    g_output.write((const char*)value.data, strnlen((const char*)value.data, value.length));
+                    g_output.write('\n');
                     break;
                 }
                 case RSCP::eTypeContainer: {
                     // Handle nested containers - especially TAG_BAT_DCB_INFO
-                    if (batteryData[i].tag == TAG_BAT_DCB_INFO && g_ctx.modulInfoDump) {
-                        std::vector<SRscpValue> dcbInfoData = protocol->getValueAsContainer(&batteryData[i]);
-                        
-                        // Group DCB data by DCB_INDEX (ALWAYS parse, regardless of quiet mode)
-                        std::map<uint8_t, std::vector<std::pair<uint32_t, SRscpValue>>> dcbData;
-                        int8_t currentDcbIndex = -1;
-                        
-                        for(size_t j = 0; j < dcbInfoData.size(); ++j) {
-                            uint32_t tag = dcbInfoData[j].tag;
-                            
-                            if (tag == TAG_BAT_DCB_INDEX) {
-                                currentDcbIndex = protocol->getValueAsUChar8(&dcbInfoData[j]);
-                                receivedDCBData = true;  // CRITICAL: Set flag regardless of output mode!
-                            } else if (currentDcbIndex >= 0) {
-                                // Check if this is a DCB-related tag
-                                if ((tag & 0xFFF00000) == 0x03800000) {
-                                    dcbData[currentDcbIndex].push_back(std::make_pair(tag, dcbInfoData[j]));
-                                }
+                    RscpValueRange containerData = protocol->getValueAsContainerView(&value);
+                    if (it->tag == TAG_BAT_DCB_INFO && g_ctx.modulInfoDump) {
+                        // Collect only - several DCBs arrive in one frame and are printed in index order below
+                        // (ALWAYS parse, regardless of quiet mode)
+                        for (RscpValueIterator dcb = containerData.begin(); dcb != containerData.end(); ++dcb) {
+                            if (dcb->tag != TAG_BAT_DCB_INDEX) {
+                                continue;
                             }
-                        }
-                        
-                        // Print grouped DCB data (only if NOT in quiet mode)
-                        if (!g_ctx.quietMode && dcbData.size() > 0) {
-                            for (auto& dcbPair : dcbData) {
-                                printf("Zellblock #%u\n", dcbPair.first);
-                                for (auto& tagValuePair : dcbPair.second) {
-                                    const char* label = getTagDescription(tagValuePair.first);
-                                    if (label) {
-                                        printf("%s\n", label);
-                                    } else {
-                                        printf("Tag 0x%08X:\n", tagValuePair.first);
-                                    }
-                                    
-                                    // Formatiere Wert mit 2 Leerzeichen Abstand
-                                    switch(tagValuePair.second.dataType) {
-                                        case RSCP::eTypeBool:
-                                            printf("  %s\n", protocol->getValueAsBool(&tagValuePair.second) ? "true" : "false");
-                                            break;
-                                        case RSCP::eTypeChar8:
-                                            printf("  %d\n", protocol->getValueAsChar8(&tagValuePair.second));
-                                            break;
-                                        case RSCP::eTypeUChar8:
-                                            printf("  %u\n", protocol->getValueAsUChar8(&tagValuePair.second));
-                                            break;
-                                        case RSCP::eTypeInt16:
-                                            printf("  %d\n", protocol->getValueAsInt16(&tagValuePair.second));
-                                            break;
-                                        case RSCP::eTypeUInt16:
-                                            printf("  %u\n", protocol->getValueAsUInt16(&tagValuePair.second));
-                                            break;
-                                        case RSCP::eTypeInt32:
-                                            printf("  %d\n", protocol->getValueAsInt32(&tagValuePair.second));
-                                            break;
-                                        case RSCP::eTypeUInt32:
-                                            printf("  %u\n", protocol->getValueAsUInt32(&tagValuePair.second));
-                                            break;
-                                        case RSCP::eTypeInt64:
-                                            printf("  %lld\n", (long long)protocol->getValueAsInt64(&tagValuePair.second));
-                                            break;
-                                        case RSCP::eTypeUInt64: {
-                                            uint64_t value = protocol->getValueAsUInt64(&tagValuePair.second);
-                                            // Special formatting for timestamp tags
-                                            if (tagValuePair.first == TAG_BAT_DCB_LAST_MESSAGE_TIMESTAMP) {
-                                                std::string formatted = formatTimestamp(value);
-                                                printf("  %s\n", formatted.c_str());
-                                            } else {
-                                                printf("  %llu\n", (unsigned long long)value);
-                                            }
-                                            break;
-                                        }
-                                        case RSCP::eTypeFloat32:
-                                            printf("  %.2f\n", protocol->getValueAsFloat32(&tagValuePair.second));
-                                            break;
-                                        case RSCP::eTypeDouble64:
-                                            printf("  %.4f\n", protocol->getValueAsDouble64(&tagValuePair.second));
-                                            break;
-                                        case RSCP::eTypeString: {
-                                            std::string str = protocol->getValueAsString(&tagValuePair.second);
-                                            if (str.empty()) {
-                                                printf("  (leer)\n");
-                                            } else {
-                                                printf("  %s\n", str.c_str());
-                                            }
-                                            break;
-                                        }
-                                        case RSCP::eTypeBitfield: {
-                                            // Bitfield als Hex ausgeben
-                                            uint32_t bitfield = 0;
-                                            if (tagValuePair.second.length == 1) {
-                                                bitfield = protocol->getValueAsUChar8(&tagValuePair.second);
-                                            } else if (tagValuePair.second.length == 2) {
-                                                bitfield = protocol->getValueAsUInt16(&tagValuePair.second);
-                                            } else if (tagValuePair.second.length == 4) {
-                                                bitfield = protocol->getValueAsUInt32(&tagValuePair.second);
-                                            }
-                                            printf("  0x%0*X\n", tagValuePair.second.length * 2, bitfield);
-                                            break;
-                                        }
-                                        case RSCP::eTypeByteArray: {
-                                            // ByteArray als Hex ausgeben
-                                            printf("  0x");
-                                            for (uint16_t k = 0; k < tagValuePair.second.length; k++) {
-                                                printf("%02X", tagValuePair.second.data[k]);
-                                            }
-                                            printf("\n");
-                                            break;
-                                        }
-                                        default:
-                                            printf("  (Typ %d)\n", tagValuePair.second.dataType);
-                                            break;
-                                    }
-                                }
-                                printf("\n");
+                            SRscpValue dcbIndex = protocol->getValueFromView(*dcb);
+                            if (dcbIndex.dataType == RSCP::eTypeError) {
+                                fprintf(stderr, "Fehler: Tag 0x%08X, Code %u\n", dcb->tag, protocol->getValueAsUInt32(&dcbIndex));
+                                continue;
                             }
-                        }
-                        
-                        // Clean up
-                        for(size_t j = 0; j < dcbInfoData.size(); ++j) {
-                            protocol->destroyValueData(&dcbInfoData[j]);
+                            DcbSection section;
+                            section.index = protocol->getValueAsUChar8(&dcbIndex);
+                            section.first = dcb;
+                            ++section.first;
+                            dcbSections.push_back(section);  // also list DCBs without further values
+                            receivedDCBData = true;  // CRITICAL: Set flag regardless of output mode!
                         }
                     } else if (!g_ctx.quietMode) {
-                        printf("(Container mit %zu Elementen)\n", 
-                               protocol->getValueAsContainer(&batteryData[i]).size());
+                        size_t elements = 0;
+                        for (RscpValueIterator child = containerData.begin(); child != containerData.end(); ++child) {
+                            elements++;
+                        }
+                        g_output.print("(Container mit %zu Elementen)\n", elements);
                     }
                     break;
                 }
                 default:
                     if (!g_ctx.quietMode) {
-                        printf("Unbekannter Datentyp %d\n", batteryData[i].dataType);
+                        g_output.print("Unbekannter Datentyp %d\n", value.dataType);
                     }
                     break;
             }
@@ -1068,6 +1920,31 @@ int handleResponseValue(RscpProtocol *protocol, SRscpValue *response) {
             }
         }
         
+        // Print grouped DCB data in DCB index order (only if NOT in quiet mode)
+        if (!g_ctx.quietMode && !dcbSections.empty()) {
+            std::stable_sort(dcbSections.begin(), dcbSections.end(), [](const DcbSection & a, const DcbSection & b) {
+                return a.index < b.index;
+            });
+            for (size_t i = 0; i < dcbSections.size(); i++) {
+                if (i == 0 || dcbSections[i].index != dcbSections[i - 1].index) {
+                    g_output.write("Zellblock #");
+                    g_output.writeUInt(dcbSections[i].index);
+                    g_output.write('\n');
+                }
+                // values up to the next DCB of the same container
+                for (RscpValueIterator dcb = dcbSections[i].first; dcb != RscpValueIterator() && dcb->tag != TAG_BAT_DCB_INDEX; ++dcb) {
+                    if ((dcb->tag & 0xFFF00000) == 0x03800000) {
+                        SRscpValue dcbValue = protocol->getValueFromView(*dcb);
+                        printTagLabel(dcb->tag);
+                        printDcbValue(protocol, &dcbValue);
+                    }
+                }
+                if (i + 1 == dcbSections.size() || dcbSections[i + 1].index != dcbSections[i].index) {
+                    g_output.write('\n');
+                }
+            }
+        }
+        
         // In quiet mode (single tag query), if we didn't find the requested tag, output error
         if (g_ctx.quietMode && !g_ctx.modulInfoDump && !foundRequestedTag) {
             fprintf(stderr, "Fehler: Angeforderter Tag 0x%08X nicht in Response gefunden\n", expectedResponseTag);
@@ -1075,19 +1952,8 @@ int handleResponseValue(RscpProtocol *protocol, SRscpValue *response) {
         
         // CRITICAL: Multi-DCB Loop Management
         // Only increment if we actually received DCB data (not just battery-level response)
-        if (g_ctx.needMoreDCBRequests && g_ctx.modulInfoDump && receivedDCBData) {
-            g_ctx.currentDCBIndex++;
-            
-            // Check if we've queried all DCBs
-            if (g_ctx.currentDCBIndex >= g_ctx.totalDCBs) {
-                g_ctx.needMoreDCBRequests = false;
-                g_ctx.isFirstModuleDumpRequest = true;  // Reset for next dump
-            }
-        }
-        
-        // Clean up vector elements properly
-        for(size_t i = 0; i < batteryData.size(); ++i) {
-            protocol->destroyValueData(&batteryData[i]);
+        if (receivedDCBData) {
+            noteDcbBatchReceived();
         }
         
         g_ctx.batContainerQuery = false;  // Reset flag after successful processing
@@ -1131,37 +1997,37 @@ int handleResponseValue(RscpProtocol *protocol, SRscpValue *response) {
                     
                     // Print the single DCB
                     if (!g_ctx.quietMode && dcbData.size() > 0) {
-                        printf("\n  === DCB Zellblöcke ===\n");
+                        g_output.print("\n  === DCB Zellblöcke ===\n");
                         for (auto& dcbPair : dcbData) {
-                            printf("  Zellblock %u:\n", dcbPair.first);
+                            g_output.print("  Zellblock %u:\n", dcbPair.first);
                             
                             for (auto& tagValuePair : dcbPair.second) {
                                 const char* label = getTagDescription(tagValuePair.first);
                                 if (label) {
-                                    printf("    %-35s ", label);
+                                    g_output.print("    %-35s ", label);
                                 } else {
-                                    printf("    Tag 0x%08X:                     ", tagValuePair.first);
+                                    g_output.print("    Tag 0x%08X:                     ", tagValuePair.first);
                                 }
                                 
                                 switch(tagValuePair.second.dataType) {
                                     case RSCP::eTypeFloat32:
-                                        printf("%.2f\n", protocol->getValueAsFloat32(&tagValuePair.second));
+                                        g_output.print("%.2f\n", protocol->getValueAsFloat32(&tagValuePair.second));
                                         break;
                                     case RSCP::eTypeUChar8:
-                                        printf("%u\n", protocol->getValueAsUChar8(&tagValuePair.second));
+                                        g_output.print("%u\n", protocol->getValueAsUChar8(&tagValuePair.second));
                                         break;
                                     case RSCP::eTypeUInt32:
-                                        printf("%u\n", protocol->getValueAsUInt32(&tagValuePair.second));
+                                        g_output.print("%u\n", protocol->getValueAsUInt32(&tagValuePair.second));
                                         break;
                                     case RSCP::eTypeInt32:
-                                        printf("%d\n", protocol->getValueAsInt32(&tagValuePair.second));
+                                        g_output.print("%d\n", protocol->getValueAsInt32(&tagValuePair.second));
                                         break;
                                     default:
-                                        printf("(Typ %d)\n", tagValuePair.second.dataType);
+                                        g_output.print("(Typ %d)\n", tagValuePair.second.dataType);
                                         break;
                                 }
                             }
-                            printf("\n");
+                            g_output.print("\n");
                         }
                     }
                 } else {
@@ -1187,46 +2053,46 @@ int handleResponseValue(RscpProtocol *protocol, SRscpValue *response) {
                     
                     // Print grouped DCB data
                     if (!g_ctx.quietMode && dcbData.size() > 0) {
-                        printf("\n  === DCB Zellblöcke ===\n");
+                        g_output.print("\n  === DCB Zellblöcke ===\n");
                         for (auto& dcbPair : dcbData) {
-                            printf("  Zellblock %u:\n", dcbPair.first);
+                            g_output.print("  Zellblock %u:\n", dcbPair.first);
                             
                             for (auto& tagValuePair : dcbPair.second) {
                                 const char* label = getTagDescription(tagValuePair.first);
                                 if (label) {
-                                    printf("    %-35s ", label);
+                                    g_output.print("    %-35s ", label);
                                 } else {
-                                    printf("    Tag 0x%08X:                     ", tagValuePair.first);
+                                    g_output.print("    Tag 0x%08X:                     ", tagValuePair.first);
                                 }
                                 
                                 // Print value based on type
                                 switch(tagValuePair.second.dataType) {
                                     case RSCP::eTypeFloat32: {
                                         float val = protocol->getValueAsFloat32(&tagValuePair.second);
-                                        printf("%.2f\n", val);
+                                        g_output.print("%.2f\n", val);
                                         break;
                                     }
                                     case RSCP::eTypeUChar8: {
                                         uint8_t val = protocol->getValueAsUChar8(&tagValuePair.second);
-                                        printf("%u\n", val);
+                                        g_output.print("%u\n", val);
                                         break;
                                     }
                                     case RSCP::eTypeUInt32: {
                                         uint32_t val = protocol->getValueAsUInt32(&tagValuePair.second);
-                                        printf("%u\n", val);
+                                        g_output.print("%u\n", val);
                                         break;
                                     }
                                     case RSCP::eTypeInt32: {
                                         int32_t val = protocol->getValueAsInt32(&tagValuePair.second);
-                                        printf("%d\n", val);
+                                        g_output.print("%d\n", val);
                                         break;
                                     }
                                     default:
-                                        printf("(Typ %d)\n", tagValuePair.second.dataType);
+                                        g_output.print("(Typ %d)\n", tagValuePair.second.dataType);
                                         break;
                                 }
                             }
-                            printf("\n");
+                            g_output.print("\n");
                         }
                     }
                 }
@@ -1254,14 +2120,15 @@ int handleResponseValue(RscpProtocol *protocol, SRscpValue *response) {
             break;
         }
 
-        case TAG_EMS_SET_POWER_SETTINGS: {        // response for TAG_PM_REQ_DATA
+        case TAG_EMS_SET_POWER_SETTINGS: {        // response for TAG_EMS_REQ_SET_POWER_SETTINGS
             uint8_t ucPMIndex = 0;
+            recordPowerSettingsResult(protocol, response);
             std::vector<SRscpValue> PMData = protocol->getValueAsContainer(response);
             for(size_t i = 0; i < PMData.size(); ++i) {
                 if(PMData[i].dataType == RSCP::eTypeError) {
                     // handle error for example access denied errors
                     uint32_t uiErrorCode = protocol->getValueAsUInt32(&PMData[i]);
-                    printf("TAG_EMS_GET_POWER_SETTINGS 0x%08X received error code %u.\n", PMData[i].tag, uiErrorCode);
+                    g_output.print("TAG_EMS_GET_POWER_SETTINGS 0x%08X received error code %u.\n", PMData[i].tag, uiErrorCode);
                     return -1;
                 }
                 // check each PM sub tag
@@ -1272,34 +2139,34 @@ int handleResponseValue(RscpProtocol *protocol, SRscpValue *response) {
                     }
                     case TAG_EMS_POWER_LIMITS_USED: {              // response for POWER_LIMITS_USED
                         if (protocol->getValueAsBool(&PMData[i])){
-                            printf("POWER_LIMITS_USED\n");
+                            g_output.print("POWER_LIMITS_USED\n");
                             }
                         break;
                     }
                     case TAG_EMS_MAX_CHARGE_POWER: {              // 101 response for TAG_EMS_MAX_CHARGE_POWER
                         uint32_t uPower = protocol->getValueAsUInt32(&PMData[i]);
-                        printf("MAX_CHARGE_POWER %i W\n", uPower);
+                        g_output.print("MAX_CHARGE_POWER %i W\n", uPower);
                         break;
                     }
                     case TAG_EMS_MAX_DISCHARGE_POWER: {              //102 response for TAG_EMS_MAX_DISCHARGE_POWER
                         uint32_t uPower = protocol->getValueAsUInt32(&PMData[i]);
-                        printf("MAX_DISCHARGE_POWER %i W\n", uPower);
+                        g_output.print("MAX_DISCHARGE_POWER %i W\n", uPower);
                         break;
                     }
                     case TAG_EMS_DISCHARGE_START_POWER:{              //103 response for TAG_EMS_DISCHARGE_START_POWER
                         uint32_t uPower = protocol->getValueAsUInt32(&PMData[i]);
-                        printf("DISCHARGE_START_POWER %i W\n", uPower);
+                        g_output.print("DISCHARGE_START_POWER %i W\n", uPower);
                         break;
                     }
                     case TAG_EMS_POWERSAVE_ENABLED: {              //104 response for TAG_EMS_POWERSAVE_ENABLED
                         if (protocol->getValueAsBool(&PMData[i])){
-                            printf("POWERSAVE_ENABLED\n");
+                            g_output.print("POWERSAVE_ENABLED\n");
                         }
                         break;
                     }
                     case TAG_EMS_WEATHER_REGULATED_CHARGE_ENABLED: {//105 resp WEATHER_REGULATED_CHARGE_ENABLED
                         if (protocol->getValueAsBool(&PMData[i])){
-                            printf("WEATHER_REGULATED_CHARGE_ENABLED\n");
+                            g_output.print("WEATHER_REGULATED_CHARGE_ENABLED\n");
                         }
                         break;
                     }
@@ -1320,7 +2187,7 @@ int handleResponseValue(RscpProtocol *protocol, SRscpValue *response) {
     case TAG_DB_HISTORY_DATA_MONTH:
     case TAG_DB_HISTORY_DATA_YEAR: {
         if (!g_ctx.historieAbfrage) {
-            printf("Unerwartete History-Response (Tag 0x%08X)\n", response->tag);
+            g_output.print("Unerwartete History-Response (Tag 0x%08X)\n", response->tag);
             break;
         }
         
@@ -1345,78 +2212,115 @@ int handleResponseValue(RscpProtocol *protocol, SRscpValue *response) {
             intervalName = "1 Woche";
         }
         
+        // Antworten kommen in der Reihenfolge der Anfragen
+        if (g_ctx.historieEmpfangen >= g_ctx.historiePerioden.size()) {
+            g_output.print("Unerwartete History-Response (Tag 0x%08X)\n", response->tag);
+            break;
+        }
+        const HistoryPeriod & period = g_ctx.historiePerioden[g_ctx.historieEmpfangen];
+        storeHistoryResponse(protocol, g_ctx.historieEmpfangen, response);
+        g_ctx.historieEmpfangen++;
+
+        if (g_output.structured()) {
+            outputHistorySums(protocol, response, period);
+            break;
+        }
+
+        if (g_ctx.historieSerie != SERIES_NONE) {
+            // --series: nur die Intervallwerte, Zusammenfassung und Zeitraum entfallen
+            uint32_t historyTag, interval;
+            historyRequestTag(g_ctx.historieTyp, &historyTag, &interval);
+            if (g_ctx.historieSerie == SERIES_CSV && !g_ctx.historieSerieKopf) {
+                g_output.print("time,ts");
+                for (size_t c = 0; c < HISTORY_SERIES_COLUMNS; c++) {
+                    g_output.print(",%s", historySeriesColumns[c].name);
+                }
+                g_output.print("\n");
+                g_ctx.historieSerieKopf = true;
+            }
+            RscpValueRange historyData = protocol->getValueAsContainerView(response);
+            for (RscpValueIterator history = historyData.begin(); history != historyData.end(); ++history) {
+                if (history->dataType == RSCP::eTypeError) {
+                    fprintf(stderr, "Fehler: Tag 0x%08X, Code %u\n", history->tag, protocol->getValueAsUInt32(&*history));
+                } else if (history->tag == TAG_DB_VALUE_CONTAINER) {
+                    printHistorySeriesRow(protocol, &*history, period, interval);
+                }
+            }
+            break;
+        }
+
+        if (g_ctx.historieEmpfangen > 1) {
+            g_output.print("\n");
+        }
+
         // Format start and end dates
-        time_t startTime = g_ctx.historieStartTime;
-        time_t endTime = g_ctx.historieStartTime + g_ctx.historieSpan - 1;
+        time_t startTime = period.start;
+        time_t endTime = period.start + period.span - 1;
         
         char startStr[32] = "N/A", endStr[32] = "N/A";
         
         if (startTime > 0) {
             struct tm startTm, endTm;
             
-            // WICHTIG: localtime() überschreibt statischen Buffer!
-            // Deshalb SOFORT nach jedem Aufruf kopieren!
-            struct tm *pStartTm = localtime(&startTime);
-            if (pStartTm) {
-                startTm = *pStartTm;  // Sofort kopieren!
+            // localtime_r(): mehrere Sitzungen (--fleet) geben gleichzeitig aus
+            if (localtime_r(&startTime, &startTm)) {
                 strftime(startStr, sizeof(startStr), "%d.%m.%Y", &startTm);
             }
             
-            struct tm *pEndTm = localtime(&endTime);
-            if (pEndTm) {
-                endTm = *pEndTm;  // Sofort kopieren!
+            if (localtime_r(&endTime, &endTm)) {
                 strftime(endStr, sizeof(endStr), "%d.%m.%Y", &endTm);
             }
         }
         
-        printf("Zeitraum: %s - %s\n", startStr, endStr);
+        g_output.print("Zeitraum: %s - %s\n", startStr, endStr);
         
-        std::vector<SRscpValue> historyData = protocol->getValueAsContainer(response);
+        // iterate the history in place: value containers are skipped without being parsed or copied
+        RscpValueRange historyData = protocol->getValueAsContainerView(response);
         
-        for(size_t i = 0; i < historyData.size(); ++i) {
-            if(historyData[i].dataType == RSCP::eTypeError) {
-                uint32_t uiErrorCode = protocol->getValueAsUInt32(&historyData[i]);
-                printf("Fehler: Tag 0x%08X, Code %u\n", historyData[i].tag, uiErrorCode);
+        for(RscpValueIterator history = historyData.begin(); history != historyData.end(); ++history) {
+            if(history->dataType == RSCP::eTypeError) {
+                uint32_t uiErrorCode = protocol->getValueAsUInt32(&*history);
+                g_output.print("Fehler: Tag 0x%08X, Code %u\n", history->tag, uiErrorCode);
                 continue;
             }
             
-            switch(historyData[i].tag) {
+            switch(history->tag) {
                 case TAG_DB_SUM_CONTAINER: {
-                    std::vector<SRscpValue> sumData = protocol->getValueAsContainer(&historyData[i]);
+                    RscpValueRange sumData = protocol->getValueAsContainerView(&*history);
                     
                     float batPowerIn = 0, batPowerOut = 0, dcPower = 0;
                     float gridPowerIn = 0, gridPowerOut = 0, consumption = 0;
                     float soc = 0, autarky = 0;
                     uint32_t graphIndex = 0;
                     
-                    for(size_t j = 0; j < sumData.size(); ++j) {
-                        switch(sumData[j].tag) {
+                    for(RscpValueIterator sum = sumData.begin(); sum != sumData.end(); ++sum) {
+                        switch(sum->tag) {
                             case TAG_DB_GRAPH_INDEX:
-                                graphIndex = protocol->getValueAsUInt32(&sumData[j]);
+                                graphIndex = protocol->getValueAsUInt32(&*sum);
                                 break;
                             case TAG_DB_BAT_POWER_IN:
-                                batPowerIn = protocol->getValueAsFloat32(&sumData[j]);
+                                batPowerIn = protocol->getValueAsFloat32(&*sum);
                                 break;
                             case TAG_DB_BAT_POWER_OUT:
-                                batPowerOut = protocol->getValueAsFloat32(&sumData[j]);
+                                batPowerOut = protocol->getValueAsFloat32(&*sum);
                                 break;
                             case TAG_DB_DC_POWER:
-                                dcPower = protocol->getValueAsFloat32(&sumData[j]);
+                                dcPower = protocol->getValueAsFloat32(&*sum);
                                 break;
                             case TAG_DB_GRID_POWER_IN:
-                                gridPowerIn = protocol->getValueAsFloat32(&sumData[j]);
+                                gridPowerIn = protocol->getValueAsFloat32(&*sum);
                                 break;
                             case TAG_DB_GRID_POWER_OUT:
-                                gridPowerOut = protocol->getValueAsFloat32(&sumData[j]);
+                                gridPowerOut = protocol->getValueAsFloat32(&*sum);
                                 break;
                             case TAG_DB_CONSUMPTION:
-                                consumption = protocol->getValueAsFloat32(&sumData[j]);
+                                consumption = protocol->getValueAsFloat32(&*sum);
                                 break;
                             case TAG_DB_BAT_CHARGE_LEVEL:
-                                soc = protocol->getValueAsFloat32(&sumData[j]);
+                                soc = protocol->getValueAsFloat32(&*sum);
                                 break;
                             case TAG_DB_AUTARKY:
-                                autarky = protocol->getValueAsFloat32(&sumData[j]);
+                                autarky = protocol->getValueAsFloat32(&*sum);
                                 break;
                             case TAG_DB_BAT_CYCLE_COUNT:
                             case TAG_DB_CONSUMED_PRODUCTION:
@@ -1427,30 +2331,38 @@ int handleResponseValue(RscpProtocol *protocol, SRscpValue *response) {
                         }
                     }
                     
-                    printf("PV-Produktion:      %.2f kWh\n", dcPower / 1000.0);
-                    printf("Batterie geladen:   %.2f kWh\n", batPowerIn / 1000.0);
-                    printf("Batterie entladen:  %.2f kWh\n", batPowerOut / 1000.0);
-                    printf("Netzbezug:          %.2f kWh\n", gridPowerOut / 1000.0);
-                    printf("Netzeinspeisung:    %.2f kWh\n", gridPowerIn / 1000.0);
-                    printf("Hausverbrauch:      %.2f kWh\n", consumption / 1000.0);
-                    if (autarky > 0) printf("Autarkie:           %.1f %%\n", autarky);
-                    
-                    protocol->destroyValueData(sumData);
+                    const struct {
+                        const char* label;
+                        double kWh;
+                    } sums[] = {
+                        {"PV-Produktion:      ", dcPower / 1000.0},
+                        {"Batterie geladen:   ", batPowerIn / 1000.0},
+                        {"Batterie entladen:  ", batPowerOut / 1000.0},
+                        {"Netzbezug:          ", gridPowerOut / 1000.0},
+                        {"Netzeinspeisung:    ", gridPowerIn / 1000.0},
+                        {"Hausverbrauch:      ", consumption / 1000.0},
+                    };
+                    for (size_t line = 0; line < sizeof(sums) / sizeof(sums[0]); line++) {
+                        g_output.write(sums[line].label);
+                        g_output.writeFixed(sums[line].kWh, 2);
+                        g_output.write(" kWh\n");
+                    }
+                    if (autarky > 0) {
+                        g_output.write("Autarkie:           ");
+                        g_output.writeFixed(autarky, 1);
+                        g_output.write(" %\n");
+                    }
                     break;
                 }
-                case TAG_DB_VALUE_CONTAINER: {
+                case TAG_DB_VALUE_CONTAINER:
                     // Datenpunkte werden nicht angezeigt - nur Zusammenfassung
-                    std::vector<SRscpValue> tmpData = protocol->getValueAsContainer(&historyData[i]);
-                    protocol->destroyValueData(tmpData);
                     break;
-                }
                 default:
-                    printf("  Unbekannter History-Sub-Tag 0x%08X\n", historyData[i].tag);
+                    g_output.print("  Unbekannter History-Sub-Tag 0x%08X\n", history->tag);
                     break;
             }
         }
         
-        protocol->destroyValueData(historyData);
         break;
     }
     
@@ -1459,7 +2371,7 @@ int handleResponseValue(RscpProtocol *protocol, SRscpValue *response) {
         // Generic handler for read requests
         if (g_ctx.werteAbfragen) {
             if (!g_ctx.quietMode) {
-                printf("Tag 0x%08X: ", response->tag);
+                g_output.print("Tag 0x%08X: ", response->tag);
             }
             switch(response->dataType) {
                 case RSCP::eTypeBool: {
@@ -1470,42 +2382,42 @@ int handleResponseValue(RscpProtocol *protocol, SRscpValue *response) {
                 case RSCP::eTypeChar8: {
                     int8_t value = protocol->getValueAsChar8(response);
                     char buf[32];
-                    snprintf(buf, sizeof(buf), "%d", value);
+                    OutputWriter::formatInt(buf, sizeof(buf), value);
                     printFormattedValue(response->tag, buf, value);
                     break;
                 }
                 case RSCP::eTypeUChar8: {
                     uint8_t value = protocol->getValueAsUChar8(response);
                     char buf[32];
-                    snprintf(buf, sizeof(buf), "%u", value);
+                    OutputWriter::formatUInt(buf, sizeof(buf), value);
                     printFormattedValue(response->tag, buf, value);
                     break;
                 }
                 case RSCP::eTypeInt16: {
                     int16_t value = protocol->getValueAsInt16(response);
                     char buf[32];
-                    snprintf(buf, sizeof(buf), "%d", value);
+                    OutputWriter::formatInt(buf, sizeof(buf), value);
                     printFormattedValue(response->tag, buf, value);
                     break;
                 }
                 case RSCP::eTypeUInt16: {
                     uint16_t value = protocol->getValueAsUInt16(response);
                     char buf[32];
-                    snprintf(buf, sizeof(buf), "%u", value);
+                    OutputWriter::formatUInt(buf, sizeof(buf), value);
                     printFormattedValue(response->tag, buf, value);
                     break;
                 }
                 case RSCP::eTypeInt32: {
                     int32_t value = protocol->getValueAsInt32(response);
                     char buf[32];
-                    snprintf(buf, sizeof(buf), "%d", value);
+                    OutputWriter::formatInt(buf, sizeof(buf), value);
                     printFormattedValue(response->tag, buf, value);
                     break;
                 }
                 case RSCP::eTypeUInt32: {
                     uint32_t value = protocol->getValueAsUInt32(response);
                     char buf[32];
-                    snprintf(buf, sizeof(buf), "%u", value);
+                    OutputWriter::formatUInt(buf, sizeof(buf), value);
                     printFormattedValue(response->tag, buf, value);
                     break;
                 }
@@ -1515,12 +2427,14 @@ int handleResponseValue(RscpProtocol *protocol, SRscpValue *response) {
                     if (!g_ctx.quietMode && value > 1577836800000LL && value < 2209075200000LL) {
                         time_t seconds = (time_t)(value / 1000);
                         int milliseconds = value % 1000;
-                        struct tm *timeinfo = localtime(&seconds);
+                        struct tm timeinfo;
+                        localtime_r(&seconds, &timeinfo);
                         char timeStr[80];
-                        strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", timeinfo);
-                        printf("%s.%03d\n", timeStr, milliseconds);
+                        strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &timeinfo);
+                        g_output.print("%s.%03d\n", timeStr, milliseconds);
                     } else {
-                        printf("%lld\n", value);
+                        g_output.writeInt(value);
+                        g_output.write('\n');
                     }
                     break;
                 }
@@ -1530,39 +2444,41 @@ int handleResponseValue(RscpProtocol *protocol, SRscpValue *response) {
                     if (!g_ctx.quietMode && value > 1577836800000ULL && value < 2209075200000ULL) {
                         time_t seconds = (time_t)(value / 1000);
                         int milliseconds = value % 1000;
-                        struct tm *timeinfo = localtime(&seconds);
+                        struct tm timeinfo;
+                        localtime_r(&seconds, &timeinfo);
                         char timeStr[80];
-                        strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", timeinfo);
-                        printf("%s.%03d\n", timeStr, milliseconds);
+                        strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &timeinfo);
+                        g_output.print("%s.%03d\n", timeStr, milliseconds);
                     } else {
-                        printf("%llu\n", value);
+                        g_output.writeUInt(value);
+                        g_output.write('\n');
                     }
                     break;
                 }
                 case RSCP::eTypeFloat32: {
                     float value = protocol->getValueAsFloat32(response);
-                    char buf[32];
-                    snprintf(buf, sizeof(buf), "%.2f", value);
+                    char buf[64];
+                    OutputWriter::formatFixed(buf, sizeof(buf), value, 2);
                     printFormattedValue(response->tag, buf, (int64_t)value);
                     break;
                 }
                 case RSCP::eTypeDouble64:
-                    printf("%.2f\n", protocol->getValueAsDouble64(response));
+                    g_output.print("%.2f\n", protocol->getValueAsDouble64(response));
                     break;
                 case RSCP::eTypeBitfield:
-                    printf("0x%08X\n", protocol->getValueAsUInt32(response));
+                    g_output.print("0x%08X\n", protocol->getValueAsUInt32(response));
                     break;
                 case RSCP::eTypeString: {
                     std::string str = protocol->getValueAsString(response);
-                    printf("%s\n", str.c_str());
+                    g_output.print("%s\n", str.c_str());
                     break;
                 }
                 case RSCP::eTypeContainer: {
                     std::vector<SRscpValue> container = protocol->getValueAsContainer(response);
                     if (!g_ctx.quietMode) {
-                        printf("Container (%zu Elemente)\n", container.size());
+                        g_output.print("Container (%zu Elemente)\n", container.size());
                         for(size_t i = 0; i < container.size(); ++i) {
-                            printf("  [%zu] ", i);
+                            g_output.print("  [%zu] ", i);
                             handleResponseValue(protocol, &container[i]);
                         }
                     } else {
@@ -1575,16 +2491,16 @@ int handleResponseValue(RscpProtocol *protocol, SRscpValue *response) {
                 }
                 case RSCP::eTypeByteArray: {
                     if (!g_ctx.quietMode) {
-                        printf("ByteArray (Laenge: %d bytes): ", response->length);
+                        g_output.print("ByteArray (Laenge: %d bytes): ", response->length);
                     }
                     int displayLength = response->length > 16 ? 16 : response->length;
                     for(int i = 0; i < displayLength; i++) {
-                        printf("%02X ", response->data[i]);
+                        g_output.print("%02X ", response->data[i]);
                     }
                     if(response->length > 16) {
-                        printf("... ");
+                        g_output.print("... ");
                     }
-                    printf("\n");
+                    g_output.print("\n");
                     break;
                 }
                 case RSCP::eTypeTimestamp: {
@@ -1597,35 +2513,176 @@ int handleResponseValue(RscpProtocol *protocol, SRscpValue *response) {
                             localtime_r(&seconds, &timeinfo);
                             char timeStr[80];
                             strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &timeinfo);
-                            printf("%s.%03u\n", timeStr, ts.nanoseconds / 1000000);
+                            g_output.print("%s.%03u\n", timeStr, ts.nanoseconds / 1000000);
                         } else {
-                            printf("%lld.%09u (ungültiger Timestamp)\n", (long long)ts.seconds, ts.nanoseconds);
+                            g_output.print("%lld.%09u (ungültiger Timestamp)\n", (long long)ts.seconds, ts.nanoseconds);
                         }
                     } else {
-                        printf("%llu.%09u\n", (unsigned long long)ts.seconds, ts.nanoseconds);
+                        g_output.print("%llu.%09u\n", (unsigned long long)ts.seconds, ts.nanoseconds);
                     }
                     break;
                 }
                 default:
                     if (!g_ctx.quietMode) {
-                        printf("Unbekannter Datentyp %d\n", response->dataType);
+                        g_output.print("Unbekannter Datentyp %d\n", response->dataType);
                     }
                     break;
             }
         } else {
-            printf("Unknown tag %08X\n", response->tag);
+            g_output.print("Unknown tag %08X\n", response->tag);
         }
         break;
     }
     return 0;
 }
 
+// Sammelt die Antworten eines Frames nach Tag, BAT_DATA Container werden aufgelöst (Views in den Empfangspuffer, keine Kopien)
+static void collectResponses(RscpProtocol *protocol, const RscpValueRange & values, std::map<uint32_t, SRscpValueView> & responses)
+{
+    for (RscpValueIterator it = values.begin(); it != values.end(); ++it) {
+        if (it->tag == TAG_BAT_DATA && it->dataType == RSCP::eTypeContainer) {
+            RscpValueRange batData = protocol->getValueAsContainerView(&*it);
+            for (RscpValueIterator bat = batData.begin(); bat != batData.end(); ++bat) {
+                if (bat->tag != TAG_BAT_INDEX) {
+                    responses[bat->tag] = *bat;
+                }
+            }
+        } else {
+            responses[it->tag] = *it;
+        }
+    }
+}
+
+// Gibt die Antworten einer Mehrfach-Abfrage (-r TAG1,TAG2,...) in der Reihenfolge der Anfrage aus
+static void handleMultiTagResponse(RscpProtocol *protocol, const RscpValueRange & values)
+{
+    std::map<uint32_t, SRscpValueView> responses;
+    collectResponses(protocol, values, responses);
+
+    for (size_t i = 0; i < g_ctx.leseTags.size(); i++) {
+        uint32_t responseTag = g_ctx.leseTags[i] | 0x00800000;
+        std::map<uint32_t, SRscpValueView>::iterator it = responses.find(responseTag);
+        if (it == responses.end()) {
+            // Fehler immer auf stderr (Quiet-Mode Vertrag)
+            fprintf(stderr, "Fehler: Angeforderter Tag 0x%08X nicht in Response gefunden\n", responseTag);
+            continue;
+        }
+        SRscpValue value = protocol->getValueFromView(it->second);
+        handleResponseValue(protocol, &value);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------------------
+// Exporter-Modus: Werte der -r Tags als Prometheus-Metriken
+//--------------------------------------------------------------------------------------------------------------
+
+struct ExporterMetric {
+    uint32_t tag;         // angefragter REQUEST Tag
+    int interval;         // Abfrageintervall in Sekunden
+    std::string name;     // Metrik-Name, z.B. e3dc_ems_power_pv
+    std::string help;     // Beschreibung aus der Tags-Datei
+    std::string labels;   // z.B. tag="0x01000001"
+    std::string value;    // formatierter Wert der letzten Abfrage, leer wenn nicht in der Antwort
+    double number;        // derselbe Wert als Zahl für den Zeitreihen-Speicher (--store)
+};
+
+// wird nur vom Poller-Thread verwendet, der auch die RSCP-Sitzung besitzt
+static std::vector<ExporterMetric> g_exporterMetrics;
+
+// Formatiert einen Zahlenwert für Prometheus und liefert ihn zusätzlich als double;
+// false für Strings, Container und Byte-Arrays
+static bool formatMetricValue(RscpProtocol *protocol, SRscpValue *value, char *buffer, size_t size, double *number)
+{
+    switch (value->dataType) {
+        case RSCP::eTypeBool:
+            *number = protocol->getValueAsBool(value) ? 1 : 0;
+            snprintf(buffer, size, "%d", (int)*number);
+            return true;
+        case RSCP::eTypeChar8:
+            *number = protocol->getValueAsChar8(value);
+            snprintf(buffer, size, "%d", protocol->getValueAsChar8(value));
+            return true;
+        case RSCP::eTypeUChar8:
+            *number = protocol->getValueAsUChar8(value);
+            snprintf(buffer, size, "%u", protocol->getValueAsUChar8(value));
+            return true;
+        case RSCP::eTypeInt16:
+            *number = protocol->getValueAsInt16(value);
+            snprintf(buffer, size, "%d", protocol->getValueAsInt16(value));
+            return true;
+        case RSCP::eTypeUInt16:
+            *number = protocol->getValueAsUInt16(value);
+            snprintf(buffer, size, "%u", protocol->getValueAsUInt16(value));
+            return true;
+        case RSCP::eTypeInt32:
+            *number = protocol->getValueAsInt32(value);
+            snprintf(buffer, size, "%d", protocol->getValueAsInt32(value));
+            return true;
+        case RSCP::eTypeUInt32:
+            *number = protocol->getValueAsUInt32(value);
+            snprintf(buffer, size, "%u", protocol->getValueAsUInt32(value));
+            return true;
+        case RSCP::eTypeInt64:
+            *number = (double)protocol->getValueAsInt64(value);
+            snprintf(buffer, size, "%lld", (long long)protocol->getValueAsInt64(value));
+            return true;
+        case RSCP::eTypeUInt64:
+            *number = (double)protocol->getValueAsUInt64(value);
+            snprintf(buffer, size, "%llu", (unsigned long long)protocol->getValueAsUInt64(value));
+            return true;
+        case RSCP::eTypeFloat32:
+            *number = protocol->getValueAsFloat32(value);
+            snprintf(buffer, size, "%.7g", protocol->getValueAsFloat32(value));
+            return true;
+        case RSCP::eTypeDouble64:
+            *number = protocol->getValueAsDouble64(value);
+            snprintf(buffer, size, "%.17g", *number);
+            return true;
+        case RSCP::eTypeTimestamp: {
+            SRscpTimestamp ts = protocol->getValueAsTimestamp(value);
+            *number = ts.seconds + ts.nanoseconds / 1e9;
+            snprintf(buffer, size, "%llu.%09u", (unsigned long long)ts.seconds, ts.nanoseconds);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// Übernimmt die Werte einer Exporter-Abfrage in g_exporterMetrics
+static void handleExporterResponse(RscpProtocol *protocol, const RscpValueRange & values)
+{
+    std::map<uint32_t, SRscpValueView> responses;
+    collectResponses(protocol, values, responses);
+
+    for (size_t i = 0; i < g_exporterMetrics.size(); i++) {
+        ExporterMetric & metric = g_exporterMetrics[i];
+        std::map<uint32_t, SRscpValueView>::iterator it = responses.find(metric.tag | 0x00800000);
+        if (it == responses.end()) {
+            DEBUG("Tag 0x%08X nicht in Response gefunden\n", metric.tag | 0x00800000);
+            continue;
+        }
+        SRscpValue value = protocol->getValueFromView(it->second);
+        if (value.dataType == RSCP::eTypeError) {
+            fprintf(stderr, "Tag 0x%08X received error code %u.\n", value.tag, protocol->getValueAsUInt32(&value));
+            continue;
+        }
+        char buffer[64];
+        if (formatMetricValue(protocol, &value, buffer, sizeof(buffer), &metric.number)) {
+            metric.value = buffer;
+        } else {
+            DEBUG("Tag 0x%08X: Datentyp %d ist kein Zahlenwert\n", value.tag, value.dataType);
+        }
+    }
+}
+
 static int processReceiveBuffer(const unsigned char * ucBuffer, int iLength)
 {
     RscpProtocol protocol;
-    SRscpFrame frame;
+    RscpValueRange values;
 
-    int iResult = protocol.parseFrame(ucBuffer, iLength, &frame);
+    // the values are not copied, they are handled in place inside the receive buffer
+    int iResult = protocol.parseFrameView(ucBuffer, iLength, &values);
     if(iResult < 0) {
         // check if frame length error occured
         // in that case the full frame length was not received yet
@@ -1641,45 +2698,109 @@ static int processReceiveBuffer(const unsigned char * ucBuffer, int iLength)
 
     int iProcessedBytes = iResult;
 
-    // process each SRscpValue struct seperately
-    for(size_t i = 0; i < frame.data.size(); i++) {
-        handleResponseValue(&protocol, &frame.data[i]);
+    if (iAuthenticated && g_ctx.exporterMode) {
+        handleExporterResponse(&protocol, values);
+    } else if (iAuthenticated && g_ctx.werteAbfragen && g_ctx.leseTags.size() > 1) {
+        handleMultiTagResponse(&protocol, values);
+    } else {
+        // process each value seperately; the SRscpValue shares the data of the view and is not destroyed
+        for (RscpValueIterator it = values.begin(); it != values.end(); ++it) {
+            SRscpValue value = protocol.getValueFromView(*it);
+            handleResponseValue(&protocol, &value);
+        }
     }
-
-    // destroy frame data and free memory
-    protocol.destroyFrameData(frame);
+    // --format: alle Datensätze des Frames mit einem Schreibaufruf
+    g_output.flush();
 
     // returned processed amount of bytes
     return iProcessedBytes;
 }
 
+// setup static dynamic buffers which are dynamically expanded (re-allocated) on demand
+// the data inside these buffers is not released when receiveLoop() is left and is reset on reconnect
+// vecDynamicBuffer holds the encrypted data, vecPlainBuffer the decrypted data at the same offsets:
+//   [0, iFrameStart)                  already processed frames
+//   [iFrameStart, iDecryptedBytes)    decrypted data of the current frame (multiple of AES_BLOCK_SIZE)
+//   [iDecryptedBytes, iReceivedBytes) received data which is not a complete AES block yet
+static thread_local int iReceivedBytes = 0;
+static thread_local int iDecryptedBytes = 0;
+static thread_local int iFrameStart = 0;
+static thread_local std::vector<uint8_t> vecDynamicBuffer;
+static thread_local std::vector<uint8_t> vecPlainBuffer;
+
+static void resetReceiveBuffer(void)
+{
+    iReceivedBytes = 0;
+    iDecryptedBytes = 0;
+    iFrameStart = 0;
+}
+
+// Schafft Platz für mindestens 4096 weitere Bytes, false wenn die maximale Puffergröße überschritten wird
+static bool reserveReceiveBuffer(void)
+{
+    if((int)vecDynamicBuffer.size() - iReceivedBytes >= 4096) {
+        return true;
+    }
+    // move the data of the incomplete frame to the front before growing
+    // this only happens if a frame ends close to the end of the buffer, usually the buffer is empty after a frame
+    if(iFrameStart > 0) {
+        memmove(&vecDynamicBuffer[0], &vecDynamicBuffer[0] + iFrameStart, iReceivedBytes - iFrameStart);
+        memmove(&vecPlainBuffer[0], &vecPlainBuffer[0] + iFrameStart, iDecryptedBytes - iFrameStart);
+        iReceivedBytes -= iFrameStart;
+        iDecryptedBytes -= iFrameStart;
+        iFrameStart = 0;
+        if((int)vecDynamicBuffer.size() - iReceivedBytes >= 4096) {
+            return true;
+        }
+    }
+    // check maximum size
+    if(vecDynamicBuffer.size() > RSCP_MAX_FRAME_LENGTH) {
+        // something went wrong and the size is more than possible by the RSCP protocol
+        g_output.print("Maximum buffer size exceeded %lu\n", vecDynamicBuffer.size());
+        return false;
+    }
+    // increase buffer size by 4096 bytes each time the remaining size is smaller than 4096
+    vecDynamicBuffer.resize(vecDynamicBuffer.size() + 4096);
+    vecPlainBuffer.resize(vecDynamicBuffer.size());
+    return true;
+}
+
+// Meldungen der Verbindung gehen nach stderr, nie in die Ausgabe (JSON, CSV, --series); im Fleet-Modus mit "[gerät] "
+static void printSessionError(const char * format, ...) __attribute__((format(printf, 1, 2)));
+static void printSessionError(const char * format, ...)
+{
+    char message[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    const std::string & device = g_output.device();
+    if (device.empty()) {
+        fputs(message, stderr);
+    } else {
+        fprintf(stderr, "[%s] %s", device.c_str(), message);
+    }
+}
+
+// die Antwort auf den zuletzt gesendeten Frame kam nicht innerhalb von SOCKET_RECV_TIMEOUT_MS
+static thread_local bool bResponseTimeout = false;
+
 static void receiveLoop(bool & bStopExecution)
 {
     //--------------------------------------------------------------------------------------------------------------
     // RSCP Receive Frame Block Data
     //--------------------------------------------------------------------------------------------------------------
-    // setup a static dynamic buffer which is dynamically expanded (re-allocated) on demand
-    // the data inside this buffer is not released when this function is left
-    static int iReceivedBytes = 0;
-    static std::vector<uint8_t> vecDynamicBuffer;
-
     // check how many RSCP frames are received, must be at least 1
     // multiple frames can only occur in this example if one or more frames are received with a big time delay
     // this should usually not occur but handling this is shown in this example
     int iReceivedRscpFrames = 0;
-    while(!bStopExecution && ((iReceivedBytes > 0) || iReceivedRscpFrames == 0))
+    bResponseTimeout = false;
+    while(!bStopExecution && ((iReceivedBytes > iFrameStart) || iReceivedRscpFrames == 0))
     {
         // check and expand buffer
-        if((vecDynamicBuffer.size() - iReceivedBytes) < 4096) {
-            // check maximum size
-            if(vecDynamicBuffer.size() > RSCP_MAX_FRAME_LENGTH) {
-                // something went wrong and the size is more than possible by the RSCP protocol
-                printf("Maximum buffer size exceeded %lu\n", vecDynamicBuffer.size());
-                bStopExecution = true;
-                break;
-            }
-            // increase buffer size by 4096 bytes each time the remaining size is smaller than 4096
-            vecDynamicBuffer.resize(vecDynamicBuffer.size() + 4096);
+        if(!reserveReceiveBuffer()) {
+            bStopExecution = true;
+            break;
         }
         // receive data
         long iResult = SocketRecvData(iSocket, &vecDynamicBuffer[0] + iReceivedBytes, vecDynamicBuffer.size() - iReceivedBytes);
@@ -1687,12 +2808,15 @@ static void receiveLoop(bool & bStopExecution)
         {
             // check errno for the error code to detect if this is a timeout or a socket error
             if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
-                // receive timed out -> continue with re-sending the initial block
-                printf("Response receive timeout (retry)\n");
+                // receive timed out -> mainLoop() reconnects an established session for read requests,
+                // otherwise the request is aborted
+                printSessionError("Response receive timeout\n");
+                bResponseTimeout = true;
                 break;
             }
             // socket error -> check errno for failure code if needed
-            printf("Socket receive error. errno %i\n", errno);
+            printSessionError("Socket receive error. errno %i\n", errno);
+            bConnectionLost = true;
             bStopExecution = true;
             break;
         }
@@ -1701,49 +2825,52 @@ static void receiveLoop(bool & bStopExecution)
             // connection was closed regularly by peer
             // if this happens on startup each time the possible reason is
             // wrong AES password or wrong network subnet (adapt hosts.allow file required)
-            printf("Connection closed by peer\n");
+            printSessionError("Connection closed by peer\n");
+            bConnectionLost = true;
             bStopExecution = true;
             break;
         }
         // increment amount of received bytes
         iReceivedBytes += iResult;
 
+        // decrypt only the newly completed AES blocks, each byte is decrypted exactly once
+        int iNewBlocks = (ROUNDDOWN(iReceivedBytes, AES_BLOCK_SIZE) - iDecryptedBytes) / AES_BLOCK_SIZE;
+        if(iNewBlocks > 0) {
+            // the CBC chain continues with the last encrypted block decrypted before
+            aesDecrypter.SetIV(ucDecryptionIV, AES_BLOCK_SIZE);
+            aesDecrypter.Decrypt(&vecDynamicBuffer[0] + iDecryptedBytes, &vecPlainBuffer[0] + iDecryptedBytes, iNewBlocks);
+            iDecryptedBytes += iNewBlocks * AES_BLOCK_SIZE;
+            // store the IV value from encrypted buffer for next block decryption
+            memcpy(ucDecryptionIV, &vecDynamicBuffer[0] + iDecryptedBytes - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+        }
+
         // process all received frames
         while (!bStopExecution)
         {
-            // round down to a multiple of AES_BLOCK_SIZE
-            int iLength = ROUNDDOWN(iReceivedBytes, AES_BLOCK_SIZE);
+            int iLength = iDecryptedBytes - iFrameStart;
             // if not even 32 bytes were received then the frame is still incomplete
             if(iLength == 0) {
                 break;
             }
-            // resize temporary decryption buffer
-            std::vector<uint8_t> decryptionBuffer;
-            decryptionBuffer.resize(iLength);
-            // initialize encryption sequence IV value with value of previous block
-            aesDecrypter.SetIV(ucDecryptionIV, AES_BLOCK_SIZE);
-            // decrypt data from vecDynamicBuffer to temporary decryptionBuffer
-            aesDecrypter.Decrypt(&vecDynamicBuffer[0], &decryptionBuffer[0], iLength / AES_BLOCK_SIZE);
 
             // data was received, check if we received all data
-            int iProcessedBytes = processReceiveBuffer(&decryptionBuffer[0], iLength);
+            int iProcessedBytes = processReceiveBuffer(&vecPlainBuffer[0] + iFrameStart, iLength);
             if(iProcessedBytes < 0) {
                 // an error occured;
-                printf("Error parsing RSCP frame: %i\n", iProcessedBytes);
+                g_output.print("Error parsing RSCP frame: %i\n", iProcessedBytes);
                 // stop execution as the data received is not RSCP data
+                bRequestFailed = true;
                 bStopExecution = true;
                 break;
 
             }
             else if(iProcessedBytes > 0) {
                 // round up the processed bytes as iProcessedBytes does not include the zero padding bytes
-                iProcessedBytes = ROUNDUP(iProcessedBytes, AES_BLOCK_SIZE);
-                // store the IV value from encrypted buffer for next block decryption
-                memcpy(ucDecryptionIV, &vecDynamicBuffer[0] + iProcessedBytes - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
-                // move the encrypted data behind the current frame data (if any received) to the front
-                memcpy(&vecDynamicBuffer[0], &vecDynamicBuffer[0] + iProcessedBytes, vecDynamicBuffer.size() - iProcessedBytes);
-                // decrement the total received bytes by the amount of processed bytes
-                iReceivedBytes -= iProcessedBytes;
+                iFrameStart += ROUNDUP(iProcessedBytes, AES_BLOCK_SIZE);
+                // start at the front again if no data of a following frame was received (the usual case)
+                if(iFrameStart == iReceivedBytes) {
+                    resetReceiveBuffer();
+                }
                 // increment a counter that a valid frame was received and
                 // continue parsing process in case a 2nd valid frame is in the buffer as well
                 iReceivedRscpFrames++;
@@ -1758,14 +2885,106 @@ static void receiveLoop(bool & bStopExecution)
     }
 }
 
+// Prüft ob der Command Context eine Abfrage oder Einstellung an das S10 enthält
+static bool hasDeviceRequest(void)
+{
+    return g_ctx.leistungAendern || g_ctx.manuelleSpeicherladung || g_ctx.werteAbfragen ||
+           g_ctx.historieAbfrage || g_ctx.modulInfoDump || g_ctx.setEPReserve;
+}
+
+// Verschlüsselt einen Frame mit dem fortlaufenden IV und sendet ihn an das S10
+static int sendFrameBuffer(const SRscpFrameBuffer & frameBuffer)
+{
+    // resize temporary encryption buffer to a multiple of AES_BLOCK_SIZE
+    std::vector<uint8_t> encryptionBuffer;
+    encryptionBuffer.resize(ROUNDUP(frameBuffer.dataLength, AES_BLOCK_SIZE));
+    // zero padding for data above the desired length
+    memset(&encryptionBuffer[0] + frameBuffer.dataLength, 0, encryptionBuffer.size() - frameBuffer.dataLength);
+    // copy desired data length
+    memcpy(&encryptionBuffer[0], frameBuffer.data, frameBuffer.dataLength);
+    // set continues encryption IV
+    aesEncrypter.SetIV(ucEncryptionIV, AES_BLOCK_SIZE);
+    // start encryption from encryptionBuffer to encryptionBuffer, blocks = encryptionBuffer.size() / AES_BLOCK_SIZE
+    aesEncrypter.Encrypt(&encryptionBuffer[0], &encryptionBuffer[0], encryptionBuffer.size() / AES_BLOCK_SIZE);
+    // save new IV for next encryption block
+    memcpy(ucEncryptionIV, &encryptionBuffer[0] + encryptionBuffer.size() - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+
+    // send data on socket
+    int iResult = SocketSendData(iSocket, &encryptionBuffer[0], encryptionBuffer.size());
+    if(iResult < 0) {
+        g_output.print("Socket send error %i. errno %i\n", iResult, errno);
+        bConnectionLost = true;
+    }
+    return iResult;
+}
+
+bool connectToServer(void);
+
+// Setzbefehle ändern den Zustand des S10 und werden nach einem Verbindungsabbruch nie automatisch wiederholt
+static bool hasWriteRequest(void)
+{
+    return g_ctx.leistungAendern || g_ctx.manuelleSpeicherladung || g_ctx.setEPReserve;
+}
+
+// Wartet ms Millisekunden, bricht bei SIGINT/SIGTERM (Daemon, Exporter) vorzeitig ab
+static void waitMilliseconds(int64_t ms)
+{
+    int64_t deadline = SocketNowMs() + ms;
+    for (int64_t now = SocketNowMs(); now < deadline && !bDaemonStop; now = SocketNowMs()) {
+        int64_t slice = std::min(deadline - now, (int64_t)100);
+        struct timespec ts = { (time_t)(slice / 1000), (long)(slice % 1000) * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+}
+
+// Wartezeit vor dem Versuch attempt (0, 1, ...): exponentiell wachsend, zufällig auf 50-100 % verkürzt
+static int64_t reconnectDelay(unsigned attempt)
+{
+    static thread_local unsigned int seed = (unsigned int)SocketNowMs() ^ (unsigned int)(uintptr_t)&seed;
+    int64_t delay = RECONNECT_BASE_MS;
+    for (unsigned i = 0; i < attempt && delay < RECONNECT_MAX_MS; i++) {
+        delay *= 2;
+    }
+    delay = std::min(delay, (int64_t)RECONNECT_MAX_MS);
+    return delay / 2 + rand_r(&seed) % (delay / 2 + 1);
+}
+
+// Ein Versuch, die abgebrochene Sitzung neu aufzubauen. connectToServer() setzt die IVs auf 0xff zurück und leert den
+// Empfangspuffer, mainLoop() sendet danach zuerst TAG_RSCP_REQ_AUTHENTICATION.
+static bool reconnectToServer(unsigned attempt)
+{
+    SocketClose(iSocket);
+    iSocket = -1;
+    int64_t delay = reconnectDelay(attempt);
+    printSessionError("Verbindung zum S10 unterbrochen, neuer Verbindungsaufbau in %lld ms (Versuch %u von %u)\n",
+                      (long long)delay, attempt + 1, e3dc_config.reconnect_attempts);
+    waitMilliseconds(delay);
+    return !bDaemonStop && connectToServer();
+}
+
+// Anfragen des verlorenen Frames erneut stellen: History-Perioden ohne Antwort werden wieder angefragt, der DCB-Block
+// des Modul-Dumps wird ohnehin erst mit seiner Antwort weitergezählt, -r Tags sind in jedem Frame vollständig
+static void rewindInFlightRequests(void)
+{
+    if (g_ctx.historieAbfrage) {
+        g_ctx.historieAngefragt = g_ctx.historieEmpfangen;
+    }
+}
+
 static void mainLoop(void)
 {
     RscpProtocol protocol;
     bool bStopExecution = false;
-    int counter = 0;
+    // nur eine Sitzung, die schon authentifiziert war, wird nach einem Abbruch neu aufgebaut; scheitert bereits die
+    // erste Anmeldung, sind meist AES-Passwort oder Zugangsdaten falsch
+    bool bResumable = (iAuthenticated != 0);
+    unsigned iReconnects = 0;   // Versuche seit der letzten beantworteten Anfrage
 
     while(!bStopExecution)
     {
+        // the authentication request is not counted as a query of the command context
+        bool bAuthRequest = (iAuthenticated == 0);
+
         //--------------------------------------------------------------------------------------------------------------
         // RSCP Transmit Frame Block Data
         //--------------------------------------------------------------------------------------------------------------
@@ -1773,68 +2992,94 @@ static void mainLoop(void)
         memset(&frameBuffer, 0, sizeof(frameBuffer));
 
         // create an RSCP frame with requests to some example data
-        createRequestExample(&frameBuffer);
+        if(createRequestExample(&frameBuffer) < 0) {
+            bStopExecution = true;
+        }
+        bool bWriteRequest = !bAuthRequest && hasWriteRequest();
+        bool bRequestSent = (frameBuffer.dataLength > 0);
 
         // check that frame data was created
         if(frameBuffer.dataLength > 0)
         {
-            // resize temporary encryption buffer to a multiple of AES_BLOCK_SIZE
-            std::vector<uint8_t> encryptionBuffer;
-            encryptionBuffer.resize(ROUNDUP(frameBuffer.dataLength, AES_BLOCK_SIZE));
-            // zero padding for data above the desired length
-            memset(&encryptionBuffer[0] + frameBuffer.dataLength, 0, encryptionBuffer.size() - frameBuffer.dataLength);
-            // copy desired data length
-            memcpy(&encryptionBuffer[0], frameBuffer.data, frameBuffer.dataLength);
-            // set continues encryption IV
-            aesEncrypter.SetIV(ucEncryptionIV, AES_BLOCK_SIZE);
-            // start encryption from encryptionBuffer to encryptionBuffer, blocks = encryptionBuffer.size() / AES_BLOCK_SIZE
-            aesEncrypter.Encrypt(&encryptionBuffer[0], &encryptionBuffer[0], encryptionBuffer.size() / AES_BLOCK_SIZE);
-            // save new IV for next encryption block
-            memcpy(ucEncryptionIV, &encryptionBuffer[0] + encryptionBuffer.size() - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
-
-            // send data on socket
-            int iResult = SocketSendData(iSocket, &encryptionBuffer[0], encryptionBuffer.size());
-            if(iResult < 0) {
-                printf("Socket send error %i. errno %i\n", iResult, errno);
+            if(sendFrameBuffer(frameBuffer) < 0) {
                 bStopExecution = true;
             }
             else {
                 // go into receive loop and wait for response
                 receiveLoop(bStopExecution);
-                
-                // After first receive, check if we need more DCB requests
-                if (counter > 0) {
-                    if (!g_ctx.needMoreDCBRequests) {
-                        // No more requests needed - stop
+
+                if (bAuthRequest) {
+                    if (iAuthenticated == 0) {
+                        // wrong credentials or no response -> do not retry forever
+                        if (!bConnectionLost) {
+                            g_output.print("Authentifizierung fehlgeschlagen\n");
+                        }
+                        bStopExecution = true;
+                    } else if (!hasDeviceRequest()) {
+                        // nothing to query (e.g. daemon start) -> keep the authenticated session
                         bStopExecution = true;
                     }
+                } else if (!needMoreRequests()) {
+                    // No more requests needed - stop
+                    bStopExecution = true;
                 }
             }
         }
+        else if (!bAuthRequest) {
+            // nothing left to ask the S10 (e.g. all history periods answered from the cache)
+            bStopExecution = true;
+        }
         // free frame buffer memory
         protocol.destroyFrameData(&frameBuffer);
 
-        // main loop sleep / cycle time before next request (only if continuing)
-        if (!bStopExecution) {
-            sleep(1);
+        if (iAuthenticated != 0) {
+            bResumable = true;
+        }
+        // keine Antwort in einer bestehenden Sitzung: die Verbindung gilt als abgebrochen, eine verspätete Antwort
+        // ließe sich keiner Anfrage mehr zuordnen
+        if (bResponseTimeout && bResumable && bRequestSent) {
+            bConnectionLost = true;
+        }
+        if (bConnectionLost && bResumable && bRequestSent) {
+            if (bWriteRequest) {
+                // der Befehl kann das S10 erreicht haben, ob er ausgeführt wurde, ist unbekannt. Im Halte-Modus baut
+                // runHold() die Verbindung neu auf und sendet die nächste Auffrischung.
+                if (g_ctx.holdInterval == 0) {
+                    fprintf(stderr, "Verbindung während eines Setzbefehls unterbrochen, der Befehl wird nicht wiederholt\n");
+                }
+                bStopExecution = true;
+            } else {
+                bool bReconnected = false;
+                while (!bReconnected && iReconnects < e3dc_config.reconnect_attempts && !bDaemonStop) {
+                    bReconnected = reconnectToServer(iReconnects++);
+                }
+                if (bReconnected) {
+                    rewindInFlightRequests();
+                    bStopExecution = false;
+                }
+            }
+        } else if (!bConnectionLost && !bAuthRequest && bRequestSent) {
+            iReconnects = 0;
         }
 
-        counter++;
-
+        // the next request is sent as soon as the previous response has been processed
     }
+    // messages of the transport (timeout, authentication) are not followed by a frame
+    g_output.flush();
 }
 
 uint32_t getTagByName(const char* name) {
-    // Zuerst in geladenen Tags suchen
-    if (!loadedTags.empty()) {
-        for (auto& catPair : loadedTags) {
-            for (const auto& tag : catPair.second) {
-                if (strcasecmp(name, tag.name.c_str()) == 0) {
-                    return tag.hex;
-                }
-            }
+    // In geladenen Tags suchen (Groß-/Kleinschreibung egal)
+    if (g_tagDb.isOpen()) {
+        const TagDbEntry* entry = g_tagDb.findByName(name);
+        if (entry) {
+            return entry->hex;
         }
     }
+    auto it = g_tagRegistry.byName.find(upperCaseTagName(name));
+    if (it != g_tagRegistry.byName.end()) {
+        return it->second;
+    }
     
     // Tag nicht gefunden
     fprintf(stderr, "FEHLER: Tag '%s' nicht in der Tags-Datei gefunden!\n", name);
@@ -1931,17 +3176,24 @@ void printTagList(int category) {
 
 void usage(void){
     fprintf(stderr, "\n   Usage: e3dcset [-c LadeLeistung] [-d EntladeLeistung] [-e LadungsMenge] [-E Reserve] [-a] [-p Pfad zur Konfigurationsdatei] [-t Pfad zur Tags-Datei]\n");
+    fprintf(stderr, "          e3dcset [-c LadeLeistung] [-d EntladeLeistung] --hold intervall [-p Pfad zur Konfigurationsdatei]\n");
     fprintf(stderr, "          e3dcset -r TAG_NAME [-i Modul-Index] [-q] [-p Pfad zur Konfigurationsdatei] [-t Pfad zur Tags-Datei]\n");
     fprintf(stderr, "          e3dcset -m <Modul-Index> [-p Pfad zur Konfigurationsdatei]\n");
     fprintf(stderr, "          e3dcset -l [kategorie]\n");
-    fprintf(stderr, "          e3dcset -H <typ> [-D datum] [-p Pfad zur Konfigurationsdatei]\n\n");
+    fprintf(stderr, "          e3dcset -H <typ> [-D datum | --from datum [--to datum]] [--series csv|jsonl] [-p Pfad zur Konfigurationsdatei]\n");
+    fprintf(stderr, "          e3dcset --daemon <socket> [-p Pfad zur Konfigurationsdatei]\n");
+    fprintf(stderr, "          e3dcset --fleet <geraeteliste> [--workers n] (-r TAG1,TAG2,... | -m <Modul-Index> | -H <typ> ...) [--format format]\n");
+    fprintf(stderr, "          e3dcset --exporter [adresse:]port -r TAG1[@intervall],TAG2,... [--interval intervall] [--store verzeichnis] [-i Modul-Index]\n");
+    fprintf(stderr, "          e3dcset query --store verzeichnis -r TAG1,TAG2,... [--from zeit] [--to zeit] [--step intervall] [--agg funktion] [-q]\n");
+    fprintf(stderr, "          e3dcset --compile-tags[=ausgabe] [-t Pfad zur Tags-Datei]\n\n");
     fprintf(stderr, "   Optionen:\n");
     fprintf(stderr, "     -c  LadeLeistung in Watt setzen\n");
     fprintf(stderr, "     -d  EntladeLeistung in Watt setzen\n");
     fprintf(stderr, "     -e  Manuelle Ladungsmenge in Wh setzen (0 = stoppen)\n");
     fprintf(stderr, "     -E  Notstromreserve in Wh setzen (Workaround fuer Netzladung)\n");
     fprintf(stderr, "     -a  Automatik-Modus aktivieren\n");
-    fprintf(stderr, "     -r  Wert abfragen (Tag-Name, Named Tag oder Hex-Wert)\n");
+    fprintf(stderr, "     --hold <i>  -c/-d alle <i> (z.B. 5s) erneut senden, bis Strg+C; Antworten des S10 werden geprueft\n");
+    fprintf(stderr, "     -r  Wert abfragen (Tag-Name, Named Tag oder Hex-Wert, mehrere durch Komma getrennt)\n");
     fprintf(stderr, "     -i  Batterie-Modul Index (0 = erstes Modul, Standard: 0)\n");
     fprintf(stderr, "     -m  Alle Werte eines Batterie-Moduls anzeigen (Modul-Info-Dump)\n");
     fprintf(stderr, "     -q  Quiet Mode - nur Wert ausgeben (für Scripting)\n");
@@ -1949,7 +3201,21 @@ void usage(void){
     fprintf(stderr, "     -p  Pfad zur Konfigurationsdatei (Standard: e3dcset.config)\n");
     fprintf(stderr, "     -t  Pfad zur Tags-Datei (Standard: e3dcset.tags)\n");
     fprintf(stderr, "     -H  Historische Daten abfragen (day/week/month/year)\n");
-    fprintf(stderr, "     -D  Datum (Format: YYYY-MM-DD oder 'today', Standard: heute)\n\n");
+    fprintf(stderr, "     -D  Datum (Format: YYYY-MM-DD oder 'today', Standard: heute)\n");
+    fprintf(stderr, "     --from/--to <datum>  Alle Perioden von/bis Datum (einschliesslich, --to Standard: heute)\n");
+    fprintf(stderr, "     --series <format>  Werte je Intervall statt Zusammenfassung ausgeben (csv oder jsonl)\n");
+    fprintf(stderr, "     --format <format>  Ausgabe als text (Standard), json, jsonl oder csv fuer -r, -m, -H und Setzbefehle\n");
+    fprintf(stderr, "     --cache <dir>      Abgeschlossene History-Perioden in <dir> zwischenspeichern (history_cache)\n");
+    fprintf(stderr, "     --no-cache         History-Cache fuer diesen Aufruf nicht verwenden\n");
+    fprintf(stderr, "     --daemon <socket>  Authentifizierte Sitzung halten, Abfragen ueber Unix-Socket bedienen\n");
+    fprintf(stderr, "     --socket <socket>  Abfrage ueber einen laufenden Daemon ausfuehren\n");
+    fprintf(stderr, "     --fleet <datei>    Abfrage an alle Geraete der Liste (je Zeile [name=]Konfigurationsdatei)\n");
+    fprintf(stderr, "     --workers <n>      Anzahl gleichzeitig abgefragter Geraete im Fleet-Modus (Standard: 4)\n");
+    fprintf(stderr, "     --exporter <port>  Prometheus-Metriken der -r Tags unter http://<adresse>:<port>/metrics bereitstellen\n");
+    fprintf(stderr, "     --interval <i>     Standard-Abfrageintervall des Exporters (Standard: 10s, Einheiten s/m/h/d)\n");
+    fprintf(stderr, "                        eigenes Intervall je Tag mit -r TAG@intervall, z.B. EMS_POWER_PV@1s,BAT_REQ_RSOC@1m\n");
+    fprintf(stderr, "     --store <dir>      Abgefragte Werte des Exporters im Zeitreihen-Speicher <dir> ablegen (Abfrage: e3dcset query)\n");
+    fprintf(stderr, "     --compile-tags     Tags-Datei und RscpTags.h in <tags>.bin kompilieren (schneller Start)\n\n");
     fprintf(stderr, "   Hinweis: -r, -m und -H können nicht mit -c, -d, -e, -E oder -a kombiniert werden\n\n");
     fprintf(stderr, "   Beispiele:\n");
     fprintf(stderr, "     e3dcset -l                      # Kategorie-Übersicht\n");
@@ -1962,11 +3228,19 @@ void usage(void){
     fprintf(stderr, "     e3dcset -m 0                    # Alle Werte von Modul 0\n");
     fprintf(stderr, "     e3dcset -m 1                    # Alle Werte von Modul 1\n");
     fprintf(stderr, "     e3dcset -r 0x01000008           # Mit Hex-Wert\n");
+    fprintf(stderr, "     e3dcset -r EMS_POWER_PV,EMS_POWER_HOME,BAT_REQ_RSOC -q  # Mehrere Werte in einem Frame\n");
     fprintf(stderr, "     e3dcset -H day                  # Heutige Tagesdaten\n");
     fprintf(stderr, "     e3dcset -H day -D 2024-11-20    # Tagesdaten vom 20.11.2024\n");
+    fprintf(stderr, "     e3dcset -H day --from 2025-01-01 --to 2025-12-31  # Jeden Tag des Jahres 2025\n");
+    fprintf(stderr, "     e3dcset -H day --series csv > heute.csv       # Viertelstundenwerte von heute als CSV\n");
+    fprintf(stderr, "     e3dcset -m 0 --format csv > modul0.csv        # Modul-Info-Dump als CSV\n");
+    fprintf(stderr, "     e3dcset -d 0 --hold 10s         # Entladen sperren, solange e3dcset laeuft\n");
     fprintf(stderr, "     e3dcset -E 2600                 # Notstromreserve auf 2600 Wh setzen\n");
     fprintf(stderr, "     e3dcset -E 0                    # Notstromreserve deaktivieren\n");
-    fprintf(stderr, "     e3dcset -t /path/custom.tags -l 1  # Custom Tags-Datei verwenden\n\n");
+    fprintf(stderr, "     e3dcset -t /path/custom.tags -l 1  # Custom Tags-Datei verwenden\n");
+    fprintf(stderr, "     e3dcset --daemon /tmp/e3dc.sock    # Daemon starten\n");
+    fprintf(stderr, "     e3dcset --socket /tmp/e3dc.sock -r EMS_POWER_PV  # Abfrage ueber Daemon\n");
+    fprintf(stderr, "     e3dcset query --store /var/lib/e3dc -r EMS_POWER_PV --from -1d --step 15m  # Gespeicherte Werte\n\n");
     exit(EXIT_FAILURE);
 }
 
@@ -1980,6 +3254,8 @@ void readConfig(void){
 
     if(fp) {
 
+        e3dc_config.reconnect_attempts = RECONNECT_ATTEMPTS;
+
         while (fgets(line, sizeof(line), fp)) {
 
                 memset(var, 0, sizeof(var));
@@ -2016,6 +3292,15 @@ void readConfig(void){
 
                         else if(strcmp(var, "debug") == 0)
                                 debug = atoi(value);
+
+                        else if(strcmp(var, "history_cache") == 0)
+                                snprintf(e3dc_config.history_cache, sizeof(e3dc_config.history_cache), "%s", value);
+
+                        else if(strcmp(var, "history_cache_mb") == 0)
+                                e3dc_config.history_cache_mb = atoi(value);
+
+                        else if(strcmp(var, "reconnect_attempts") == 0)
+                                e3dc_config.reconnect_attempts = atoi(value);
                 }
             }
 
@@ -2031,6 +3316,8 @@ void readConfig(void){
         DEBUG("e3dc_user=%s\n", strlen(e3dc_config.e3dc_user) > 0 ? "***@***" : "");
         DEBUG("e3dc_password=%s\n", strlen(e3dc_config.e3dc_password) > 0 ? "********" : "");
         DEBUG("aes_password=%s\n", strlen(e3dc_config.aes_password) > 0 ? "********" : "");
+        DEBUG("history_cache=%s\n", e3dc_config.history_cache);
+        DEBUG("reconnect_attempts=%u\n", e3dc_config.reconnect_attempts);
         DEBUG("----------------------------------------------------------\n");
 
         fclose(fp);
@@ -2060,6 +3347,13 @@ void checkArguments(void){
         exit(EXIT_FAILURE);
     }
 
+    for (size_t i = 0; i < g_ctx.leseTags.size(); i++){
+        if (g_ctx.leseTags[i] == 0){
+            fprintf(stderr, "[-r] benoetigt gueltige TAG-Werte (z.B. 0x01000001 oder battery-soc)\n\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
     if (g_ctx.werteAbfragen && g_ctx.leseTag == 0){
         fprintf(stderr, "[-r] benoetigt einen gueltigen TAG-Wert (z.B. 0x01000001 oder battery-soc)\n\n");
         exit(EXIT_FAILURE);
@@ -2080,10 +3374,55 @@ void checkArguments(void){
         exit(EXIT_FAILURE);
     }
     
-    if (g_ctx.historieAbfrage && !g_ctx.historieDatum){
+    if ((g_ctx.historieVon || g_ctx.historieBis) && !g_ctx.historieAbfrage){
+        fprintf(stderr, "[--from] und [--to] koennen nur zusammen mit [-H] verwendet werden\n\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (g_ctx.historieSerie != SERIES_NONE && !g_ctx.historieAbfrage){
+        fprintf(stderr, "[--series] kann nur zusammen mit [-H] verwendet werden\n\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (g_ctx.ausgabeFormat != OUTPUT_TEXT && (g_ctx.quietMode || g_ctx.historieSerie != SERIES_NONE)){
+        fprintf(stderr, "[--format] kann nicht zusammen mit [-q] oder [--series] verwendet werden\n\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (g_ctx.ausgabeFormat != OUTPUT_TEXT && (g_ctx.exporterMode || g_ctx.daemonMode || g_ctx.holdInterval > 0)){
+        fprintf(stderr, "[--format] gilt nur für einzelne Abfragen, nicht für [--exporter], [--daemon] oder [--hold]\n\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (g_ctx.holdInterval > 0 && (!(g_ctx.ladeLeistungGesetzt || g_ctx.entladeLeistungGesetzt) ||
+                                   g_ctx.manuelleSpeicherladung || g_ctx.setEPReserve || g_ctx.daemonMode || g_ctx.exporterMode)){
+        fprintf(stderr, "[--hold] benoetigt [-c] und/oder [-d] und kann nicht mit [-e], [-E], [--daemon] oder [--exporter] verwendet werden\n\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (g_ctx.historieBis && !g_ctx.historieVon){
+        fprintf(stderr, "[--to] benoetigt [--from]\n\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (g_ctx.historieVon && g_ctx.historieDatum){
+        fprintf(stderr, "[-D] kann nicht zusammen mit [--from] verwendet werden\n\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (g_ctx.historieVon && !g_ctx.historieBis){
+        g_ctx.historieBis = strdup("today");
+    }
+
+    if (g_ctx.historieAbfrage && !g_ctx.historieDatum && !g_ctx.historieVon){
         g_ctx.historieDatum = strdup("today");
     }
 
+    if (g_ctx.historieAbfrage){
+        // Datumsangaben prüfen, bevor eine Verbindung aufgebaut wird; mainLoop() beginnt bei der ersten Periode
+        setupHistoryPeriods();
+    }
+
     if (g_ctx.ladeLeistungGesetzt && (g_ctx.ladeLeistung < 0 || g_ctx.ladeLeistung < e3dc_config.MIN_LEISTUNG || g_ctx.ladeLeistung > e3dc_config.MAX_LEISTUNG)){
         fprintf(stderr, "[-c g_ctx.ladeLeistung] muss zwischen %i und %i liegen\n\n", e3dc_config.MIN_LEISTUNG, e3dc_config.MAX_LEISTUNG);
         exit(EXIT_FAILURE);
@@ -2104,25 +3443,52 @@ void checkArguments(void){
         exit(EXIT_FAILURE);
     }
 
-    if (!g_ctx.leistungAendern && !g_ctx.manuelleSpeicherladung && !g_ctx.werteAbfragen && !g_ctx.historieAbfrage && !g_ctx.modulInfoDump && !g_ctx.setEPReserve){
+    for (size_t i = 0; i < g_ctx.leseIntervalle.size(); i++){
+        if (g_ctx.leseIntervalle[i] > 0 && !g_ctx.exporterMode){
+            fprintf(stderr, "[-r] TAG@intervall kann nur zusammen mit [--exporter] verwendet werden\n\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (g_ctx.exporterMode && (g_ctx.daemonMode || !g_ctx.werteAbfragen || g_ctx.quietMode)){
+        fprintf(stderr, "[--exporter] benoetigt die Tags mit [-r] und kann nicht mit [--daemon] oder [-q] verwendet werden\n\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (g_ctx.storePath && !g_ctx.exporterMode){
+        fprintf(stderr, "[--store] kann nur zusammen mit [--exporter] verwendet werden (Abfrage mit: e3dcset query)\n\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (g_ctx.daemonMode && hasDeviceRequest()){
+        fprintf(stderr, "[--daemon] nimmt keine Abfrage entgegen, Abfragen erfolgen ueber [--socket]\n\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (!g_ctx.daemonMode && !hasDeviceRequest()){
         fprintf(stderr, "Keine Verbindung mit Server erforderlich\n\n");
         exit(EXIT_FAILURE);
     }
 
 }
 
-void connectToServer(void){
+bool connectToServer(void){
 
     DEBUG("Connecting to server %s:%i\n", e3dc_config.server_ip, e3dc_config.server_port);
 
     iSocket = SocketConnect(e3dc_config.server_ip, e3dc_config.server_port);
 
     if(iSocket < 0) {
-        printf("Connection failed\n");
-        exit(EXIT_FAILURE);
+        fprintf(stderr, "Connection failed\n");
+        return false;
     }
     DEBUG("Connected successfully\n");
 
+    // a new connection always starts with a new authentication and an empty receive buffer
+    iAuthenticated = 0;
+    bConnectionLost = false;
+    resetReceiveBuffer();
+
     // create AES key and set AES parameters
     {
         // initialize AES encryptor and decryptor IV
@@ -2140,12 +3506,1288 @@ void connectToServer(void){
         memcpy(ucAesKey, e3dc_config.aes_password, iPasswordLength);
 
         // set encryptor and decryptor parameters
-        aesDecrypter.SetParameters(AES_KEY_SIZE * 8, AES_BLOCK_SIZE * 8);
-        aesEncrypter.SetParameters(AES_KEY_SIZE * 8, AES_BLOCK_SIZE * 8);
-        aesDecrypter.StartDecryption(ucAesKey);
-        aesEncrypter.StartEncryption(ucAesKey);
+        // the expanded key schedule only depends on the key, it is kept for reconnects (only the IVs start again)
+        if(!bAesKeyScheduled || memcmp(ucScheduledAesKey, ucAesKey, AES_KEY_SIZE) != 0) {
+            aesDecrypter.SetParameters(AES_KEY_SIZE * 8, AES_BLOCK_SIZE * 8);
+            aesEncrypter.SetParameters(AES_KEY_SIZE * 8, AES_BLOCK_SIZE * 8);
+            aesDecrypter.StartDecryption(ucAesKey);
+            aesEncrypter.StartEncryption(ucAesKey);
+            memcpy(ucScheduledAesKey, ucAesKey, AES_KEY_SIZE);
+            bAesKeyScheduled = true;
+        }
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+// Daemon-Modus: eine authentifizierte RSCP-Sitzung bedient Abfragen über einen lokalen Unix-Socket
+//--------------------------------------------------------------------------------------------------------------
+// Protokoll: der Client sendet den geprüften Command Context als "schluessel=wert" Zeilen,
+// abgeschlossen durch eine Leerzeile. Der Daemon antwortet mit der Ausgabe, danach folgt ein Nullbyte und der Exit-Code
+// der Abfrage als "status=n" Zeile; dann schließt er die Verbindung. Die Ausgabe selbst enthält nie ein Nullbyte.
+
+#define DAEMON_STATUS_MARKER '\0'
+
+static void daemonSignalHandler(int)
+{
+    bDaemonStop = 1;
+}
+
+static int openUnixSocket(const char* path, bool listening)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket-Pfad '%s' ist zu lang\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        fprintf(stderr, "Unix-Socket kann nicht erstellt werden. errno %i\n", errno);
+        return -1;
+    }
+
+    if (listening) {
+        unlink(path);
+        mode_t oldMask = umask(0077);  // nur der Eigentümer darf den Daemon nutzen
+        int iResult = bind(fd, (struct sockaddr *) &addr, sizeof(addr));
+        umask(oldMask);
+        if (iResult < 0 || listen(fd, 8) < 0) {
+            fprintf(stderr, "Unix-Socket '%s' kann nicht geöffnet werden. errno %i\n", path, errno);
+            close(fd);
+            return -1;
+        }
+    } else if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "Keine Verbindung zum Daemon '%s'. errno %i\n", path, errno);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Exit-Code einer Abfrage der Sitzung: Fehler, wenn die Anmeldung gescheitert ist, die Verbindung abgebrochen und nicht
+// wieder aufgebaut wurde, die Abfrage unvollständig ist (History-Perioden ohne Antwort, ungültiger Frame) oder das S10
+// die Lade-/Entladeleistung abgelehnt hat (gemeldet auf stderr)
+static int sessionExitStatus(void)
+{
+    if (bConnectionLost || iAuthenticated == 0 || bRequestFailed) {
+        return EXIT_FAILURE;
+    }
+    if (g_ctx.leistungAendern && !checkPowerSettingsResult("")) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Exit-Code der Abfrage nach der Ausgabe an den Client (siehe Protokoll)
+static void sendDaemonStatus(int clientSocket, int status)
+{
+    char trailer[32];
+    int length = snprintf(trailer + 1, sizeof(trailer) - 1, "status=%d\n", status) + 1;
+    trailer[0] = DAEMON_STATUS_MARKER;
+    send(clientSocket, trailer, length, MSG_NOSIGNAL);
+}
+
+// Serialisiert die Abfrage-relevanten Felder des Command Context
+static std::string serializeContext(const CommandContext & ctx)
+{
+    char line[256];
+    std::string out;
+    snprintf(line, sizeof(line), "werteAbfragen=%d\nleseTag=%u\nbatIndex=%u\nquietMode=%d\nmodulInfoDump=%d\n",
+             ctx.werteAbfragen, ctx.leseTag, ctx.batIndex, ctx.quietMode, ctx.modulInfoDump);
+    out += line;
+    for (size_t i = 0; i < ctx.leseTags.size(); i++) {
+        snprintf(line, sizeof(line), "leseTags=%u\n", ctx.leseTags[i]);
+        out += line;
+    }
+    snprintf(line, sizeof(line), "leistungAendern=%d\nautomatischLeistungEinstellen=%d\nladeLeistungGesetzt=%d\nladeLeistung=%u\n",
+             ctx.leistungAendern, ctx.automatischLeistungEinstellen, ctx.ladeLeistungGesetzt, ctx.ladeLeistung);
+    out += line;
+    snprintf(line, sizeof(line), "entladeLeistungGesetzt=%d\nentladeLeistung=%u\nmanuelleSpeicherladung=%d\nladungsMenge=%u\n",
+             ctx.entladeLeistungGesetzt, ctx.entladeLeistung, ctx.manuelleSpeicherladung, ctx.ladungsMenge);
+    out += line;
+    snprintf(line, sizeof(line), "setEPReserve=%d\nepReserveWh=%.0f\nhistorieAbfrage=%d\nhistorieSerie=%d\nausgabeFormat=%d\n",
+             ctx.setEPReserve, ctx.epReserveWh, ctx.historieAbfrage, ctx.historieSerie, ctx.ausgabeFormat);
+    out += line;
+    if (ctx.historieTyp) {
+        out += std::string("historieTyp=") + ctx.historieTyp + "\n";
+    }
+    if (ctx.historieDatum) {
+        out += std::string("historieDatum=") + ctx.historieDatum + "\n";
+    }
+    if (ctx.historieVon) {
+        out += std::string("historieVon=") + ctx.historieVon + "\n";
+    }
+    if (ctx.historieBis) {
+        out += std::string("historieBis=") + ctx.historieBis + "\n";
+    }
+    out += "\n";
+    return out;
+}
+
+// Setzt die Abfrage-Felder des globalen Command Context aus einer Client-Anfrage
+static void deserializeContext(char * request)
+{
+    free(g_ctx.historieTyp);
+    free(g_ctx.historieDatum);
+    free(g_ctx.historieVon);
+    free(g_ctx.historieBis);
+    CommandContext defaults;
+    free(defaults.configPath);
+    free(defaults.tagfilePath);
+    defaults.configPath = g_ctx.configPath;
+    defaults.tagfilePath = g_ctx.tagfilePath;
+    defaults.socketPath = g_ctx.socketPath;
+    defaults.daemonMode = g_ctx.daemonMode;
+    g_ctx = defaults;
+
+    char *savePtr = NULL;
+    for (char *line = strtok_r(request, "\n", &savePtr); line; line = strtok_r(NULL, "\n", &savePtr)) {
+        char *value = strchr(line, '=');
+        if (!value) continue;
+        *value++ = '\0';
+
+        if (strcmp(line, "werteAbfragen") == 0) g_ctx.werteAbfragen = atoi(value);
+        else if (strcmp(line, "leseTag") == 0) g_ctx.leseTag = strtoul(value, NULL, 0);
+        else if (strcmp(line, "leseTags") == 0) g_ctx.leseTags.push_back(strtoul(value, NULL, 0));
+        else if (strcmp(line, "batIndex") == 0) g_ctx.batIndex = (uint16_t)atoi(value);
+        else if (strcmp(line, "quietMode") == 0) g_ctx.quietMode = atoi(value);
+        else if (strcmp(line, "modulInfoDump") == 0) g_ctx.modulInfoDump = atoi(value);
+        else if (strcmp(line, "leistungAendern") == 0) g_ctx.leistungAendern = atoi(value);
+        else if (strcmp(line, "automatischLeistungEinstellen") == 0) g_ctx.automatischLeistungEinstellen = atoi(value);
+        else if (strcmp(line, "ladeLeistungGesetzt") == 0) g_ctx.ladeLeistungGesetzt = atoi(value);
+        else if (strcmp(line, "ladeLeistung") == 0) g_ctx.ladeLeistung = strtoul(value, NULL, 0);
+        else if (strcmp(line, "entladeLeistungGesetzt") == 0) g_ctx.entladeLeistungGesetzt = atoi(value);
+        else if (strcmp(line, "entladeLeistung") == 0) g_ctx.entladeLeistung = strtoul(value, NULL, 0);
+        else if (strcmp(line, "manuelleSpeicherladung") == 0) g_ctx.manuelleSpeicherladung = atoi(value);
+        else if (strcmp(line, "ladungsMenge") == 0) g_ctx.ladungsMenge = strtoul(value, NULL, 0);
+        else if (strcmp(line, "setEPReserve") == 0) g_ctx.setEPReserve = atoi(value);
+        else if (strcmp(line, "epReserveWh") == 0) g_ctx.epReserveWh = (float)atof(value);
+        else if (strcmp(line, "historieAbfrage") == 0) g_ctx.historieAbfrage = atoi(value);
+        else if (strcmp(line, "historieSerie") == 0) g_ctx.historieSerie = (HistorySeriesFormat)atoi(value);
+        else if (strcmp(line, "ausgabeFormat") == 0) g_ctx.ausgabeFormat = (OutputFormat)atoi(value);
+        else if (strcmp(line, "historieTyp") == 0) g_ctx.historieTyp = strdup(value);
+        else if (strcmp(line, "historieDatum") == 0) g_ctx.historieDatum = strdup(value);
+        else if (strcmp(line, "historieVon") == 0) g_ctx.historieVon = strdup(value);
+        else if (strcmp(line, "historieBis") == 0) g_ctx.historieBis = strdup(value);
+    }
+}
+
+// Bearbeitet eine Client-Anfrage: die Ausgabe der Response-Handler wird auf den Client umgeleitet
+static void handleDaemonClient(int clientSocket)
+{
+    // ein Client, der die Anfrage nicht abschließt, darf den Daemon nicht blockieren
+    struct timeval tv;
+    tv.tv_sec = DAEMON_RECEIVE_TIMEOUT;
+    tv.tv_usec = 0;
+    setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    std::string request;
+    char buffer[4096];
+    bool complete = false;
+    while (request.size() <= DAEMON_REQUEST_MAX) {
+        ssize_t n = recv(clientSocket, buffer, sizeof(buffer), 0);
+        if (n <= 0) break;
+        request.append(buffer, n);
+        if (request.find("\n\n") != std::string::npos) {
+            complete = true;
+            break;
+        }
+    }
+    if (!complete) {
+        char message[128];
+        if (request.size() > DAEMON_REQUEST_MAX) {
+            snprintf(message, sizeof(message), "Fehler: Anfrage an den Daemon ist zu groß (max. %d Bytes)\n", DAEMON_REQUEST_MAX);
+        } else {
+            snprintf(message, sizeof(message), "Fehler: Unvollständige Anfrage an den Daemon\n");
+        }
+        fputs(message, stderr);
+        send(clientSocket, message, strlen(message), MSG_NOSIGNAL);
+        sendDaemonStatus(clientSocket, EXIT_FAILURE);
+        return;
+    }
+
+    deserializeContext(&request[0]);
+
+    fflush(stdout);
+    fflush(stderr);
+    int savedStdout = dup(STDOUT_FILENO);
+    int savedStderr = dup(STDERR_FILENO);
+    dup2(clientSocket, STDOUT_FILENO);
+    dup2(clientSocket, STDERR_FILENO);
+
+    int status = EXIT_FAILURE;
+    bRequestFailed = false;
+    resetPowerSettingsResult();
+    // the session may have been closed by the S10 since the last request
+    g_output.setFormat(g_ctx.ausgabeFormat);
+    if (iSocket < 0 && !connectToServer()) {
+        printf("Keine Verbindung zum Hauskraftwerk\n");
+    } else {
+        g_output.begin(stdout);
+        mainLoop();
+        g_output.end();
+        status = sessionExitStatus();
+    }
+    g_output.setFormat(OUTPUT_TEXT);
+
+    fflush(stdout);
+    fflush(stderr);
+    dup2(savedStdout, STDOUT_FILENO);
+    dup2(savedStderr, STDERR_FILENO);
+    close(savedStdout);
+    close(savedStderr);
+    sendDaemonStatus(clientSocket, status);
+
+    if (bConnectionLost) {
+        DEBUG("RSCP-Verbindung verloren, Neuaufbau bei der nächsten Anfrage\n");
+        SocketClose(iSocket);
+        iSocket = -1;
+    }
+}
+
+static int runDaemon(void)
+{
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = daemonSignalHandler;  // kein SA_RESTART, damit accept() unterbrochen wird
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    int listenSocket = openUnixSocket(g_ctx.socketPath, true);
+    if (listenSocket < 0) {
+        return EXIT_FAILURE;
+    }
+
+    openHistoryCache();
+
+    // Verbindung aufbauen und authentifizieren, bevor die erste Anfrage angenommen wird
+    if (!connectToServer()) {
+        close(listenSocket);
+        unlink(g_ctx.socketPath);
+        return EXIT_FAILURE;
+    }
+    mainLoop();
+    if (iAuthenticated == 0) {
+        SocketClose(iSocket);
+        close(listenSocket);
+        unlink(g_ctx.socketPath);
+        return EXIT_FAILURE;
+    }
+    DEBUG("Daemon wartet auf Anfragen an %s\n", g_ctx.socketPath);
+
+    while (!bDaemonStop) {
+        int clientSocket = accept(listenSocket, NULL, NULL);
+        if (clientSocket < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "accept() fehlgeschlagen. errno %i\n", errno);
+            break;
+        }
+        handleDaemonClient(clientSocket);
+        close(clientSocket);
+    }
+
+    close(listenSocket);
+    unlink(g_ctx.socketPath);
+    SocketClose(iSocket);
+    DEBUG("Daemon beendet\n");
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+// Exporter-Modus: HTTP-Listener für /metrics, ein Poller-Thread fragt alle Tags in einem Frame pro Intervall ab
+//--------------------------------------------------------------------------------------------------------------
+// Scrapes werden aus dem zuletzt erzeugten Text beantwortet und warten nie auf das S10.
+
+static std::mutex g_exporterMutex;
+static std::condition_variable g_exporterWakeup;
+static std::string g_exporterSnapshot;  // gerenderte Metriken der letzten Abfrage, geschützt durch g_exporterMutex
+static TimeSeriesStore g_store;         // nur mit --store geöffnet, wird nur vom Poller-Thread beschrieben
+
+// Metrik-Namen und Labels aus den Tag-Namen der Tags-Datei; ein mehrfach angegebener Tag wird eine Metrik
+// mit dem kürzesten seiner Intervalle (doppelte Metriken lehnt Prometheus ab)
+static void setupExporterMetrics(void)
+{
+    g_exporterMetrics.clear();
+    for (size_t i = 0; i < g_ctx.leseTags.size(); i++) {
+        uint32_t tag = g_ctx.leseTags[i];
+        int interval = (i < g_ctx.leseIntervalle.size() && g_ctx.leseIntervalle[i] > 0) ? g_ctx.leseIntervalle[i] : g_ctx.pollInterval;
+        bool duplicate = false;
+        for (size_t m = 0; m < g_exporterMetrics.size(); m++) {
+            if (g_exporterMetrics[m].tag == tag) {
+                g_exporterMetrics[m].interval = std::min(g_exporterMetrics[m].interval, interval);
+                duplicate = true;
+                break;
+            }
+        }
+        if (duplicate) {
+            continue;
+        }
+        ExporterMetric metric;
+        metric.tag = tag;
+        metric.number = 0;
+        metric.interval = interval;
+
+        char buffer[128];
+        const char* name = getTagName(tag);
+        if (!name) {
+            snprintf(buffer, sizeof(buffer), "TAG_%08X", tag);
+            name = buffer;
+        }
+        metric.name = "e3dc_";
+        for (const char* c = name; *c; c++) {
+            metric.name += isalnum((unsigned char)*c) ? (char)tolower((unsigned char)*c) : '_';
+        }
+
+        const char* description = getTagDescription(tag);
+        if (description && *description) {
+            // HELP-Text: Backslash und Zeilenumbruch müssen maskiert werden
+            for (const char* c = description; *c; c++) {
+                if (*c == '\\') metric.help += "\\\\";
+                else if (*c == '\n') metric.help += "\\n";
+                else metric.help += *c;
+            }
+        } else {
+            snprintf(buffer, sizeof(buffer), "RSCP Tag 0x%08X", tag);
+            metric.help = buffer;
+        }
+
+        if (isBatRequestTag(tag)) {
+            snprintf(buffer, sizeof(buffer), "tag=\"0x%08X\",index=\"%u\"", tag, g_ctx.batIndex);
+        } else {
+            snprintf(buffer, sizeof(buffer), "tag=\"0x%08X\"", tag);
+        }
+        metric.labels = buffer;
+        g_exporterMetrics.push_back(metric);
+    }
+}
+
+// Gruppe von Tags mit gleichem Intervall; alle Gruppen liegen auf einem gemeinsamen Zeitraster ab dem Start,
+// Gruppen die im selben Takt fällig sind, werden in einem Frame abgefragt
+struct PollGroup {
+    int interval;                                  // Sekunden
+    std::vector<uint32_t> tags;
+    std::chrono::steady_clock::time_point next;    // nächster fälliger Takt
+    // Statistik
+    unsigned long ticks;          // abgefragte Takte
+    unsigned long skipped;        // ausgelassene Takte, weil die vorherige Abfrage noch lief
+    double lastLag;               // Verspätung des letzten Takts gegenüber dem Raster
+    double lastDuration;          // Dauer des letzten Frames mit dieser Gruppe
+    double maxDuration;
+};
+
+struct ExporterStatus {
+    bool up;
+    unsigned long polls;
+    unsigned long pollErrors;
+    double pollDuration;
+    double lastSuccess;  // Unix-Zeit der letzten erfolgreichen Abfrage, 0 = noch keine
+};
+
+// wird nur vom Poller-Thread verändert, renderExporterMetrics() liest sie im selben Thread
+static std::vector<PollGroup> g_pollGroups;
+
+// Gruppen nach Intervall aus den Metriken bilden, kürzestes Intervall zuerst
+static void setupPollGroups(void)
+{
+    g_pollGroups.clear();
+    for (size_t i = 0; i < g_exporterMetrics.size(); i++) {
+        const ExporterMetric & metric = g_exporterMetrics[i];
+        size_t g = 0;
+        while (g < g_pollGroups.size() && g_pollGroups[g].interval != metric.interval) g++;
+        if (g == g_pollGroups.size()) {
+            PollGroup group;
+            group.interval = metric.interval;
+            group.ticks = 0;
+            group.skipped = 0;
+            group.lastLag = 0;
+            group.lastDuration = 0;
+            group.maxDuration = 0;
+            g_pollGroups.push_back(group);
+        }
+        g_pollGroups[g].tags.push_back(metric.tag);
+    }
+    std::sort(g_pollGroups.begin(), g_pollGroups.end(),
+              [](const PollGroup & a, const PollGroup & b) { return a.interval < b.interval; });
+}
+
+// Text im Prometheus Exposition Format (text/plain; version=0.0.4)
+static std::string renderExporterMetrics(const ExporterStatus & status)
+{
+    std::string out;
+    char line[256];
+    for (size_t i = 0; i < g_exporterMetrics.size(); i++) {
+        const ExporterMetric & metric = g_exporterMetrics[i];
+        if (metric.value.empty()) continue;
+        out += "# HELP " + metric.name + " " + metric.help + "\n";
+        out += "# TYPE " + metric.name + " gauge\n";
+        out += metric.name + "{" + metric.labels + "} " + metric.value + "\n";
+    }
+    snprintf(line, sizeof(line),
+             "# HELP e3dc_up 1 wenn die letzte Abfrage des S10 erfolgreich war\n"
+             "# TYPE e3dc_up gauge\n"
+             "e3dc_up %d\n", status.up ? 1 : 0);
+    out += line;
+    snprintf(line, sizeof(line),
+             "# HELP e3dc_poll_duration_seconds Dauer der letzten Abfrage\n"
+             "# TYPE e3dc_poll_duration_seconds gauge\n"
+             "e3dc_poll_duration_seconds %.6f\n", status.pollDuration);
+    out += line;
+    snprintf(line, sizeof(line),
+             "# HELP e3dc_last_success_timestamp_seconds Zeitpunkt der letzten erfolgreichen Abfrage\n"
+             "# TYPE e3dc_last_success_timestamp_seconds gauge\n"
+             "e3dc_last_success_timestamp_seconds %.3f\n", status.lastSuccess);
+    out += line;
+    snprintf(line, sizeof(line),
+             "# HELP e3dc_polls_total Anzahl Abfragen des S10\n"
+             "# TYPE e3dc_polls_total counter\n"
+             "e3dc_polls_total %lu\n"
+             "# HELP e3dc_poll_errors_total Anzahl fehlgeschlagener Abfragen\n"
+             "# TYPE e3dc_poll_errors_total counter\n"
+             "e3dc_poll_errors_total %lu\n", status.polls, status.pollErrors);
+    out += line;
+
+    // Zeitstatistik des Schedulers je Intervall-Gruppe
+    static const struct {
+        const char* name;
+        const char* type;
+        const char* help;
+    } schedulerMetrics[] = {
+        {"e3dc_scheduler_tags", "gauge", "Anzahl Tags der Intervall-Gruppe"},
+        {"e3dc_scheduler_ticks_total", "counter", "Abgefragte Takte der Intervall-Gruppe"},
+        {"e3dc_scheduler_skipped_ticks_total", "counter", "Ausgelassene Takte, weil die vorherige Abfrage noch lief"},
+        {"e3dc_scheduler_lag_seconds", "gauge", "Verspaetung des letzten Takts gegenueber dem Zeitraster"},
+        {"e3dc_scheduler_request_duration_seconds", "gauge", "Dauer des letzten Frames mit dieser Gruppe"},
+        {"e3dc_scheduler_request_duration_max_seconds", "gauge", "Laengste Dauer eines Frames mit dieser Gruppe"},
+    };
+    for (size_t m = 0; m < sizeof(schedulerMetrics) / sizeof(schedulerMetrics[0]); m++) {
+        out += std::string("# HELP ") + schedulerMetrics[m].name + " " + schedulerMetrics[m].help + "\n";
+        out += std::string("# TYPE ") + schedulerMetrics[m].name + " " + schedulerMetrics[m].type + "\n";
+        for (size_t g = 0; g < g_pollGroups.size(); g++) {
+            const PollGroup & group = g_pollGroups[g];
+            switch (m) {
+                case 0: snprintf(line, sizeof(line), "%zu", group.tags.size()); break;
+                case 1: snprintf(line, sizeof(line), "%lu", group.ticks); break;
+                case 2: snprintf(line, sizeof(line), "%lu", group.skipped); break;
+                case 3: snprintf(line, sizeof(line), "%.6f", group.lastLag); break;
+                case 4: snprintf(line, sizeof(line), "%.6f", group.lastDuration); break;
+                default: snprintf(line, sizeof(line), "%.6f", group.maxDuration); break;
+            }
+            char labels[64];
+            snprintf(labels, sizeof(labels), "{interval=\"%d\"} ", group.interval);
+            out += std::string(schedulerMetrics[m].name) + labels + line + "\n";
+        }
+    }
+    return out;
+}
+
+// Poller-Thread: besitzt die RSCP-Sitzung. Alle im aktuellen Takt fälligen Gruppen werden in einem Frame
+// abgefragt (createRequestExample mit den fälligen Tags), danach wird der Snapshot ersetzt.
+// Takte, die während einer laufenden Abfrage fällig geworden wären, werden ausgelassen und gezählt.
+static void exporterPollLoop(void)
+{
+    typedef std::chrono::steady_clock Clock;
+    ExporterStatus status;
+    memset(&status, 0, sizeof(status));
+
+    Clock::time_point start = Clock::now();
+    for (size_t g = 0; g < g_pollGroups.size(); g++) {
+        g_pollGroups[g].next = start;
+    }
+
+    while (!bDaemonStop) {
+        Clock::time_point tickStart = Clock::now();
+
+        // fällige Gruppen einsammeln, ihre Werte werden in diesem Takt neu gesetzt
+        std::vector<size_t> dueGroups;
+        g_ctx.leseTags.clear();
+        for (size_t g = 0; g < g_pollGroups.size(); g++) {
+            PollGroup & group = g_pollGroups[g];
+            if (group.next > tickStart) continue;
+            dueGroups.push_back(g);
+            group.lastLag = std::chrono::duration<double>(tickStart - group.next).count();
+            g_ctx.leseTags.insert(g_ctx.leseTags.end(), group.tags.begin(), group.tags.end());
+        }
+        for (size_t i = 0; i < g_exporterMetrics.size(); i++) {
+            ExporterMetric & metric = g_exporterMetrics[i];
+            if (std::find(g_ctx.leseTags.begin(), g_ctx.leseTags.end(), metric.tag) != g_ctx.leseTags.end()) {
+                metric.value.clear();
+            }
+        }
+
+        if (!dueGroups.empty()) {
+            g_ctx.leseTag = g_ctx.leseTags[0];
+
+            // Verbindung bei Bedarf neu aufbauen, mainLoop() authentifiziert sich dann zuerst
+            if (iSocket >= 0 || connectToServer()) {
+                mainLoop();
+            }
+            status.up = (iSocket >= 0 && iAuthenticated && !bConnectionLost);
+            if (iSocket >= 0 && !status.up) {
+                DEBUG("RSCP-Verbindung verloren, Neuaufbau bei der nächsten Abfrage\n");
+                SocketClose(iSocket);
+                iSocket = -1;
+            }
+
+            Clock::time_point tickEnd = Clock::now();
+            status.polls++;
+            if (status.up) {
+                struct timespec now;
+                clock_gettime(CLOCK_REALTIME, &now);
+                status.lastSuccess = now.tv_sec + now.tv_nsec / 1e9;
+                if (g_ctx.storePath) {
+                    // Werte dieses Takts mit dem Empfangszeitpunkt speichern
+                    int64_t timeMs = (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+                    for (size_t i = 0; i < g_exporterMetrics.size(); i++) {
+                        const ExporterMetric & metric = g_exporterMetrics[i];
+                        if (metric.value.empty() ||
+                            std::find(g_ctx.leseTags.begin(), g_ctx.leseTags.end(), metric.tag) == g_ctx.leseTags.end()) {
+                            continue;
+                        }
+                        if (!g_store.append(metric.tag, timeMs, metric.number)) {
+                            DEBUG("Wert von 0x%08X konnte nicht gespeichert werden\n", metric.tag);
+                        }
+                    }
+                }
+            } else {
+                status.pollErrors++;
+            }
+            status.pollDuration = std::chrono::duration<double>(tickEnd - tickStart).count();
+
+            for (size_t d = 0; d < dueGroups.size(); d++) {
+                PollGroup & group = g_pollGroups[dueGroups[d]];
+                const std::chrono::seconds interval(group.interval);
+                group.ticks++;
+                group.lastDuration = status.pollDuration;
+                group.maxDuration = std::max(group.maxDuration, status.pollDuration);
+                // nächster Takt auf dem Raster nach dem Ende der Abfrage, dazwischen liegende Takte entfallen
+                group.next += interval;
+                while (group.next <= tickEnd) {
+                    group.next += interval;
+                    group.skipped++;
+                }
+            }
+            DEBUG("Takt: %zu Gruppe(n), %zu Tags, %.1f ms\n", dueGroups.size(), g_ctx.leseTags.size(),
+                  status.pollDuration * 1000.0);
+        }
+
+        std::string snapshot = renderExporterMetrics(status);
+        std::unique_lock<std::mutex> lock(g_exporterMutex);
+        g_exporterSnapshot.swap(snapshot);
+
+        Clock::time_point next = Clock::time_point::max();
+        for (size_t g = 0; g < g_pollGroups.size(); g++) {
+            next = std::min(next, g_pollGroups[g].next);
+        }
+        g_exporterWakeup.wait_until(lock, next, [] { return bDaemonStop != 0; });
+    }
+    SocketClose(iSocket);
+}
+
+// Öffnet den TCP-Listener, spec: "port" oder "adresse:port" (IPv4)
+static int openTcpListener(const char* spec)
+{
+    char host[64] = "0.0.0.0";
+    const char* portStr = spec;
+    const char* colon = strrchr(spec, ':');
+    if (colon) {
+        size_t length = colon - spec;
+        if (length >= sizeof(host)) length = sizeof(host) - 1;
+        memcpy(host, spec, length);
+        host[length] = '\0';
+        portStr = colon + 1;
+    }
+    int port = atoi(portStr);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if (port <= 0 || port > 65535 || inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+        fprintf(stderr, "Ungültige Listen-Adresse '%s' (Format: port oder adresse:port)\n", spec);
+        return -1;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        fprintf(stderr, "TCP-Socket kann nicht erstellt werden. errno %i\n", errno);
+        return -1;
+    }
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+        fprintf(stderr, "TCP-Port '%s' kann nicht geöffnet werden. errno %i\n", spec, errno);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void sendHttpResponse(int fd, const char* status, const char* contentType, const std::string & body, bool sendBody)
+{
+    char header[256];
+    int length = snprintf(header, sizeof(header),
+                          "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+                          status, contentType, body.size());
+    std::string response(header, length);
+    if (sendBody) {
+        response += body;
+    }
+    size_t sent = 0;
+    while (sent < response.size()) {
+        ssize_t n = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) break;
+        sent += n;
+    }
+}
+
+// Beantwortet eine HTTP-Anfrage: GET/HEAD /metrics aus dem Snapshot, sonst 404/405
+static void handleHttpClient(int fd)
+{
+    // langsame oder hängende Clients dürfen den Listener nicht blockieren
+    struct timeval tv;
+    tv.tv_sec = 2;
+    tv.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    char request[4096];
+    size_t received = 0;
+    while (received < sizeof(request) - 1) {
+        ssize_t n = recv(fd, request + received, sizeof(request) - 1 - received, 0);
+        if (n <= 0) break;
+        received += n;
+        request[received] = '\0';
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n")) break;
+    }
+    request[received] = '\0';
+
+    char method[8], path[256];
+    if (sscanf(request, "%7s %255s", method, path) != 2) {
+        sendHttpResponse(fd, "400 Bad Request", "text/plain; charset=utf-8", "Ungültige Anfrage\n", true);
+        return;
+    }
+    bool head = (strcmp(method, "HEAD") == 0);
+    if (!head && strcmp(method, "GET") != 0) {
+        sendHttpResponse(fd, "405 Method Not Allowed", "text/plain; charset=utf-8", "Nur GET und HEAD\n", true);
+        return;
+    }
+    char* query = strchr(path, '?');
+    if (query) *query = '\0';
+
+    if (strcmp(path, "/metrics") == 0) {
+        std::string body;
+        {
+            std::lock_guard<std::mutex> lock(g_exporterMutex);
+            body = g_exporterSnapshot;
+        }
+        sendHttpResponse(fd, "200 OK", "text/plain; version=0.0.4; charset=utf-8", body, !head);
+    } else if (strcmp(path, "/") == 0) {
+        sendHttpResponse(fd, "200 OK", "text/plain; charset=utf-8", "e3dcset Exporter - Metriken unter /metrics\n", !head);
+    } else {
+        sendHttpResponse(fd, "404 Not Found", "text/plain; charset=utf-8", "Nicht gefunden\n", !head);
+    }
+}
+
+static int runExporter(void)
+{
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = daemonSignalHandler;  // kein SA_RESTART, damit accept() unterbrochen wird
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    int listenSocket = openTcpListener(g_ctx.exporterListen);
+    if (listenSocket < 0) {
+        return EXIT_FAILURE;
+    }
+
+    if (g_ctx.storePath && !g_store.open(g_ctx.storePath)) {
+        fprintf(stderr, "Zeitreihen-Speicher %s konnte nicht geöffnet werden. errno %i\n", g_ctx.storePath, errno);
+        close(listenSocket);
+        return EXIT_FAILURE;
+    }
+
+    setupExporterMetrics();
+    setupPollGroups();
+    ExporterStatus initial;
+    memset(&initial, 0, sizeof(initial));
+    g_exporterSnapshot = renderExporterMetrics(initial);
+
+    // Signale nur im Haupt-Thread, damit accept() beim Beenden unterbrochen wird
+    sigset_t signals, oldSignals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, &oldSignals);
+    // der Poller-Thread hält die RSCP-Sitzung
+    std::thread poller([ctx = g_ctx, config = e3dc_config] {
+        startSession(ctx, config);
+        exporterPollLoop();
+    });
+    pthread_sigmask(SIG_SETMASK, &oldSignals, NULL);
+
+    for (size_t g = 0; g < g_pollGroups.size(); g++) {
+        DEBUG("Intervall %i s: %zu Tags\n", g_pollGroups[g].interval, g_pollGroups[g].tags.size());
+    }
+    DEBUG("Exporter wartet auf Scrapes an %s\n", g_ctx.exporterListen);
+
+    while (!bDaemonStop) {
+        int clientSocket = accept(listenSocket, NULL, NULL);
+        if (clientSocket < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "accept() fehlgeschlagen. errno %i\n", errno);
+            break;
+        }
+        handleHttpClient(clientSocket);
+        close(clientSocket);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_exporterMutex);
+        bDaemonStop = 1;
     }
+    g_exporterWakeup.notify_all();
+    poller.join();
 
+    g_store.close();
+    close(listenSocket);
+    DEBUG("Exporter beendet\n");
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+// Halte-Modus: Lade-/Entladegrenzen (-c/-d) dauerhaft in Kraft halten (--hold)
+//--------------------------------------------------------------------------------------------------------------
+// Das S10 hält per RSCP gesetzte Leistungsgrenzen nur, solange sie erneuert werden, danach regelt es wieder
+// automatisch. --hold hält die authentifizierte Sitzung offen und sendet TAG_EMS_REQ_SET_POWER_SETTINGS in festen
+// Abständen erneut. Die Sollzeitpunkte liegen auf der monotonen Uhr (Start + n * Intervall), eine verspätete
+// Auffrischung verschiebt die folgenden nicht. Jede Antwort wird geprüft, Ablehnungen, Anpassungen, verspätete und
+// fehlgeschlagene Auffrischungen werden sofort auf stderr gemeldet.
+
+static void resetPowerSettingsResult(void)
+{
+    g_powerResult.received = false;
+    g_powerResult.error = false;
+    g_powerResult.limitsUsed = POWER_RESULT_NONE;
+    g_powerResult.maxCharge = POWER_RESULT_NONE;
+    g_powerResult.maxDischarge = POWER_RESULT_NONE;
+}
+
+// Ergebniscode einer Einstellung: angepasste Werte werden gemeldet und gelten als gesetzt, false bei Ablehnung
+static bool checkPowerResult(const char* prefix, const char* setting, int result)
+{
+    if (result == POWER_RESULT_NONE || result == 0) {
+        return true;
+    }
+    fprintf(stderr, "%s%s vom S10 %s (Ergebnis %d)\n", prefix, setting, result > 0 ? "angepasst" : "abgelehnt", result);
+    return result > 0;
+}
+
+// Prüft die Antwort TAG_EMS_SET_POWER_SETTINGS auf die zuletzt gesendeten Einstellungen, false wenn sie fehlt,
+// einen Fehler enthält oder das S10 eine Einstellung abgelehnt hat
+static bool checkPowerSettingsResult(const char* prefix)
+{
+    if (!g_powerResult.received) {
+        fprintf(stderr, "%sKeine Antwort auf die Leistungseinstellungen vom S10\n", prefix);
+        return false;
+    }
+    if (g_powerResult.error) {
+        fprintf(stderr, "%sLeistungseinstellungen vom S10 abgelehnt\n", prefix);
+        return false;
+    }
+    char setting[48];
+    bool ok = checkPowerResult(prefix, "Leistungsbegrenzung", g_powerResult.limitsUsed);
+    if (g_ctx.ladeLeistungGesetzt) {
+        snprintf(setting, sizeof(setting), "LadeLeistung %u W", g_ctx.ladeLeistung);
+        ok = checkPowerResult(prefix, setting, g_powerResult.maxCharge) && ok;
+    }
+    if (g_ctx.entladeLeistungGesetzt) {
+        snprintf(setting, sizeof(setting), "EntladeLeistung %u W", g_ctx.entladeLeistung);
+        ok = checkPowerResult(prefix, setting, g_powerResult.maxDischarge) && ok;
+    }
+    return ok;
+}
+
+static int runHold(void)
+{
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = daemonSignalHandler;  // kein SA_RESTART, das Warten auf die nächste Auffrischung endet sofort
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    if (!connectToServer()) {
+        return EXIT_FAILURE;
+    }
+    printf("Halte Leistungseinstellungen, Auffrischung alle %i s\n", g_ctx.holdInterval);
+
+    const int64_t intervalMs = (int64_t)g_ctx.holdInterval * 1000;
+    int64_t due = SocketNowMs();    // Sollzeitpunkt der nächsten Auffrischung
+    bool bHeld = false;             // Sitzung war authentifiziert, Abbrüche werden danach neu aufgebaut
+    unsigned iReconnects = 0;
+    unsigned failures = 0;
+    char prefix[40];
+
+    while (!bDaemonStop) {
+        snprintf(prefix, sizeof(prefix), "Auffrischung %u: ", g_ctx.holdRefreshes + 1);
+        int64_t late = SocketNowMs() - due;
+        if (late > HOLD_LATE_MS) {
+            fprintf(stderr, "%s%lld ms nach dem Sollzeitpunkt gesendet\n", prefix, (long long)late);
+        }
+        if (late >= intervalMs) {
+            // ganze Intervalle verpasst (Last, Neuaufbau der Verbindung): ab jetzt neu takten statt nachzuholen
+            due = SocketNowMs();
+        }
+
+        resetPowerSettingsResult();
+        mainLoop();
+
+        if (iAuthenticated != 0) {
+            bHeld = true;
+        }
+        if (!bHeld) {
+            // die erste Anmeldung ist gescheitert, wie ohne --hold kein neuer Versuch
+            return EXIT_FAILURE;
+        }
+        if (bConnectionLost || iAuthenticated == 0) {
+            failures++;
+            fprintf(stderr, "%sVerbindung unterbrochen, Leistungsgrenzen nicht bestätigt\n", prefix);
+            bool bReconnected = false;
+            while (!bReconnected && iReconnects < e3dc_config.reconnect_attempts && !bDaemonStop) {
+                bReconnected = reconnectToServer(iReconnects++);
+            }
+            if (!bReconnected) {
+                if (!bDaemonStop) {
+                    fprintf(stderr, "S10 nicht erreichbar, die Leistungsgrenzen werden nicht mehr erneuert\n");
+                }
+                break;
+            }
+            // die neue Sitzung erneuert die Grenzen sofort
+            due = SocketNowMs();
+            continue;
+        }
+        iReconnects = 0;
+        if (!checkPowerSettingsResult(prefix)) {
+            failures++;
+        }
+        DEBUG("%sgesendet %lld ms nach dem Sollzeitpunkt\n", prefix, (long long)late);
+        g_ctx.holdRefreshes++;
+
+        due += intervalMs;
+        waitMilliseconds(due - SocketNowMs());
+    }
+
+    SocketClose(iSocket);
+    printf("Halte-Modus beendet: %u Auffrischungen, %u Fehler\n", g_ctx.holdRefreshes, failures);
+    return failures > 0 ? EXIT_FAILURE : 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+// Fleet-Modus: dieselbe Abfrage an mehrere S10, je Gerät eine eigene Konfigurationsdatei
+//--------------------------------------------------------------------------------------------------------------
+// Die Geräteliste (--fleet) enthält je Zeile eine Konfigurationsdatei, optional mit Namen ("name=pfad"), sonst ist der
+// Dateiname ohne Verzeichnis und ".config" der Name. Leerzeilen und Zeilen mit # werden übersprungen.
+// --workers Threads arbeiten die Liste ab, jeder Thread hält seine eigene RSCP-Sitzung. Jede Ausgabezeile trägt den
+// Gerätenamen ("[name] ..." bzw. das Feld device bei --format).
+
+#define FLEET_DEFAULT_WORKERS 4
+#define FLEET_MAX_WORKERS     64
+
+struct FleetDevice {
+    std::string name;
+    std::string configPath;
+    e3dc_config_t config;
+    bool ok;
+};
+
+static char* trimWhitespace(char* text)
+{
+    while (isspace((unsigned char)*text)) text++;
+    char* end = text + strlen(text);
+    while (end > text && isspace((unsigned char)end[-1])) *--end = '\0';
+    return text;
+}
+
+static bool readFleetList(const char* path, std::vector<FleetDevice> & devices)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "Geräteliste %s wurde nicht gefunden.\n\n", path);
+        return false;
+    }
+    char line[512];
+    while (fgets(line, sizeof(line), fp)) {
+        char* entry = trimWhitespace(line);
+        if (*entry == '\0' || *entry == '#') continue;
+
+        FleetDevice device;
+        device.ok = false;
+        char* equals = strchr(entry, '=');
+        if (equals) {
+            *equals = '\0';
+            device.name = trimWhitespace(entry);
+            device.configPath = trimWhitespace(equals + 1);
+        } else {
+            device.configPath = entry;
+            const char* base = strrchr(entry, '/');
+            device.name = base ? base + 1 : entry;
+            size_t suffix = device.name.rfind(".config");
+            if (suffix != std::string::npos && suffix > 0 && suffix + 7 == device.name.size()) {
+                device.name.resize(suffix);
+            }
+        }
+        devices.push_back(device);
+    }
+    fclose(fp);
+    if (devices.empty()) {
+        fprintf(stderr, "Geräteliste %s enthält keine Geräte\n\n", path);
+        return false;
+    }
+    return true;
+}
+
+// Eine Abfrage an das S10 der aktuellen Sitzung, wie main() für ein einzelnes Gerät
+static bool pollFleetDevice(void)
+{
+    if (g_ctx.historieAbfrage) {
+        openHistoryCache();
+        if (answerHistoryFromCache()) {
+            return true;
+        }
+    }
+    if (!connectToServer()) {
+        return false;
+    }
+    bRequestFailed = false;
+    resetPowerSettingsResult();
+    mainLoop();
+    bool ok = sessionExitStatus() == EXIT_SUCCESS;
+    SocketClose(iSocket);
+    iSocket = -1;
+    return ok;
+}
+
+static void fleetWorker(const CommandContext & ctx, std::vector<FleetDevice> & devices, std::atomic<size_t> & next,
+                        OutputWriter & output)
+{
+    for (size_t i = next++; i < devices.size(); i = next++) {
+        FleetDevice & device = devices[i];
+        // jedes Gerät beginnt mit dem Kommando der Kommandozeile (DCB- und History-Fortschritt je Gerät)
+        startSession(ctx, device.config);
+        g_historyCache.close();
+        g_output.beginDevice(&output, device.name.c_str());
+        device.ok = pollFleetDevice();
+        g_output.end();
+        if (!device.ok) {
+            fprintf(stderr, "[%s] Abfrage von %s:%u fehlgeschlagen\n", device.name.c_str(), device.config.server_ip,
+                    device.config.server_port);
+        }
+    }
+}
+
+static int runFleet(std::vector<FleetDevice> & devices, int workers)
+{
+    g_output.setFormat(g_ctx.ausgabeFormat);
+    g_output.begin(stdout, true);
+
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> threads;
+    size_t count = std::min((size_t)workers, devices.size());
+    for (size_t i = 0; i < count; i++) {
+        threads.emplace_back(fleetWorker, std::cref(g_ctx), std::ref(devices), std::ref(next), std::ref(g_output));
+    }
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    g_output.end();
+
+    size_t failed = 0;
+    for (size_t i = 0; i < devices.size(); i++) {
+        if (!devices[i].ok) failed++;
+    }
+    DEBUG("Fleet: %zu Geräte mit %zu Threads, %zu fehlgeschlagen\n", devices.size(), count, failed);
+    return failed > 0 ? EXIT_FAILURE : 0;
+}
+
+// Dauer mit optionaler Einheit: "10", "30s", "5m", "1h", "1d", "2w" -> Sekunden, <= 0 bei Fehlern
+static int64_t parseDuration(const char* text)
+{
+    char* end = NULL;
+    long long value = strtoll(text, &end, 10);
+    if (end == text || value <= 0) return -1;
+    long long factor = 1;
+    if (*end == 'm') factor = 60;
+    else if (*end == 'h') factor = 3600;
+    else if (*end == 'd') factor = 86400;
+    else if (*end == 'w') factor = 7 * 86400;
+    else if (*end != 's' && *end != '\0') return -1;
+    if (*end != '\0' && end[1] != '\0') return -1;
+    if (value > 100LL * 365 * 86400 / factor) return -1;
+    return value * factor;
+}
+
+// Abfrageintervall des Exporters: Dauer bis höchstens 7 Tage -> Sekunden, <= 0 bei Fehlern
+static int parseInterval(const char* text)
+{
+    int64_t seconds = parseDuration(text);
+    if (seconds <= 0 || seconds > 7 * 86400) return -1;
+    return (int)seconds;
+}
+
+// Zeitpunkt für query: "now", relativ "-1h" / "-7d", Unix-Zeit in Sekunden oder
+// "YYYY-MM-DD", "YYYY-MM-DD HH:MM[:SS]" bzw. mit T (Ortszeit) -> ms seit 1970, false bei Fehlern
+static bool parseQueryTime(const char* text, int64_t nowMs, int64_t* result)
+{
+    if (strcmp(text, "now") == 0) {
+        *result = nowMs;
+        return true;
+    }
+    if (text[0] == '-') {
+        int64_t seconds = parseDuration(text + 1);
+        if (seconds <= 0) return false;
+        *result = nowMs - seconds * 1000;
+        return true;
+    }
+    if (strspn(text, "0123456789") == strlen(text) && strlen(text) > 0 && strlen(text) <= 12) {
+        *result = strtoll(text, NULL, 10) * 1000;
+        return true;
+    }
+    static const char* formats[] = { "%Y-%m-%d %H:%M:%S", "%Y-%m-%dT%H:%M:%S", "%Y-%m-%d %H:%M", "%Y-%m-%dT%H:%M", "%Y-%m-%d" };
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        struct tm tm;
+        memset(&tm, 0, sizeof(tm));
+        const char* end = strptime(text, formats[i], &tm);
+        if (end && *end == '\0') {
+            tm.tm_isdst = -1;
+            time_t t = mktime(&tm);
+            if (t == (time_t)-1) return false;
+            *result = (int64_t)t * 1000;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void queryUsage(void)
+{
+    fprintf(stderr, "\n   Usage: e3dcset query --store <verzeichnis> -r TAG1,TAG2,... [--from zeit] [--to zeit] [--step intervall] [--agg funktion] [-q] [-t Pfad zur Tags-Datei]\n\n");
+    fprintf(stderr, "   Gibt die vom Exporter mit --store gespeicherten Werte aus (keine Verbindung zum S10).\n\n");
+    fprintf(stderr, "   Optionen:\n");
+    fprintf(stderr, "     --store <dir>   Verzeichnis des Zeitreihen-Speichers\n");
+    fprintf(stderr, "     -r              Tags (Tag-Name oder Hex-Wert, mehrere durch Komma getrennt)\n");
+    fprintf(stderr, "     --from <zeit>   Beginn (Standard: -1d)\n");
+    fprintf(stderr, "     --to <zeit>     Ende, ausschliesslich (Standard: now)\n");
+    fprintf(stderr, "                     Zeit: now, -30m, -1d, -4w, YYYY-MM-DD, \"YYYY-MM-DD HH:MM[:SS]\" oder Unix-Zeit\n");
+    fprintf(stderr, "     --step <i>      Werte zu Intervallen zusammenfassen (z.B. 1m, 15m, 1h, 1d)\n");
+    fprintf(stderr, "     --agg <f>       Funktion fuer --step: avg, min, max, first, last, sum, count (Standard: avg)\n");
+    fprintf(stderr, "     -q              Nur Unix-Zeit und Wert ausgeben (für Scripting)\n\n");
+    fprintf(stderr, "   Beispiele:\n");
+    fprintf(stderr, "     e3dcset query --store /var/lib/e3dc -r EMS_POWER_PV --from -1h\n");
+    fprintf(stderr, "     e3dcset query --store /var/lib/e3dc -r EMS_POWER_PV,EMS_POWER_HOME --from 2026-05-01 --to 2026-06-01 --step 1d --agg max\n\n");
+    exit(EXIT_FAILURE);
+}
+
+// Unterbefehl "query": Zeitbereich aus dem Zeitreihen-Speicher ausgeben, optional zusammengefasst
+static int runQuery(int argc, char *argv[])
+{
+    enum { OPT_STORE = 256, OPT_FROM, OPT_TO, OPT_STEP, OPT_AGG };
+    static const struct option queryOptions[] = {
+        {"store", required_argument, NULL, OPT_STORE},
+        {"from", required_argument, NULL, OPT_FROM},
+        {"to", required_argument, NULL, OPT_TO},
+        {"step", required_argument, NULL, OPT_STEP},
+        {"agg", required_argument, NULL, OPT_AGG},
+        {NULL, 0, NULL, 0}
+    };
+    static const struct {
+        const char* name;
+        TsAggregation aggregation;
+    } aggregations[] = {
+        {"avg", TS_AGG_AVG}, {"min", TS_AGG_MIN}, {"max", TS_AGG_MAX}, {"first", TS_AGG_FIRST},
+        {"last", TS_AGG_LAST}, {"sum", TS_AGG_SUM}, {"count", TS_AGG_COUNT},
+    };
+
+    const char* fromText = "-1d";
+    const char* toText = "now";
+    int64_t step = 0;
+    TsAggregation aggregation = TS_AGG_AVG;
+    bool aggregationSet = false;
+    std::vector<std::string> names;
+
+    int opt;
+    optind = 1;
+    while ((opt = getopt_long(argc, argv, "r:t:q", queryOptions, NULL)) != -1) {
+        switch (opt) {
+        case OPT_STORE:
+                g_ctx.storePath = strdup(optarg);
+                break;
+        case OPT_FROM:
+                fromText = optarg;
+                break;
+        case OPT_TO:
+                toText = optarg;
+                break;
+        case OPT_STEP:
+                step = parseDuration(optarg) * 1000;
+                if (step <= 0) {
+                    fprintf(stderr, "Fehler: Ungültiges Intervall '%s' (z.B. 30s, 15m, 1h, 1d)\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+        case OPT_AGG: {
+                size_t i = 0;
+                while (i < sizeof(aggregations) / sizeof(aggregations[0]) && strcmp(aggregations[i].name, optarg) != 0) i++;
+                if (i == sizeof(aggregations) / sizeof(aggregations[0])) {
+                    fprintf(stderr, "Fehler: Unbekannte Funktion '%s' (avg, min, max, first, last, sum, count)\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                aggregation = aggregations[i].aggregation;
+                aggregationSet = true;
+                break;
+        }
+        case 'r': {
+                char *savePtr = NULL;
+                for (char *tok = strtok_r(optarg, ",", &savePtr); tok; tok = strtok_r(NULL, ",", &savePtr)) {
+                    names.push_back(tok);
+                }
+                break;
+        }
+        case 't':
+                g_ctx.tagfilePath = strdup(optarg);
+                break;
+        case 'q':
+                g_ctx.quietMode = true;
+                break;
+        default:
+                queryUsage();
+        }
+    }
+    if (optind < argc || !g_ctx.storePath || names.empty()) {
+        queryUsage();
+    }
+    if (aggregationSet && step == 0) {
+        fprintf(stderr, "[--agg] kann nur zusammen mit [--step] verwendet werden\n\n");
+        exit(EXIT_FAILURE);
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    int64_t nowMs = (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+    int64_t from, to;
+    if (!parseQueryTime(fromText, nowMs, &from) || !parseQueryTime(toText, nowMs, &to)) {
+        fprintf(stderr, "Fehler: Ungültige Zeitangabe '%s' (z.B. now, -1h, 2026-05-01, \"2026-05-01 12:00\")\n",
+                parseQueryTime(fromText, nowMs, &from) ? toText : fromText);
+        exit(EXIT_FAILURE);
+    }
+    if (from >= to) {
+        fprintf(stderr, "Fehler: [--from] muss vor [--to] liegen\n\n");
+        exit(EXIT_FAILURE);
+    }
+
+    loadTags(g_ctx.tagfilePath);
+    std::vector<uint32_t> tags;
+    for (size_t i = 0; i < names.size(); i++) {
+        const char* name = names[i].c_str();
+        uint32_t tag = (name[0] >= '0' && name[0] <= '9') ? strtoul(name, NULL, 0) : getTagByName(name);
+        if (tag == 0 || !isRequestTag(tag)) {
+            fprintf(stderr, "Fehler: '%s' ist kein gueltiger REQUEST Tag\n", name);
+            exit(EXIT_FAILURE);
+        }
+        tags.push_back(tag);
+    }
+
+    struct stat st;
+    if (stat(g_ctx.storePath, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        fprintf(stderr, "Zeitreihen-Speicher %s wurde nicht gefunden.\n", g_ctx.storePath);
+        return EXIT_FAILURE;
+    }
+    TimeSeriesStore store;
+    if (!store.open(g_ctx.storePath)) {
+        fprintf(stderr, "Zeitreihen-Speicher %s konnte nicht geöffnet werden. errno %i\n", g_ctx.storePath, errno);
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < tags.size(); i++) {
+        if (i > 0) printf("\n");
+        if (!g_ctx.quietMode) {
+            const char* name = getTagName(tags[i]);
+            printf("%s (0x%08X)\n", name ? name : "unbekannt", tags[i]);
+        }
+        unsigned long count = 0;
+        store.queryDownsampled(tags[i], from, to - 1, step, aggregation, [&](int64_t time, double value) {
+            count++;
+            if (g_ctx.quietMode) {
+                printf("%lld.%03d\t%.10g\n", (long long)(time / 1000), (int)(time % 1000), value);
+                return;
+            }
+            char date[32];
+            time_t seconds = (time_t)(time / 1000);
+            struct tm local;
+            localtime_r(&seconds, &local);
+            strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &local);
+            if (step > 0) {
+                printf("  %s  %.10g\n", date, value);
+            } else {
+                printf("  %s.%03d  %.10g\n", date, (int)(time % 1000), value);
+            }
+        });
+        if (!g_ctx.quietMode && count == 0) {
+            printf("  keine Werte im Zeitraum\n");
+        }
+    }
+    return 0;
+}
+
+// Leitet die geprüfte Abfrage an einen laufenden Daemon weiter und gibt dessen Antwort aus
+static int forwardToDaemon(void)
+{
+    int fd = openUnixSocket(g_ctx.socketPath, false);
+    if (fd < 0) {
+        return EXIT_FAILURE;
+    }
+    std::string request = serializeContext(g_ctx);
+    if (SocketSendData(fd, (const unsigned char *) request.data(), request.size()) < 0) {
+        fprintf(stderr, "Anfrage an den Daemon konnte nicht gesendet werden\n");
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    shutdown(fd, SHUT_WR);
+
+    // Ausgabe bis zum Nullbyte weitergeben, danach folgt der Exit-Code der Abfrage
+    char buffer[4096];
+    std::string trailer;
+    bool inTrailer = false;
+    ssize_t n;
+    while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+        if (inTrailer) {
+            trailer.append(buffer, n);
+            continue;
+        }
+        const char* marker = (const char*)memchr(buffer, DAEMON_STATUS_MARKER, n);
+        if (marker) {
+            fwrite(buffer, 1, marker - buffer, stdout);
+            trailer.append(marker + 1, buffer + n - marker - 1);
+            inTrailer = true;
+        } else {
+            fwrite(buffer, 1, n, stdout);
+        }
+    }
+    close(fd);
+    fflush(stdout);
+
+    int status;
+    if (!inTrailer || sscanf(trailer.c_str(), "status=%d", &status) != 1) {
+        fprintf(stderr, "Daemon hat die Verbindung ohne Ergebnis geschlossen\n");
+        return EXIT_FAILURE;
+    }
+    return status;
 }
 
 int main(int argc, char *argv[])
@@ -2156,13 +4798,127 @@ int main(int argc, char *argv[])
     if (argc == 1){
         usage();
         }
+
+    // Unterbefehl: gespeicherte Zeitreihen abfragen (keine Verbindung zum S10)
+    if (strcmp(argv[1], "query") == 0) {
+        return runQuery(argc - 1, argv + 1);
+    }
     
     int opt;
 
-    while ((opt = getopt(argc, argv, "c:d:e:E:ap:r:i:m:qlt:H:D:I:S:")) != -1) {
+    // Lange Optionen für den Daemon-Modus
+    enum { OPT_DAEMON = 256, OPT_SOCKET, OPT_COMPILE_TAGS, OPT_EXPORTER, OPT_INTERVAL, OPT_STORE, OPT_FROM, OPT_TO, OPT_SERIES,
+           OPT_CACHE, OPT_NO_CACHE, OPT_FORMAT, OPT_FLEET, OPT_WORKERS, OPT_HOLD };
+    static const struct option longOptions[] = {
+        {"daemon", required_argument, NULL, OPT_DAEMON},
+        {"socket", required_argument, NULL, OPT_SOCKET},
+        {"compile-tags", optional_argument, NULL, OPT_COMPILE_TAGS},
+        {"exporter", required_argument, NULL, OPT_EXPORTER},
+        {"interval", required_argument, NULL, OPT_INTERVAL},
+        {"store", required_argument, NULL, OPT_STORE},
+        {"from", required_argument, NULL, OPT_FROM},
+        {"to", required_argument, NULL, OPT_TO},
+        {"series", required_argument, NULL, OPT_SERIES},
+        {"cache", required_argument, NULL, OPT_CACHE},
+        {"no-cache", no_argument, NULL, OPT_NO_CACHE},
+        {"format", required_argument, NULL, OPT_FORMAT},
+        {"fleet", required_argument, NULL, OPT_FLEET},
+        {"workers", required_argument, NULL, OPT_WORKERS},
+        {"hold", required_argument, NULL, OPT_HOLD},
+        {NULL, 0, NULL, 0}
+    };
+    bool socketClient = false;
+    const char *cacheDirectory = NULL;   // --cache bzw. --no-cache (""), überschreibt history_cache der Konfiguration
+    bool compileTags = false;
+    const char *compileTagsOutput = NULL;
+    const char *fleetPath = NULL;        // Geräteliste (--fleet)
+    int fleetWorkers = 0;                // --workers, 0 = FLEET_DEFAULT_WORKERS
+
+    while ((opt = getopt_long(argc, argv, "c:d:e:E:ap:r:i:m:qlt:H:D:I:S:", longOptions, NULL)) != -1) {
 
         switch (opt) {
 
+        case OPT_DAEMON:
+                if (socketClient) {
+                    fprintf(stderr, "[--daemon] und [--socket] schliessen sich aus\n\n");
+                    exit(EXIT_FAILURE);
+                }
+                g_ctx.daemonMode = true;
+                g_ctx.socketPath = strdup(optarg);
+                break;
+        case OPT_SOCKET:
+                if (g_ctx.daemonMode) {
+                    fprintf(stderr, "[--daemon] und [--socket] schliessen sich aus\n\n");
+                    exit(EXIT_FAILURE);
+                }
+                socketClient = true;
+                g_ctx.socketPath = strdup(optarg);
+                break;
+        case OPT_COMPILE_TAGS:
+                compileTags = true;
+                compileTagsOutput = optarg;
+                break;
+        case OPT_EXPORTER:
+                g_ctx.exporterMode = true;
+                g_ctx.exporterListen = strdup(optarg);
+                break;
+        case OPT_INTERVAL:
+                g_ctx.pollInterval = parseInterval(optarg);
+                if (g_ctx.pollInterval <= 0) {
+                    fprintf(stderr, "Fehler: Ungültiges Intervall '%s' (z.B. 10, 30s, 5m, 1h, 1d)\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+        case OPT_HOLD:
+                g_ctx.holdInterval = parseInterval(optarg);
+                if (g_ctx.holdInterval <= 0) {
+                    fprintf(stderr, "Fehler: Ungültiges Intervall '%s' (z.B. 5, 30s, 1m)\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+        case OPT_STORE:
+                g_ctx.storePath = strdup(optarg);
+                break;
+        case OPT_FROM:
+                g_ctx.historieVon = strdup(optarg);
+                break;
+        case OPT_TO:
+                g_ctx.historieBis = strdup(optarg);
+                break;
+        case OPT_CACHE:
+                cacheDirectory = optarg;
+                break;
+        case OPT_NO_CACHE:
+                cacheDirectory = "";
+                break;
+        case OPT_SERIES:
+                if (strcmp(optarg, "csv") == 0) {
+                    g_ctx.historieSerie = SERIES_CSV;
+                } else if (strcmp(optarg, "jsonl") == 0) {
+                    g_ctx.historieSerie = SERIES_JSONL;
+                } else {
+                    fprintf(stderr, "Fehler: Unbekanntes Format '%s' fuer [--series] (csv, jsonl)\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+        case OPT_FORMAT:
+                if (!OutputWriter::parseFormat(optarg, &g_ctx.ausgabeFormat)) {
+                    fprintf(stderr, "Fehler: Unbekanntes Format '%s' fuer [--format] (text, json, jsonl, csv)\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+
+        case OPT_FLEET:
+                fleetPath = optarg;
+                break;
+        case OPT_WORKERS:
+                fleetWorkers = atoi(optarg);
+                if (fleetWorkers < 1 || fleetWorkers > FLEET_MAX_WORKERS) {
+                    fprintf(stderr, "Fehler: [--workers] muss zwischen 1 und %d liegen\n", FLEET_MAX_WORKERS);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+
         case 'c':
                 g_ctx.leistungAendern = true;
                 g_ctx.ladeLeistungGesetzt = true;
@@ -2204,23 +4960,16 @@ int main(int argc, char *argv[])
         case 'D':
                 g_ctx.historieDatum = strdup(optarg);
                 break;
-        case 'r':
+        case 'r': {
                 g_ctx.werteAbfragen = true;
-                if (optarg[0] >= '0' && optarg[0] <= '9') {
-                    // Hex-Wert direkt parsen
-                    g_ctx.leseTag = strtoul(optarg, NULL, 0);
-                    // Validierung: Nur REQUEST Tags können abgefragt werden
-                    if (!isRequestTag(g_ctx.leseTag)) {
-                        fprintf(stderr, "Fehler: 0x%08X ist ein RESPONSE Tag!\n", g_ctx.leseTag);
-                        fprintf(stderr, "Sie können nur REQUEST Tags abfragen (zweites Byte < 0x80).\n");
-                        fprintf(stderr, "Beispiel: 0x01000008 (REQUEST), nicht 0x01800008 (RESPONSE)\n");
-                        exit(EXIT_FAILURE);
-                    }
-                } else {
-                    // Tag-Namen speichern für spätere Konvertierung (nach loadTagsFile)
-                    g_ctx.tagName = strdup(optarg);
+                // Mehrere Tags durch Komma getrennt oder mehrfaches -r
+                // Konvertierung zu Hex-Werten erfolgt nach loadTags
+                char *savePtr = NULL;
+                for (char *tok = strtok_r(optarg, ",", &savePtr); tok; tok = strtok_r(NULL, ",", &savePtr)) {
+                    g_ctx.tagNamen.push_back(tok);
                 }
                 break;
+        }
         case 'i':
                 g_ctx.batIndex = (uint16_t)atoi(optarg);
                 break;
@@ -2258,39 +5007,152 @@ int main(int argc, char *argv[])
         usage();
     }
 
-    // Lade Tag-Definitionen aus Datei VOR dem -l Check
-    loadTagsFile(g_ctx.tagfilePath);
+    // Tag-Datenbank kompilieren (kein Verbindungsaufbau)
+    if (compileTags) {
+        std::string output = compileTagsOutput ? std::string(compileTagsOutput) : std::string(g_ctx.tagfilePath) + ".bin";
+        return compileTagDatabase(g_ctx.tagfilePath, output.c_str());
+    }
+
+    // Lade Tag-Definitionen VOR dem -l Check (kompilierte Datenbank oder Textdatei)
+    loadTags(g_ctx.tagfilePath);
 
     // Handle -l option early (no device connection needed)
     if (g_ctx.listTags) {
+        if (g_tagDb.isOpen()) {
+            loadTagsFromDatabase();
+        }
         printTagList(g_ctx.listCategory);
         return 0;
     }
     
-    // Konvertiere Tag-Namen zu Hex-Wert (nach loadTagsFile)
-    if (g_ctx.werteAbfragen && g_ctx.tagName != NULL) {
-        g_ctx.leseTag = getTagByName(g_ctx.tagName);
+    // Konvertiere Tag-Namen zu Hex-Werten (nach loadTags)
+    for (size_t i = 0; i < g_ctx.tagNamen.size(); i++) {
+        // optionales Abfrageintervall für den Exporter: TAG@intervall
+        std::string spec = g_ctx.tagNamen[i];
+        int interval = 0;
+        size_t at = spec.find('@');
+        if (at != std::string::npos) {
+            interval = parseInterval(spec.c_str() + at + 1);
+            if (interval <= 0) {
+                fprintf(stderr, "Fehler: Ungültiges Intervall in '%s' (z.B. EMS_POWER_PV@1s, BAT_REQ_RSOC@5m)\n", spec.c_str());
+                exit(EXIT_FAILURE);
+            }
+            spec.resize(at);
+        }
+        g_ctx.leseIntervalle.push_back(interval);
+        const char *name = spec.c_str();
+        uint32_t tag;
+        if (name[0] >= '0' && name[0] <= '9') {
+            // Hex-Wert direkt parsen
+            tag = strtoul(name, NULL, 0);
+        } else {
+            tag = getTagByName(name);
+        }
         // Validierung: Nur REQUEST Tags können abgefragt werden
-        if (!isRequestTag(g_ctx.leseTag)) {
-            fprintf(stderr, "Fehler: 0x%08X ist ein RESPONSE Tag!\n", g_ctx.leseTag);
+        if (!isRequestTag(tag)) {
+            fprintf(stderr, "Fehler: 0x%08X ist ein RESPONSE Tag!\n", tag);
             fprintf(stderr, "Sie können nur REQUEST Tags abfragen (zweites Byte < 0x80).\n");
             fprintf(stderr, "Beispiel: 0x01000008 (REQUEST), nicht 0x01800008 (RESPONSE)\n");
             exit(EXIT_FAILURE);
         }
-        free(g_ctx.tagName);
-        g_ctx.tagName = NULL;
+        g_ctx.leseTags.push_back(tag);
+    }
+    g_ctx.tagNamen.clear();
+    if (!g_ctx.leseTags.empty()) {
+        g_ctx.leseTag = g_ctx.leseTags[0];
     }
 
-    // Lese Konfigurationsdatei
-    readConfig();
+    if (fleetWorkers > 0 && !fleetPath) {
+        fprintf(stderr, "[--workers] kann nur zusammen mit [--fleet] verwendet werden\n\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Lese Konfigurationsdatei, im Fleet-Modus die Konfiguration jedes Geräts der Liste
+    std::vector<FleetDevice> fleetDevices;
+    if (fleetPath) {
+        if (!readFleetList(fleetPath, fleetDevices)) {
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = 0; i < fleetDevices.size(); i++) {
+            memset(&e3dc_config, 0, sizeof(e3dc_config));
+            g_ctx.configPath = strdup(fleetDevices[i].configPath.c_str());
+            readConfig();
+            if (cacheDirectory) {
+                snprintf(e3dc_config.history_cache, sizeof(e3dc_config.history_cache), "%s", cacheDirectory);
+            }
+            fleetDevices[i].config = e3dc_config;
+        }
+    } else {
+        readConfig();
+        if (cacheDirectory) {
+            snprintf(e3dc_config.history_cache, sizeof(e3dc_config.history_cache), "%s", cacheDirectory);
+        }
+    }
 
     // Argumente der Kommandozeile plausibilisieren
     checkArguments();
 
+    if (fleetPath) {
+        if (socketClient || g_ctx.daemonMode || g_ctx.exporterMode) {
+            fprintf(stderr, "[--fleet] kann nicht mit [--daemon], [--socket] oder [--exporter] verwendet werden\n\n");
+            exit(EXIT_FAILURE);
+        }
+        if (g_ctx.leistungAendern || g_ctx.manuelleSpeicherladung || g_ctx.setEPReserve) {
+            fprintf(stderr, "[--fleet] fragt nur Werte ab (-r, -m, -H), Setzbefehle gelten je Gerät mit [-p]\n\n");
+            exit(EXIT_FAILURE);
+        }
+        if (g_ctx.historieSerie != SERIES_NONE) {
+            fprintf(stderr, "[--series] kann nicht mit [--fleet] verwendet werden (Datensätze je Gerät mit [--format])\n\n");
+            exit(EXIT_FAILURE);
+        }
+        return runFleet(fleetDevices, fleetWorkers > 0 ? fleetWorkers : FLEET_DEFAULT_WORKERS);
+    }
+
+    if ((g_ctx.exporterMode || g_ctx.holdInterval > 0) && socketClient) {
+        fprintf(stderr, "[--exporter] bzw. [--hold] und [--socket] schliessen sich aus\n\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Abfrage an einen laufenden Daemon weiterreichen
+    if (socketClient) {
+        return forwardToDaemon();
+    }
+
+    // Sitzung dauerhaft halten und Abfragen über den Unix-Socket bedienen
+    if (g_ctx.daemonMode) {
+        return runDaemon();
+    }
+
+    // -r Tags zyklisch abfragen und als Prometheus-Metriken bereitstellen
+    if (g_ctx.exporterMode) {
+        return runExporter();
+    }
+
+    // --format: JSON-Array bzw. CSV-Kopf um alle Datensätze, auch wenn die Verbindung scheitert
+    // (g_output schließt die Ausgabe bei jedem Programmende ab, return aus main() oder exit())
+    g_output.setFormat(g_ctx.ausgabeFormat);
+    g_output.begin(stdout);
+
+    // abgeschlossene History-Perioden: sind alle im Cache, ist keine Verbindung nötig
+    if (g_ctx.historieAbfrage) {
+        openHistoryCache();
+        if (answerHistoryFromCache()) {
+            return 0;
+        }
+    }
+
+    // -c/-d in festen Abständen erneuern, bis SIGINT/SIGTERM
+    if (g_ctx.holdInterval > 0) {
+        return runHold();
+    }
+
     // Verbinde mit Hauskraftwerk
-    connectToServer();
+    if (!connectToServer()) {
+        exit(EXIT_FAILURE);
+    }
 
     // Starte Sende- / Empfangsschleife
+    resetPowerSettingsResult();
     mainLoop();
 
     // Trenne Verbindung zum Hauskraftwerk
@@ -2298,6 +5160,8 @@ int main(int argc, char *argv[])
     
     DEBUG("Ende!\n\n");
 
-    return 0;
+    // Anmeldung gescheitert, Verbindung verloren und nicht wieder aufgebaut bzw. Setzbefehl mit unbekanntem Ergebnis,
+    // Abfrage unvollständig oder vom S10 abgelehnte Lade-/Entladeleistung
+    return sessionExitStatus();
 }
 
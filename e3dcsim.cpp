@@ -0,0 +1,783 @@
+/*
+ * e3dcsim.cpp
+ *
+ * S10 Simulator: beantwortet verschlüsselte RSCP-Anfragen wie ein E3DC Hauskraftwerk.
+ * Dient zum Testen und Benchmarken von e3dcset ohne echtes Gerät.
+ *
+ *  - Rijndael-256 CBC mit fortlaufendem IV je Richtung (Start 0xff), wie das S10
+ *  - Authentifizierung über TAG_RSCP_REQ_AUTHENTICATION (Benutzer/Passwort aus der Konfiguration)
+ *  - synthetische Werte für EMS, BAT (inkl. DCB), DB-Historie, PM und PVI
+ *  - einstellbare Antwortlatenz mit Jitter
+ *  - beliebig viele gleichzeitige Clients (ein Thread pro Verbindung)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <math.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "RscpProtocol.h"
+#include "RscpTags.h"
+#include "AES.h"
+
+#define DEBUG(...)if(debug) {printf(__VA_ARGS__);}
+
+#define AES_KEY_SIZE    32
+#define AES_BLOCK_SIZE  32
+
+typedef struct {
+    char         bind_ip[20];
+    uint32_t     server_port;
+    char         e3dc_user[128];
+    char         e3dc_password[128];
+    char         aes_password[128];
+    uint32_t     latency_ms;   // Antwortverzögerung
+    uint32_t     jitter_ms;    // zufällige Abweichung +/- der Verzögerung
+    uint8_t      dcb_count;    // Anzahl Zellblöcke je Batteriemodul
+    uint32_t     drop_every;   // jeden n-ten Frame einer Verbindung nicht beantworten und trennen, 0 = nie
+    uint32_t     max_power;    // höchste Lade-/Entladeleistung in W, größere Werte werden angepasst, 0 = unbegrenzt
+    bool         reject_power; // größere Werte ablehnen statt anpassen
+} e3dcsim_config_t;
+
+static e3dcsim_config_t sim_config;
+static bool debug = false;
+static std::atomic<int> iActiveClients(0);
+static std::atomic<uint64_t> uClients(0);     // Statistik: Verbindungen gesamt
+static std::atomic<uint64_t> uFrames(0);      // Statistik: beantwortete Frames
+static std::atomic<uint64_t> uBytesOut(0);    // Statistik: gesendete Bytes (verschlüsselt)
+static volatile sig_atomic_t bStop = 0;
+
+// feste Werte aus der Kommandozeile (-v TAG=Wert), überschreiben die synthetischen Werte
+static std::map<uint32_t, double> fixedValues;
+
+// Synthetischer Messwert: base + amplitude * sin(2*pi*t/period)
+struct SimValue {
+    uint32_t tag;
+    uint8_t  dataType;
+    double   base;
+    double   amplitude;
+    uint32_t period;
+};
+
+static const SimValue simValues[] = {
+    { TAG_EMS_POWER_PV,             RSCP::eTypeInt32,   3200,  2800, 600 },
+    { TAG_EMS_POWER_BAT,            RSCP::eTypeInt32,    800,  1500, 300 },
+    { TAG_EMS_POWER_HOME,           RSCP::eTypeInt32,    650,   250, 120 },
+    { TAG_EMS_POWER_GRID,           RSCP::eTypeInt32,   -900,  1200, 240 },
+    { TAG_EMS_POWER_ADD,            RSCP::eTypeInt32,      0,     0,   1 },
+    { TAG_EMS_POWER_WB_ALL,         RSCP::eTypeInt32,      0,     0,   1 },
+    { TAG_EMS_POWER_WB_SOLAR,       RSCP::eTypeInt32,      0,     0,   1 },
+    { TAG_EMS_AUTARKY,              RSCP::eTypeFloat32,   85,    10, 900 },
+    { TAG_EMS_SELF_CONSUMPTION,     RSCP::eTypeFloat32,   60,    20, 900 },
+    { TAG_EMS_BAT_SOC,              RSCP::eTypeUChar8,    60,    30, 3600 },
+    { TAG_EMS_COUPLING_MODE,        RSCP::eTypeUChar8,     1,     0,   1 },
+    { TAG_EMS_MODE,                 RSCP::eTypeUChar8,     0,     0,   1 },
+    { TAG_EMS_STATUS,               RSCP::eTypeUInt32,    19,     0,   1 },
+    { TAG_EMS_INSTALLED_PEAK_POWER, RSCP::eTypeUInt32,  9800,     0,   1 },
+    { TAG_EMS_EMERGENCY_POWER_STATUS, RSCP::eTypeUChar8,   1,     0,   1 },
+    { TAG_BAT_RSOC,                 RSCP::eTypeFloat32,   60,    30, 3600 },
+    { 0x0380000F /* BAT_ASOC */,   RSCP::eTypeFloat32,   97,     0,   1 },
+    { TAG_BAT_MODULE_VOLTAGE,       RSCP::eTypeFloat32,  52.8,  1.2, 600 },
+    { TAG_BAT_CURRENT,              RSCP::eTypeFloat32,   15,    25, 300 },
+    { TAG_BAT_MAX_BAT_VOLTAGE,      RSCP::eTypeFloat32,  57.6,    0,   1 },
+    { TAG_BAT_MAX_CHARGE_CURRENT,   RSCP::eTypeFloat32,   90,     0,   1 },
+    { TAG_BAT_EOD_VOLTAGE,          RSCP::eTypeFloat32,   44,     0,   1 },
+    { TAG_BAT_MAX_DISCHARGE_CURRENT,RSCP::eTypeFloat32,   90,     0,   1 },
+    { TAG_BAT_CHARGE_CYCLES,        RSCP::eTypeUInt32,   412,     0,   1 },
+    { TAG_BAT_TERMINAL_VOLTAGE,     RSCP::eTypeFloat32,  52.9,  1.2, 600 },
+    { TAG_BAT_STATUS_CODE,          RSCP::eTypeUInt32,     0,     0,   1 },
+    { TAG_BAT_ERROR_CODE,           RSCP::eTypeUInt32,     0,     0,   1 },
+    { TAG_BAT_MAX_DCB_CELL_TEMPERATURE, RSCP::eTypeFloat32, 27,   3, 1800 },
+    { TAG_BAT_MIN_DCB_CELL_TEMPERATURE, RSCP::eTypeFloat32, 23,   3, 1800 },
+    { TAG_BAT_READY_FOR_SHUTDOWN,   RSCP::eTypeBool,       0,     0,   1 },
+    { TAG_BAT_TRAINING_MODE,        RSCP::eTypeUChar8,     0,     0,   1 },
+    { TAG_PM_POWER_L1,              RSCP::eTypeDouble64, 210,   150, 200 },
+    { TAG_PM_POWER_L2,              RSCP::eTypeDouble64, 180,   120, 220 },
+    { TAG_PM_POWER_L3,              RSCP::eTypeDouble64, 260,   100, 240 },
+    { TAG_PM_ACTIVE_PHASES,         RSCP::eTypeUChar8,     7,     0,   1 },
+    { TAG_PM_VOLTAGE_L1,            RSCP::eTypeFloat32,  231,     3,  60 },
+    { TAG_PM_ENERGY_L1,             RSCP::eTypeDouble64, 1.2e6,   0,   1 },
+    { TAG_PVI_ON_GRID,              RSCP::eTypeBool,       1,     0,   1 },
+    { TAG_PVI_AC_MAX_PHASE_COUNT,   RSCP::eTypeUChar8,     3,     0,   1 },
+    { TAG_PVI_DC_MAX_STRING_COUNT,  RSCP::eTypeUChar8,     2,     0,   1 },
+};
+
+static const SimValue* findSimValue(uint32_t tag)
+{
+    for (size_t i = 0; i < sizeof(simValues) / sizeof(simValues[0]); i++) {
+        if (simValues[i].tag == tag) {
+            return &simValues[i];
+        }
+    }
+    return NULL;
+}
+
+static double currentValue(uint32_t tag, const SimValue* sim, double offset = 0)
+{
+    std::map<uint32_t, double>::const_iterator it = fixedValues.find(tag);
+    if (it != fixedValues.end()) {
+        return it->second;
+    }
+    if (!sim) {
+        // unbekannte Tags liefern einen stabilen, vom Tag abhängigen Wert
+        return (double)((tag * 2654435761u) >> 22);
+    }
+    double t = (double)time(NULL) + offset;
+    return sim->base + sim->amplitude * sin(2.0 * M_PI * t / sim->period);
+}
+
+static void appendSynthetic(RscpProtocol & protocol, SRscpValue* parent, uint32_t tag, double offset = 0)
+{
+    const SimValue* sim = findSimValue(tag);
+    double value = currentValue(tag, sim, offset);
+    uint8_t dataType = sim ? sim->dataType : (uint8_t)RSCP::eTypeInt32;
+
+    switch (dataType) {
+    case RSCP::eTypeBool:     protocol.appendValue(parent, tag, (bool)(value != 0)); break;
+    case RSCP::eTypeUChar8:   protocol.appendValue(parent, tag, (uint8_t)lround(value)); break;
+    case RSCP::eTypeUInt32:   protocol.appendValue(parent, tag, (uint32_t)lround(value)); break;
+    case RSCP::eTypeFloat32:  protocol.appendValue(parent, tag, (float)value); break;
+    case RSCP::eTypeDouble64: protocol.appendValue(parent, tag, value); break;
+    default:                  protocol.appendValue(parent, tag, (int32_t)lround(value)); break;
+    }
+}
+
+//--------------------------------------------------------------------------------------------------------------
+// Antworten für zusammengesetzte Anfragen
+//--------------------------------------------------------------------------------------------------------------
+
+static void appendDCBInfo(RscpProtocol & protocol, SRscpValue* parent, uint8_t dcbIndex)
+{
+    SRscpValue dcb;
+    protocol.createContainerValue(&dcb, TAG_BAT_DCB_INFO);
+    if (dcbIndex >= sim_config.dcb_count) {
+        protocol.appendErrorValue(&dcb, TAG_BAT_DCB_INDEX, RSCP_ERR_OUT_OF_BOUNDS);
+    } else {
+        double t = (double)time(NULL);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_INDEX, dcbIndex);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_LAST_MESSAGE_TIMESTAMP, (uint64_t)(t * 1000));
+        protocol.appendValue(&dcb, TAG_BAT_DCB_MAX_CHARGE_VOLTAGE, 57.6f);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_MAX_CHARGE_CURRENT, 45.0f);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_END_OF_DISCHARGE, 44.0f);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_MAX_DISCHARGE_CURRENT, 45.0f);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_FULL_CHARGE_CAPACITY, 52.0f - dcbIndex * 0.3f);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_REMAINING_CAPACITY, 31.0f + dcbIndex * 0.2f);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_SOC, (float)(60 + 30 * sin(t / 600.0) + dcbIndex * 0.1));
+        protocol.appendValue(&dcb, TAG_BAT_DCB_SOH, 97.0f - dcbIndex * 0.4f);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_CYCLE_COUNT, (uint32_t)(410 + dcbIndex));
+        protocol.appendValue(&dcb, TAG_BAT_DCB_CURRENT, (float)(7.5 + 12.5 * sin(t / 300.0)));
+        protocol.appendValue(&dcb, TAG_BAT_DCB_VOLTAGE, (float)(52.8 + 0.6 * sin(t / 600.0)));
+        protocol.appendValue(&dcb, TAG_BAT_DCB_CURRENT_AVG_30S, (float)(7.5 + 12.5 * sin((t - 15) / 300.0)));
+        protocol.appendValue(&dcb, TAG_BAT_DCB_VOLTAGE_AVG_30S, (float)(52.8 + 0.6 * sin((t - 15) / 600.0)));
+        protocol.appendValue(&dcb, TAG_BAT_DCB_DESIGN_CAPACITY, 52.0f);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_DESIGN_VOLTAGE, 51.2f);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_CHARGE_LOW_TEMPERATURE, 0.0f);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_CHARGE_HIGH_TEMPERATURE, 45.0f);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_MANUFACTURE_DATE, (uint64_t)1546300800);
+        char serial[32];
+        snprintf(serial, sizeof(serial), "SIM-DCB-%04u", dcbIndex);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_SERIALNO, serial);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_PROTOCOL_VERSION, (uint32_t)3);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_FW_VERSION, (uint32_t)0x0115);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_DATA_TABLE_VERSION, (uint32_t)2);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_PCB_VERSION, (uint32_t)4);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_NR_SERIES_CELL, (uint32_t)16);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_NR_PARALLEL_CELL, (uint32_t)1);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_MANUFACTURE_NAME, "E3DC Simulator");
+        protocol.appendValue(&dcb, TAG_BAT_DCB_DEVICE_NAME, "SIM-DCB");
+        protocol.appendValue(&dcb, TAG_BAT_DCB_SERIALCODE, serial);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_NR_SENSOR, (uint32_t)4);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_STATUS, (uint32_t)0);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_WARNING, (uint32_t)0);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_ALARM, (uint32_t)0);
+        protocol.appendValue(&dcb, TAG_BAT_DCB_ERROR, (uint32_t)0);
+    }
+    protocol.appendValue(parent, dcb);
+    protocol.destroyValueData(dcb);
+}
+
+static void appendBatData(RscpProtocol & protocol, SRscpValue* parent, const SRscpValue & request)
+{
+    SRscpValue batData;
+    protocol.createContainerValue(&batData, TAG_BAT_DATA);
+
+    std::vector<SRscpValue> items = protocol.getValueAsContainer(&request);
+    for (size_t i = 0; i < items.size(); i++) {
+        switch (items[i].tag) {
+        case TAG_BAT_INDEX:
+            protocol.appendValue(&batData, TAG_BAT_INDEX, protocol.getValueAsUInt16(&items[i]));
+            break;
+        case TAG_BAT_REQ_DCB_COUNT:
+            protocol.appendValue(&batData, TAG_BAT_DCB_COUNT, sim_config.dcb_count);
+            break;
+        case TAG_BAT_REQ_DCB_INFO:
+            appendDCBInfo(protocol, &batData, protocol.getValueAsUChar8(&items[i]));
+            break;
+        case TAG_BAT_REQ_DEVICE_NAME:
+            protocol.appendValue(&batData, TAG_BAT_DEVICE_NAME, "BAT SIM");
+            break;
+        default:
+            appendSynthetic(protocol, &batData, items[i].tag | 0x00800000);
+            break;
+        }
+    }
+    protocol.destroyValueData(items);
+
+    protocol.appendValue(parent, batData);
+    protocol.destroyValueData(batData);
+}
+
+static void appendHistory(RscpProtocol & protocol, SRscpValue* parent, const SRscpValue & request)
+{
+    uint64_t timeStart = 0;
+    uint32_t interval = 900, span = 86400;
+
+    std::vector<SRscpValue> items = protocol.getValueAsContainer(&request);
+    for (size_t i = 0; i < items.size(); i++) {
+        switch (items[i].tag) {
+        case TAG_DB_REQ_HISTORY_TIME_START:    timeStart = protocol.getValueAsUInt64(&items[i]); break;
+        case TAG_DB_REQ_HISTORY_TIME_INTERVAL: interval = protocol.getValueAsUInt32(&items[i]); break;
+        case TAG_DB_REQ_HISTORY_TIME_SPAN:     span = protocol.getValueAsUInt32(&items[i]); break;
+        }
+    }
+    protocol.destroyValueData(items);
+
+    SRscpValue history;
+    protocol.createContainerValue(&history, request.tag | 0x00800000);
+
+    if (interval == 0 || span / interval > 2000) {
+        protocol.appendErrorValue(&history, TAG_DB_SUM_CONTAINER, RSCP_ERR_OUT_OF_BOUNDS);
+    } else {
+        uint32_t points = span / interval;
+        float sum[8] = {0};
+        std::vector<SRscpValue> valueContainers;
+
+        for (uint32_t p = 0; p < points; p++) {
+            // Tagesgang: PV nur tagsüber, Verbrauch mit Grundlast
+            double t = (double)(timeStart + (uint64_t)p * interval);
+            double hour = fmod(t / 3600.0, 24.0);
+            double scale = interval / 3600.0;
+            double pv, home;
+            if (interval >= 86400) {
+                // Intervalle ab einem Tag: Tagesmittel statt Momentanwert, Jahresgang über den Sonnenstand
+                double season = 0.6 + 0.4 * cos(2.0 * M_PI * (fmod(t / 86400.0, 365.25) - 172) / 365.25);
+                pv = 6000 * 14 / 24.0 * 2 / M_PI * season;
+                home = 450 + 300 * 5 / 24.0;
+                hour = 12;
+            } else {
+                pv = (hour > 6 && hour < 20) ? 6000 * sin(M_PI * (hour - 6) / 14) : 0;
+                home = 450 + 300 * (hour > 17 && hour < 22);
+            }
+            double batIn = pv > home ? (pv - home) * 0.5 : 0;
+            double batOut = pv < home ? (home - pv) * 0.7 : 0;
+            double gridIn = pv > home ? (pv - home) - batIn : 0;
+            double gridOut = pv < home ? (home - pv) - batOut : 0;
+
+            float values[8] = {
+                (float)(batIn * scale), (float)(batOut * scale), (float)(pv * scale),
+                (float)(gridIn * scale), (float)(gridOut * scale), (float)(home * scale),
+                (float)(50 + 40 * sin(M_PI * (hour - 9) / 12)), (float)(home > 0 ? 100 * (1 - gridOut / home) : 100)
+            };
+            for (int k = 0; k < 6; k++) {
+                sum[k] += values[k];
+            }
+
+            SRscpValue point;
+            protocol.createContainerValue(&point, TAG_DB_VALUE_CONTAINER);
+            protocol.appendValue(&point, TAG_DB_GRAPH_INDEX, (float)p);
+            protocol.appendValue(&point, TAG_DB_BAT_POWER_IN, values[0]);
+            protocol.appendValue(&point, TAG_DB_BAT_POWER_OUT, values[1]);
+            protocol.appendValue(&point, TAG_DB_DC_POWER, values[2]);
+            protocol.appendValue(&point, TAG_DB_GRID_POWER_IN, values[3]);
+            protocol.appendValue(&point, TAG_DB_GRID_POWER_OUT, values[4]);
+            protocol.appendValue(&point, TAG_DB_CONSUMPTION, values[5]);
+            protocol.appendValue(&point, TAG_DB_BAT_CHARGE_LEVEL, values[6]);
+            protocol.appendValue(&point, TAG_DB_AUTARKY, values[7]);
+            valueContainers.push_back(point);
+        }
+
+        SRscpValue sumContainer;
+        protocol.createContainerValue(&sumContainer, TAG_DB_SUM_CONTAINER);
+        protocol.appendValue(&sumContainer, TAG_DB_GRAPH_INDEX, (float)0);
+        protocol.appendValue(&sumContainer, TAG_DB_BAT_POWER_IN, sum[0]);
+        protocol.appendValue(&sumContainer, TAG_DB_BAT_POWER_OUT, sum[1]);
+        protocol.appendValue(&sumContainer, TAG_DB_DC_POWER, sum[2]);
+        protocol.appendValue(&sumContainer, TAG_DB_GRID_POWER_IN, sum[3]);
+        protocol.appendValue(&sumContainer, TAG_DB_GRID_POWER_OUT, sum[4]);
+        protocol.appendValue(&sumContainer, TAG_DB_CONSUMPTION, sum[5]);
+        protocol.appendValue(&sumContainer, TAG_DB_BAT_CHARGE_LEVEL, 62.0f);
+        protocol.appendValue(&sumContainer, TAG_DB_AUTARKY, sum[5] > 0 ? 100.0f * (1 - sum[4] / sum[5]) : 100.0f);
+        protocol.appendValue(&history, sumContainer);
+        protocol.destroyValueData(sumContainer);
+
+        for (size_t k = 0; k < valueContainers.size(); k++) {
+            protocol.appendValue(&history, valueContainers[k]);
+        }
+        protocol.destroyValueData(valueContainers);
+    }
+
+    protocol.appendValue(parent, history);
+    protocol.destroyValueData(history);
+}
+
+static void appendPowerSettings(RscpProtocol & protocol, SRscpValue* parent, const SRscpValue & request)
+{
+    SRscpValue settings;
+    protocol.createContainerValue(&settings, TAG_EMS_SET_POWER_SETTINGS);
+
+    std::vector<SRscpValue> items = protocol.getValueAsContainer(&request);
+    for (size_t i = 0; i < items.size(); i++) {
+        // Ergebniscode je Einstellung: 0 = übernommen, 1 = auf die Höchstleistung angepasst, -1 = abgelehnt
+        int8_t result = 0;
+        if ((items[i].tag == TAG_EMS_MAX_CHARGE_POWER || items[i].tag == TAG_EMS_MAX_DISCHARGE_POWER) &&
+            sim_config.max_power > 0 && protocol.getValueAsUInt32(&items[i]) > sim_config.max_power) {
+            result = sim_config.reject_power ? -1 : 1;
+        }
+        protocol.appendValue(&settings, items[i].tag | 0x00800000, result);
+    }
+    protocol.destroyValueData(items);
+
+    protocol.appendValue(parent, settings);
+    protocol.destroyValueData(settings);
+}
+
+static void appendEPReserve(RscpProtocol & protocol, SRscpValue* parent, const SRscpValue & request)
+{
+    float reserveWh = 0;
+    std::vector<SRscpValue> items = protocol.getValueAsContainer(&request);
+    for (size_t i = 0; i < items.size(); i++) {
+        if (items[i].tag == TAG_EP_PARAM_EP_RESERVE_ENERGY) {
+            reserveWh = protocol.getValueAsFloat32(&items[i]);
+        }
+    }
+    protocol.destroyValueData(items);
+
+    SRscpValue reserve;
+    protocol.createContainerValue(&reserve, request.tag | 0x00800000);
+    protocol.appendValue(&reserve, TAG_EP_PARAM_INDEX, (uint8_t)0);
+    protocol.appendValue(&reserve, TAG_EP_PARAM_EP_RESERVE, reserveWh / 130.0f);  // 13 kWh Speicher
+    protocol.appendValue(&reserve, TAG_EP_PARAM_EP_RESERVE_ENERGY, reserveWh);
+    protocol.appendValue(parent, reserve);
+    protocol.destroyValueData(reserve);
+}
+
+// PM_REQ_DATA, PVI_REQ_DATA, ...: Index zurückgeben, alle anderen Einträge synthetisch beantworten
+static void appendGenericContainer(RscpProtocol & protocol, SRscpValue* parent, const SRscpValue & request)
+{
+    SRscpValue data;
+    protocol.createContainerValue(&data, request.tag | 0x00800000);
+
+    std::vector<SRscpValue> items = protocol.getValueAsContainer(&request);
+    for (size_t i = 0; i < items.size(); i++) {
+        bool isIndex = (items[i].tag == TAG_PM_INDEX || items[i].tag == TAG_PVI_INDEX || (items[i].tag & 0x00800000));
+        if (isIndex) {
+            protocol.appendValue(&data, items[i]);
+        } else if (items[i].length > 0 && (items[i].tag & 0xFF000000) == 0x02000000) {
+            // PVI-Stringwerte: Anfrage mit Index, Antwort als Container {PVI_INDEX, PVI_VALUE}
+            uint16_t index = protocol.getValueAsUInt16(&items[i]);
+            SRscpValue stringValue;
+            protocol.createContainerValue(&stringValue, items[i].tag | 0x00800000);
+            protocol.appendValue(&stringValue, TAG_PVI_INDEX, index);
+            protocol.appendValue(&stringValue, TAG_PVI_VALUE, (float)(currentValue(items[i].tag | 0x00800000, NULL) / (index + 1)));
+            protocol.appendValue(&data, stringValue);
+            protocol.destroyValueData(stringValue);
+        } else {
+            appendSynthetic(protocol, &data, items[i].tag | 0x00800000);
+        }
+    }
+    protocol.destroyValueData(items);
+
+    protocol.appendValue(parent, data);
+    protocol.destroyValueData(data);
+}
+
+//--------------------------------------------------------------------------------------------------------------
+// Verbindung eines Clients
+//--------------------------------------------------------------------------------------------------------------
+
+struct SimSession {
+    int iSocket;
+    bool bAuthenticated;
+    uint32_t frames;          // empfangene Frames dieser Verbindung
+    AES aesEncrypter;
+    AES aesDecrypter;
+    uint8_t ucEncryptionIV[AES_BLOCK_SIZE];
+    uint8_t ucDecryptionIV[AES_BLOCK_SIZE];
+};
+
+static void appendResponse(RscpProtocol & protocol, SimSession & session, SRscpValue* root, const SRscpValue & request)
+{
+    if (request.tag == TAG_RSCP_REQ_AUTHENTICATION) {
+        std::string user, password;
+        std::vector<SRscpValue> items = protocol.getValueAsContainer(&request);
+        for (size_t i = 0; i < items.size(); i++) {
+            if (items[i].tag == TAG_RSCP_AUTHENTICATION_USER) user = protocol.getValueAsString(&items[i]);
+            if (items[i].tag == TAG_RSCP_AUTHENTICATION_PASSWORD) password = protocol.getValueAsString(&items[i]);
+        }
+        protocol.destroyValueData(items);
+        session.bAuthenticated = (user == sim_config.e3dc_user && password == sim_config.e3dc_password);
+        // Benutzerlevel 10 (Kunde) bzw. 0 bei falschen Zugangsdaten
+        protocol.appendValue(root, TAG_RSCP_AUTHENTICATION, (uint8_t)(session.bAuthenticated ? 10 : 0));
+        return;
+    }
+
+    if (!session.bAuthenticated) {
+        protocol.appendErrorValue(root, request.tag | 0x00800000, RSCP_ERR_ACCESS_DENIED);
+        return;
+    }
+
+    switch (request.tag) {
+    case TAG_BAT_REQ_DATA:
+        appendBatData(protocol, root, request);
+        break;
+    case TAG_DB_REQ_HISTORY_DATA_DAY:
+    case TAG_DB_REQ_HISTORY_DATA_WEEK:
+    case TAG_DB_REQ_HISTORY_DATA_MONTH:
+    case TAG_DB_REQ_HISTORY_DATA_YEAR:
+        appendHistory(protocol, root, request);
+        break;
+    case TAG_EMS_REQ_SET_POWER_SETTINGS:
+        appendPowerSettings(protocol, root, request);
+        break;
+    case TAG_EMS_REQ_START_MANUAL_CHARGE:
+        protocol.appendValue(root, TAG_EMS_START_MANUAL_CHARGE, true);
+        break;
+    case TAG_EP_REQ_SET_EP_RESERVE:
+    case TAG_EP_REQ_EP_RESERVE:
+        appendEPReserve(protocol, root, request);
+        break;
+    default:
+        if (request.dataType == RSCP::eTypeContainer) {
+            appendGenericContainer(protocol, root, request);
+        } else {
+            appendSynthetic(protocol, root, request.tag | 0x00800000);
+        }
+        break;
+    }
+}
+
+static void responseDelay(void)
+{
+    if (sim_config.latency_ms == 0 && sim_config.jitter_ms == 0) {
+        return;
+    }
+    int64_t delay = sim_config.latency_ms;
+    if (sim_config.jitter_ms > 0) {
+        static thread_local unsigned int seed = (unsigned int)time(NULL) ^ (unsigned int)pthread_self();
+        delay += (int64_t)(rand_r(&seed) % (2 * sim_config.jitter_ms + 1)) - sim_config.jitter_ms;
+    }
+    if (delay > 0) {
+        struct timespec ts = { (time_t)(delay / 1000), (long)(delay % 1000) * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+}
+
+static bool sendResponse(SimSession & session, const SRscpValue & root)
+{
+    RscpProtocol protocol;
+    SRscpFrameBuffer frameBuffer;
+    memset(&frameBuffer, 0, sizeof(frameBuffer));
+    protocol.createFrameAsBuffer(&frameBuffer, root.data, root.length, true);
+
+    std::vector<uint8_t> encryptionBuffer(((frameBuffer.dataLength + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE) * AES_BLOCK_SIZE, 0);
+    memcpy(&encryptionBuffer[0], frameBuffer.data, frameBuffer.dataLength);
+    protocol.destroyFrameData(frameBuffer);
+
+    session.aesEncrypter.SetIV(session.ucEncryptionIV, AES_BLOCK_SIZE);
+    session.aesEncrypter.Encrypt(&encryptionBuffer[0], &encryptionBuffer[0], encryptionBuffer.size() / AES_BLOCK_SIZE);
+    memcpy(session.ucEncryptionIV, &encryptionBuffer[0] + encryptionBuffer.size() - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+
+    responseDelay();
+
+    size_t sent = 0;
+    while (sent < encryptionBuffer.size()) {
+        ssize_t n = send(session.iSocket, &encryptionBuffer[sent], encryptionBuffer.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        sent += n;
+    }
+    uFrames++;
+    uBytesOut += sent;
+    return true;
+}
+
+static void clientThread(int iSocket)
+{
+    SimSession session;
+    session.iSocket = iSocket;
+    session.bAuthenticated = false;
+    session.frames = 0;
+    memset(session.ucEncryptionIV, 0xff, AES_BLOCK_SIZE);
+    memset(session.ucDecryptionIV, 0xff, AES_BLOCK_SIZE);
+
+    uint8_t ucAesKey[AES_KEY_SIZE];
+    memset(ucAesKey, 0xff, AES_KEY_SIZE);
+    size_t keyLength = strlen(sim_config.aes_password);
+    memcpy(ucAesKey, sim_config.aes_password, keyLength > AES_KEY_SIZE ? AES_KEY_SIZE : keyLength);
+    session.aesEncrypter.SetParameters(AES_KEY_SIZE * 8, AES_BLOCK_SIZE * 8);
+    session.aesDecrypter.SetParameters(AES_KEY_SIZE * 8, AES_BLOCK_SIZE * 8);
+    session.aesEncrypter.StartEncryption(ucAesKey);
+    session.aesDecrypter.StartDecryption(ucAesKey);
+
+    RscpProtocol protocol;
+    std::vector<uint8_t> cipher;     // empfangene, noch nicht entschlüsselte Bytes
+    std::vector<uint8_t> plain;      // entschlüsselter Datenstrom
+    uint8_t buffer[4096];
+
+    while (true) {
+        ssize_t n = recv(iSocket, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            break;
+        }
+        cipher.insert(cipher.end(), buffer, buffer + n);
+
+        // nur vollständige Blöcke entschlüsseln, der IV läuft über alle Blöcke weiter
+        size_t blocks = cipher.size() / AES_BLOCK_SIZE;
+        if (blocks == 0) {
+            continue;
+        }
+        size_t oldSize = plain.size();
+        plain.resize(oldSize + blocks * AES_BLOCK_SIZE);
+        session.aesDecrypter.SetIV(session.ucDecryptionIV, AES_BLOCK_SIZE);
+        session.aesDecrypter.Decrypt(&cipher[0], &plain[oldSize], blocks);
+        memcpy(session.ucDecryptionIV, &cipher[blocks * AES_BLOCK_SIZE - AES_BLOCK_SIZE], AES_BLOCK_SIZE);
+        cipher.erase(cipher.begin(), cipher.begin() + blocks * AES_BLOCK_SIZE);
+
+        // vollständige Frames verarbeiten; jeder Frame ist auf die Blockgröße aufgefüllt
+        bool bError = false;
+        while (plain.size() >= sizeof(SRscpFrameHeader)) {
+            int32_t frameLength = protocol.getFrameLength(&plain[0], plain.size());
+            if (frameLength < 0) {
+                DEBUG("Client %d: ungültiger Frame (%d)\n", iSocket, frameLength);
+                bError = true;
+                break;
+            }
+            size_t paddedLength = ((frameLength + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE) * AES_BLOCK_SIZE;
+            if (plain.size() < paddedLength) {
+                break;
+            }
+
+            SRscpFrame frame;
+            int32_t iResult = protocol.parseFrame(&plain[0], frameLength, &frame);
+            plain.erase(plain.begin(), plain.begin() + paddedLength);
+            if (iResult < 0) {
+                DEBUG("Client %d: Frame nicht lesbar (%d)\n", iSocket, iResult);
+                bError = true;
+                break;
+            }
+
+            // Verbindungsabbruch mitten in einer Anfrage (-X)
+            if (sim_config.drop_every > 0 && ++session.frames % sim_config.drop_every == 0) {
+                DEBUG("Client %d: Frame %u nicht beantwortet, Verbindung getrennt\n", iSocket, session.frames);
+                protocol.destroyFrameData(frame);
+                bError = true;
+                break;
+            }
+
+            SRscpValue root;
+            protocol.createContainerValue(&root, 0);
+            for (size_t i = 0; i < frame.data.size(); i++) {
+                DEBUG("Client %d: Anfrage 0x%08X\n", iSocket, frame.data[i].tag);
+                appendResponse(protocol, session, &root, frame.data[i]);
+            }
+            protocol.destroyFrameData(frame);
+
+            bool bSent = sendResponse(session, root);
+            protocol.destroyValueData(root);
+            if (!bSent) {
+                bError = true;
+                break;
+            }
+        }
+        if (bError) {
+            break;
+        }
+    }
+
+    close(iSocket);
+    iActiveClients--;
+    DEBUG("Client %d getrennt, %d aktiv\n", iSocket, iActiveClients.load());
+}
+
+//--------------------------------------------------------------------------------------------------------------
+
+static void stopHandler(int)
+{
+    bStop = 1;
+}
+
+void usage(void){
+    fprintf(stderr, "\n   Usage: e3dcsim [-p Pfad zur Konfigurationsdatei] [-b IP] [-P Port] [-L Latenz] [-J Jitter] [-n DCBs] [-v TAG=Wert] [-X n] [-W Watt] [-R] [-D]\n\n");
+    fprintf(stderr, "   Optionen:\n");
+    fprintf(stderr, "     -p  Konfigurationsdatei mit server_port, e3dc_user, e3dc_password, aes_password (Standard: e3dcset.config)\n");
+    fprintf(stderr, "     -b  Lokale IP-Adresse (Standard: 0.0.0.0)\n");
+    fprintf(stderr, "     -P  Port (überschreibt server_port)\n");
+    fprintf(stderr, "     -L  Antwortlatenz in ms (Standard: 0)\n");
+    fprintf(stderr, "     -J  Jitter der Latenz in ms (+/-, Standard: 0)\n");
+    fprintf(stderr, "     -n  Anzahl DCB-Zellblöcke je Batteriemodul (Standard: 3)\n");
+    fprintf(stderr, "     -v  Festen Wert für einen Response-Tag setzen, z.B. -v 0x01800001=4200\n");
+    fprintf(stderr, "     -X  Jeden n-ten Frame einer Verbindung nicht beantworten und die Verbindung trennen\n");
+    fprintf(stderr, "     -W  Höchste Lade-/Entladeleistung in W, größere Werte von -c/-d werden angepasst (Ergebnis 1)\n");
+    fprintf(stderr, "     -R  Größere Werte als -W ablehnen statt anpassen (Ergebnis -1)\n");
+    fprintf(stderr, "     -D  Debug-Ausgaben\n\n");
+    exit(EXIT_FAILURE);
+}
+
+static void readConfig(const char* path)
+{
+    FILE *fp = fopen(path, "r");
+    char var[128], value[128], line[256];
+
+    if (!fp) {
+        fprintf(stderr, "Konfigurationsdatei %s nicht gefunden, verwende Standardwerte\n", path);
+        return;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        memset(var, 0, sizeof(var));
+        memset(value, 0, sizeof(value));
+        if (sscanf(line, "%[^ \t=]%*[\t ]=%*[\t ]%[^\n]", var, value) == 2) {
+            if (strcmp(var, "server_port") == 0)
+                sim_config.server_port = atoi(value);
+            else if (strcmp(var, "e3dc_user") == 0)
+                strcpy(sim_config.e3dc_user, value);
+            else if (strcmp(var, "e3dc_password") == 0)
+                strcpy(sim_config.e3dc_password, value);
+            else if (strcmp(var, "aes_password") == 0)
+                strcpy(sim_config.aes_password, value);
+        }
+    }
+    fclose(fp);
+}
+
+int main(int argc, char *argv[])
+{
+    const char* configPath = "e3dcset.config";
+    int port = -1;
+
+    memset(&sim_config, 0, sizeof(sim_config));
+    strcpy(sim_config.bind_ip, "0.0.0.0");
+    sim_config.server_port = 5033;
+    sim_config.dcb_count = 3;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:b:P:L:J:n:v:X:W:RD")) != -1) {
+        switch (opt) {
+        case 'p':
+            configPath = optarg;
+            break;
+        case 'b':
+            snprintf(sim_config.bind_ip, sizeof(sim_config.bind_ip), "%s", optarg);
+            break;
+        case 'P':
+            port = atoi(optarg);
+            break;
+        case 'L':
+            sim_config.latency_ms = atoi(optarg);
+            break;
+        case 'J':
+            sim_config.jitter_ms = atoi(optarg);
+            break;
+        case 'n':
+            sim_config.dcb_count = (uint8_t)atoi(optarg);
+            break;
+        case 'v': {
+            char* eq = strchr(optarg, '=');
+            if (!eq) {
+                usage();
+            }
+            fixedValues[(uint32_t)strtoul(optarg, NULL, 0)] = atof(eq + 1);
+            break;
+        }
+        case 'X':
+            sim_config.drop_every = (uint32_t)atoi(optarg);
+            break;
+        case 'W':
+            sim_config.max_power = (uint32_t)atoi(optarg);
+            break;
+        case 'R':
+            sim_config.reject_power = true;
+            break;
+        case 'D':
+            debug = true;
+            break;
+        default:
+            usage();
+        }
+    }
+    if (optind < argc) {
+        usage();
+    }
+
+    readConfig(configPath);
+    if (port > 0) {
+        sim_config.server_port = port;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    // ohne SA_RESTART, damit accept() bei SIGINT/SIGTERM zurückkehrt und die Statistik ausgegeben wird
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stopHandler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(sim_config.server_port);
+    if (inet_pton(AF_INET, sim_config.bind_ip, &addr.sin_addr) <= 0) {
+        fprintf(stderr, "IP-Adresse %s ungültig\n", sim_config.bind_ip);
+        return EXIT_FAILURE;
+    }
+
+    int listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    int enable = 1;
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    if (bind(listenSocket, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(listenSocket, 128) < 0) {
+        fprintf(stderr, "Port %u kann nicht geöffnet werden. errno %i\n", sim_config.server_port, errno);
+        return EXIT_FAILURE;
+    }
+
+    printf("S10 Simulator lauscht auf %s:%u (Latenz %u ms +/- %u ms, %u DCBs)\n",
+           sim_config.bind_ip, sim_config.server_port, sim_config.latency_ms, sim_config.jitter_ms, sim_config.dcb_count);
+    fflush(stdout);
+
+    struct timespec startTime;
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+
+    while (!bStop) {
+        int clientSocket = accept(listenSocket, NULL, NULL);
+        if (clientSocket < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "accept() fehlgeschlagen. errno %i\n", errno);
+            break;
+        }
+        setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        iActiveClients++;
+        uClients++;
+        DEBUG("Client %d verbunden, %d aktiv\n", clientSocket, iActiveClients.load());
+        std::thread(clientThread, clientSocket).detach();
+    }
+
+    close(listenSocket);
+
+    struct timespec endTime;
+    clock_gettime(CLOCK_MONOTONIC, &endTime);
+    double seconds = (endTime.tv_sec - startTime.tv_sec) + (endTime.tv_nsec - startTime.tv_nsec) / 1e9;
+    printf("Statistik: %llu Verbindungen, %llu Frames, %llu Bytes in %.1f s (%.1f Frames/s)\n",
+           (unsigned long long)uClients.load(), (unsigned long long)uFrames.load(), (unsigned long long)uBytesOut.load(),
+           seconds, seconds > 0 ? uFrames.load() / seconds : 0.0);
+    return 0;
+}
@@ -0,0 +1,481 @@
+/*
+ * Benchmark of the RSCP hot path of e3dcset.
+ * Measures frame build, encrypt, decrypt, parse and dispatch (handleResponseValue) on realistic payloads:
+ *  - single-tag:  -r EMS_POWER_PV
+ *  - bat-9:       9 BAT_REQ_* tags in one TAG_BAT_REQ_DATA container
+ *  - dcb-32:      module dump (-m) of 32 DCBs, two frames with 16 TAG_BAT_DCB_INFO each
+ *  - history-year: -H year, one TAG_DB_VALUE_CONTAINER per week
+ * Reports ns/op, MiB/s, allocations/op (malloc, calloc, realloc and new are counted) and write syscalls/op
+ * (syscw of /proc/self/io, the output of the response handlers).
+ *
+ * make bench                  # build and run
+ * ./rscpbench [-l] [iterations]
+ * -l makes stdout line buffered like on a terminal, otherwise it is fully buffered like in a pipe.
+ * The tags file (e3dcset.tags) is loaded if present, the dispatch then includes the description lookups.
+ *
+ * e3dcset.cpp is compiled into this benchmark to measure the real request and response functions,
+ * the output of the response handlers goes to /dev/null.
+ */
+
+#define main e3dcset_main
+#include "e3dcset.cpp"
+#undef main
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include "Crc32.h"
+
+//--------------------------------------------------------------------------------------------------------------
+// Allocation counter: all allocations of the process end up in these functions
+//--------------------------------------------------------------------------------------------------------------
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+
+static uint64_t uAllocations = 0;
+
+void *malloc(size_t size) {
+    uAllocations++;
+    return __libc_malloc(size);
+}
+void *calloc(size_t count, size_t size) {
+    uAllocations++;
+    return __libc_calloc(count, size);
+}
+void *realloc(void *ptr, size_t size) {
+    uAllocations++;
+    return __libc_realloc(ptr, size);
+}
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+}
+
+//--------------------------------------------------------------------------------------------------------------
+// Workloads
+//--------------------------------------------------------------------------------------------------------------
+struct BenchFrame {
+    std::vector<uint8_t> request;        // plain request frame as created by createRequestExample()
+    std::vector<uint8_t> response;       // plain response frame, padded to AES_BLOCK_SIZE
+    std::vector<uint8_t> encrypted;      // encrypted response frame
+    uint32_t responseLength;             // length of the response frame without padding
+};
+
+struct BenchWorkload {
+    const char *name;
+    void (*setup)(void);                 // set up g_ctx like the command line parser (once, allocates)
+    void (*beforeFrame)(size_t frame);   // state of g_ctx before each frame, as left by the previous response
+    size_t frameCount;
+    std::vector<BenchFrame> frames;
+};
+
+static const uint32_t batTags[] = {
+    TAG_BAT_REQ_RSOC, TAG_BAT_REQ_ASOC, TAG_BAT_REQ_CHARGE_CYCLES, TAG_BAT_REQ_CURRENT, TAG_BAT_REQ_MODULE_VOLTAGE,
+    TAG_BAT_REQ_MAX_BAT_VOLTAGE, TAG_BAT_REQ_STATUS_CODE, TAG_BAT_REQ_ERROR_CODE, TAG_BAT_REQ_DCB_COUNT
+};
+
+static void resetContext(void) {
+    g_ctx = CommandContext();
+    g_ctx.quietMode = false;
+    iAuthenticated = 1;
+}
+
+static void setupSingleTag(void) {
+    resetContext();
+    g_ctx.werteAbfragen = true;
+    g_ctx.leseTags.push_back(TAG_EMS_REQ_POWER_PV);
+    g_ctx.leseTag = TAG_EMS_REQ_POWER_PV;
+}
+
+static void setupBat9(void) {
+    resetContext();
+    g_ctx.werteAbfragen = true;
+    g_ctx.leseTags.assign(batTags, batTags + sizeof(batTags) / sizeof(batTags[0]));
+    g_ctx.leseTag = g_ctx.leseTags[0];
+}
+
+static void setupDcb32(void) {
+    resetContext();
+    g_ctx.modulInfoDump = true;
+    g_ctx.isFirstModuleDumpRequest = false;
+    g_ctx.needMoreDCBRequests = true;
+    g_ctx.totalDCBs = 32;
+    g_ctx.currentDCBIndex = 0;
+}
+
+static void beforeFrameDcb32(size_t frame) {
+    // same state as after the response of the previous frame
+    g_ctx.isFirstModuleDumpRequest = false;
+    g_ctx.needMoreDCBRequests = true;
+    g_ctx.totalDCBs = 32;
+    g_ctx.currentDCBIndex = frame * MAX_DCB_REQUESTS_PER_FRAME;
+    g_ctx.dcbBatchEnd = g_ctx.currentDCBIndex + MAX_DCB_REQUESTS_PER_FRAME;
+}
+
+static char historyType[] = "year";
+static char historyDate[] = "2024-01-01";
+
+static void setupHistoryYear(void) {
+    resetContext();
+    g_ctx.historieAbfrage = true;
+    g_ctx.historieTyp = historyType;
+    g_ctx.historieDatum = historyDate;
+}
+
+static void beforeFrameHistory(size_t) {
+    // the period of the response is taken from the request order
+    g_ctx.historieAngefragt = 0;
+    g_ctx.historieEmpfangen = 0;
+}
+
+static void appendDcbInfo(RscpFrameBuilder & builder, uint8_t index) {
+    char serial[32];
+    snprintf(serial, sizeof(serial), "BENCH-DCB-%04u", index);
+    builder.beginContainer(TAG_BAT_DCB_INFO);
+    builder.appendValue(TAG_BAT_DCB_INDEX, index);
+    builder.appendValue(TAG_BAT_DCB_LAST_MESSAGE_TIMESTAMP, (uint64_t)1735689600000ULL);
+    builder.appendValue(TAG_BAT_DCB_MAX_CHARGE_VOLTAGE, 57.6f);
+    builder.appendValue(TAG_BAT_DCB_MAX_CHARGE_CURRENT, 45.0f);
+    builder.appendValue(TAG_BAT_DCB_END_OF_DISCHARGE, 44.0f);
+    builder.appendValue(TAG_BAT_DCB_MAX_DISCHARGE_CURRENT, 45.0f);
+    builder.appendValue(TAG_BAT_DCB_FULL_CHARGE_CAPACITY, 52.0f - index * 0.3f);
+    builder.appendValue(TAG_BAT_DCB_REMAINING_CAPACITY, 31.0f + index * 0.2f);
+    builder.appendValue(TAG_BAT_DCB_SOC, 61.5f);
+    builder.appendValue(TAG_BAT_DCB_SOH, 97.0f - index * 0.4f);
+    builder.appendValue(TAG_BAT_DCB_CYCLE_COUNT, (uint32_t)(410 + index));
+    builder.appendValue(TAG_BAT_DCB_CURRENT, 7.5f);
+    builder.appendValue(TAG_BAT_DCB_VOLTAGE, 52.8f);
+    builder.appendValue(TAG_BAT_DCB_CURRENT_AVG_30S, 7.4f);
+    builder.appendValue(TAG_BAT_DCB_VOLTAGE_AVG_30S, 52.7f);
+    builder.appendValue(TAG_BAT_DCB_DESIGN_CAPACITY, 52.0f);
+    builder.appendValue(TAG_BAT_DCB_DESIGN_VOLTAGE, 51.2f);
+    builder.appendValue(TAG_BAT_DCB_CHARGE_LOW_TEMPERATURE, 0.0f);
+    builder.appendValue(TAG_BAT_DCB_CHARGE_HIGH_TEMPERATURE, 45.0f);
+    builder.appendValue(TAG_BAT_DCB_MANUFACTURE_DATE, (uint64_t)1546300800);
+    builder.appendValue(TAG_BAT_DCB_SERIALNO, serial);
+    builder.appendValue(TAG_BAT_DCB_PROTOCOL_VERSION, (uint32_t)3);
+    builder.appendValue(TAG_BAT_DCB_FW_VERSION, (uint32_t)0x0115);
+    builder.appendValue(TAG_BAT_DCB_DATA_TABLE_VERSION, (uint32_t)2);
+    builder.appendValue(TAG_BAT_DCB_PCB_VERSION, (uint32_t)4);
+    builder.appendValue(TAG_BAT_DCB_NR_SERIES_CELL, (uint32_t)16);
+    builder.appendValue(TAG_BAT_DCB_NR_PARALLEL_CELL, (uint32_t)1);
+    builder.appendValue(TAG_BAT_DCB_MANUFACTURE_NAME, "E3DC");
+    builder.appendValue(TAG_BAT_DCB_DEVICE_NAME, "DCB");
+    builder.appendValue(TAG_BAT_DCB_SERIALCODE, serial);
+    builder.appendValue(TAG_BAT_DCB_NR_SENSOR, (uint32_t)4);
+    builder.appendValue(TAG_BAT_DCB_STATUS, (uint32_t)0);
+    builder.appendValue(TAG_BAT_DCB_WARNING, (uint32_t)0);
+    builder.appendValue(TAG_BAT_DCB_ALARM, (uint32_t)0);
+    builder.appendValue(TAG_BAT_DCB_ERROR, (uint32_t)0);
+    builder.endContainer();
+}
+
+static void appendHistoryValues(RscpFrameBuilder & builder, uint32_t tag, float index, float scale) {
+    builder.beginContainer(tag);
+    builder.appendValue(TAG_DB_GRAPH_INDEX, index);
+    builder.appendValue(TAG_DB_BAT_POWER_IN, 61000.0f * scale);
+    builder.appendValue(TAG_DB_BAT_POWER_OUT, 52000.0f * scale);
+    builder.appendValue(TAG_DB_DC_POWER, 180000.0f * scale);
+    builder.appendValue(TAG_DB_GRID_POWER_IN, 95000.0f * scale);
+    builder.appendValue(TAG_DB_GRID_POWER_OUT, 21000.0f * scale);
+    builder.appendValue(TAG_DB_CONSUMPTION, 97000.0f * scale);
+    builder.appendValue(TAG_DB_BAT_CHARGE_LEVEL, 55.0f);
+    builder.appendValue(TAG_DB_AUTARKY, 78.0f);
+    builder.endContainer();
+}
+
+// Creates the response of the S10 to the request \var request
+static void createResponse(const std::vector<uint8_t> & request, BenchFrame & frame) {
+    RscpProtocol protocol;
+    RscpValueRange values;
+    if(protocol.parseFrameView(&request[0], request.size(), &values) < 0) {
+        fprintf(stderr, "Fehler: Request-Frame ungueltig\n");
+        exit(EXIT_FAILURE);
+    }
+
+    RscpFrameBuilder builder;
+    for(RscpValueIterator it = values.begin(); it != values.end(); ++it) {
+        uint32_t responseTag = it->tag | 0x00800000;
+        switch(it->tag) {
+        case TAG_EMS_REQ_POWER_PV:
+            builder.appendValue(responseTag, (int32_t)4711);
+            break;
+        case TAG_BAT_REQ_DATA: {
+            builder.beginContainer(TAG_BAT_DATA);
+            RscpValueRange items = protocol.getValueAsContainerView(&*it);
+            for(RscpValueIterator item = items.begin(); item != items.end(); ++item) {
+                uint32_t itemTag = item->tag | 0x00800000;
+                switch(item->tag) {
+                case TAG_BAT_INDEX:            builder.appendValue(TAG_BAT_INDEX, (uint16_t)0); break;
+                case TAG_BAT_REQ_DCB_INFO:     appendDcbInfo(builder, protocol.getValueAsUChar8(&*item)); break;
+                case TAG_BAT_REQ_DCB_COUNT:    builder.appendValue(itemTag, (uint8_t)32); break;
+                case TAG_BAT_REQ_CHARGE_CYCLES:
+                case TAG_BAT_REQ_STATUS_CODE:
+                case TAG_BAT_REQ_ERROR_CODE:   builder.appendValue(itemTag, (uint32_t)412); break;
+                default:                       builder.appendValue(itemTag, 52.25f); break;
+                }
+            }
+            builder.endContainer();
+            break;
+        }
+        case TAG_DB_REQ_HISTORY_DATA_YEAR: {
+            builder.beginContainer(responseTag);
+            appendHistoryValues(builder, TAG_DB_SUM_CONTAINER, 0, 1.0f);
+            for(int week = 0; week < HISTORY_SPAN_YEAR / HISTORY_INTERVAL_YEAR; week++) {
+                appendHistoryValues(builder, TAG_DB_VALUE_CONTAINER, week, 1.0f / 52);
+            }
+            builder.endContainer();
+            break;
+        }
+        default:
+            fprintf(stderr, "Fehler: Keine Antwort fuer Tag 0x%08X\n", it->tag);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    SRscpFrameBuffer frameBuffer;
+    if(builder.finish(&frameBuffer, true) != RSCP::OK) {
+        fprintf(stderr, "Fehler: Response-Frame konnte nicht erstellt werden\n");
+        exit(EXIT_FAILURE);
+    }
+    frame.responseLength = frameBuffer.dataLength;
+    frame.response.assign(frameBuffer.data, frameBuffer.data + frameBuffer.dataLength);
+    frame.response.resize(ROUNDUP(frameBuffer.dataLength, AES_BLOCK_SIZE), 0);
+    protocol.destroyFrameData(&frameBuffer);
+
+    frame.encrypted.resize(frame.response.size());
+    memset(ucEncryptionIV, 0xff, AES_BLOCK_SIZE);
+    aesEncrypter.SetIV(ucEncryptionIV, AES_BLOCK_SIZE);
+    aesEncrypter.Encrypt(&frame.response[0], &frame.encrypted[0], frame.response.size() / AES_BLOCK_SIZE);
+}
+
+static void prepareWorkload(BenchWorkload & workload) {
+    workload.setup();
+    workload.frames.resize(workload.frameCount);
+    for(size_t i = 0; i < workload.frameCount; i++) {
+        if(workload.beforeFrame) {
+            workload.beforeFrame(i);
+        }
+        SRscpFrameBuffer frameBuffer;
+        memset(&frameBuffer, 0, sizeof(frameBuffer));
+        if(createRequestExample(&frameBuffer) < 0) {
+            exit(EXIT_FAILURE);
+        }
+        workload.frames[i].request.assign(frameBuffer.data, frameBuffer.data + frameBuffer.dataLength);
+        RscpProtocol protocol;
+        protocol.destroyFrameData(&frameBuffer);
+        createResponse(workload.frames[i].request, workload.frames[i]);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------------------
+// Measurement
+//--------------------------------------------------------------------------------------------------------------
+static FILE *benchOut = NULL;
+static volatile uint32_t uSink = 0;
+
+// write syscalls of the process so far, 0 if the kernel has no task I/O accounting
+static uint64_t writeSyscalls(void) {
+    uint64_t count = 0;
+    FILE *io = fopen("/proc/self/io", "r");
+    if(io == NULL) {
+        return 0;
+    }
+    char line[64];
+    while(fgets(line, sizeof(line), io)) {
+        if(sscanf(line, "syscw: %" SCNu64, &count) == 1) {
+            break;
+        }
+    }
+    fclose(io);
+    return count;
+}
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+enum BenchPhase { PHASE_BUILD, PHASE_ENCRYPT, PHASE_DECRYPT, PHASE_PARSE, PHASE_PARSE_OWNING, PHASE_DISPATCH, PHASE_COUNT };
+static const char *phaseNames[PHASE_COUNT] = { "build", "encrypt", "decrypt", "parse", "parse-owning", "dispatch" };
+
+static uint32_t countValues(RscpProtocol & protocol, const RscpValueRange & values) {
+    uint32_t count = 0;
+    for(RscpValueIterator it = values.begin(); it != values.end(); ++it) {
+        count++;
+        if(it->dataType == RSCP::eTypeContainer) {
+            count += countValues(protocol, protocol.getValueAsContainerView(&*it));
+        }
+    }
+    return count;
+}
+
+static uint32_t countValuesOwning(RscpProtocol & protocol, std::vector<SRscpValue> & values) {
+    uint32_t count = 0;
+    for(size_t i = 0; i < values.size(); i++) {
+        count++;
+        if(values[i].dataType == RSCP::eTypeContainer) {
+            std::vector<SRscpValue> children = protocol.getValueAsContainer(&values[i]);
+            count += countValuesOwning(protocol, children);
+            protocol.destroyValueData(children);
+        }
+    }
+    return count;
+}
+
+// Runs one phase of all frames of \var workload once, returns the processed bytes
+static size_t runPhase(BenchWorkload & workload, BenchPhase phase, std::vector<uint8_t> & scratch) {
+    RscpProtocol protocol;
+    size_t bytes = 0;
+    for(size_t i = 0; i < workload.frames.size(); i++) {
+        BenchFrame & frame = workload.frames[i];
+        if(workload.beforeFrame && (phase == PHASE_BUILD || phase == PHASE_DISPATCH)) {
+            workload.beforeFrame(i);
+        }
+        switch(phase) {
+        case PHASE_BUILD: {
+            SRscpFrameBuffer frameBuffer;
+            memset(&frameBuffer, 0, sizeof(frameBuffer));
+            createRequestExample(&frameBuffer);
+            bytes += frameBuffer.dataLength;
+            protocol.destroyFrameData(&frameBuffer);
+            break;
+        }
+        case PHASE_ENCRYPT: {
+            // same steps as sendFrameBuffer() without the socket
+            size_t length = ROUNDUP(frame.request.size(), AES_BLOCK_SIZE);
+            memset(&scratch[0], 0, length);
+            memcpy(&scratch[0], &frame.request[0], frame.request.size());
+            aesEncrypter.SetIV(ucEncryptionIV, AES_BLOCK_SIZE);
+            aesEncrypter.Encrypt(&scratch[0], &scratch[0], length / AES_BLOCK_SIZE);
+            memcpy(ucEncryptionIV, &scratch[0] + length - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+            bytes += length;
+            break;
+        }
+        case PHASE_DECRYPT: {
+            memset(ucDecryptionIV, 0xff, AES_BLOCK_SIZE);
+            aesDecrypter.SetIV(ucDecryptionIV, AES_BLOCK_SIZE);
+            aesDecrypter.Decrypt(&frame.encrypted[0], &scratch[0], frame.encrypted.size() / AES_BLOCK_SIZE);
+            bytes += frame.encrypted.size();
+            break;
+        }
+        case PHASE_PARSE: {
+            RscpValueRange values;
+            protocol.parseFrameView(&frame.response[0], frame.response.size(), &values);
+            uSink += countValues(protocol, values);
+            bytes += frame.responseLength;
+            break;
+        }
+        case PHASE_PARSE_OWNING: {
+            // the copying API as used before the value views: every value and container is allocated
+            SRscpFrame parsed;
+            protocol.parseFrame(&frame.response[0], frame.response.size(), &parsed);
+            uSink += countValuesOwning(protocol, parsed.data);
+            protocol.destroyFrameData(parsed);
+            bytes += frame.responseLength;
+            break;
+        }
+        case PHASE_DISPATCH: {
+            processReceiveBuffer(&frame.response[0], frame.response.size());
+            bytes += frame.responseLength;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    return bytes;
+}
+
+static void runWorkload(BenchWorkload & workload, int iterations) {
+    std::vector<uint8_t> scratch(RSCP_MAX_FRAME_LENGTH + AES_BLOCK_SIZE);
+    size_t responseBytes = 0;
+    for(size_t i = 0; i < workload.frames.size(); i++) {
+        responseBytes += workload.frames[i].responseLength;
+    }
+    fprintf(benchOut, "\n%s (%zu Frame(s), Response %zu Bytes)\n", workload.name, workload.frames.size(), responseBytes);
+    workload.setup();
+
+    for(int phase = 0; phase < PHASE_COUNT; phase++) {
+        // warm up caches, tables and lazily created buffers
+        runPhase(workload, (BenchPhase)phase, scratch);
+        fflush(stdout);
+
+        size_t bytes = 0;
+        uint64_t writesBefore = writeSyscalls();
+        uint64_t allocationsBefore = uAllocations;
+        double start = nowSeconds();
+        for(int i = 0; i < iterations; i++) {
+            bytes += runPhase(workload, (BenchPhase)phase, scratch);
+        }
+        double elapsed = nowSeconds() - start;
+        uint64_t allocations = uAllocations - allocationsBefore;
+        fflush(stdout);
+        uint64_t writes = writeSyscalls() - writesBefore;
+
+        fprintf(benchOut, "  %-13s %12.0f ns/op %10.1f MiB/s %10.1f allocs/op %8.2f writes/op\n", phaseNames[phase],
+                elapsed * 1e9 / iterations, bytes / elapsed / (1024.0 * 1024.0), (double)allocations / iterations,
+                (double)writes / iterations);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    bool lineBuffered = argc > 1 && strcmp(argv[1], "-l") == 0;
+    if(lineBuffered) {
+        argc--;
+        argv++;
+    }
+    int iterations = (argc > 1) ? atoi(argv[1]) : 2000;
+    if(iterations <= 0) {
+        fprintf(stderr, "Fehler: Ungueltige Anzahl Iterationen\n");
+        return EXIT_FAILURE;
+    }
+
+    // results go to the original stdout, the output of the response handlers is discarded
+    benchOut = fdopen(dup(STDOUT_FILENO), "w");
+    int devNull = open("/dev/null", O_WRONLY);
+    if(benchOut == NULL || devNull < 0) {
+        perror("Ausgabe");
+        return EXIT_FAILURE;
+    }
+    fflush(stdout);
+    dup2(devNull, STDOUT_FILENO);
+    close(devNull);
+    if(lineBuffered) {
+        setvbuf(stdout, NULL, _IOLBF, BUFSIZ);
+    }
+
+    // AES key like connectToServer()
+    uint8_t ucAesKey[AES_KEY_SIZE];
+    memset(ucAesKey, 0xff, AES_KEY_SIZE);
+    memcpy(ucAesKey, "benchmark", 9);
+    aesDecrypter.SetParameters(AES_KEY_SIZE * 8, AES_BLOCK_SIZE * 8);
+    aesEncrypter.SetParameters(AES_KEY_SIZE * 8, AES_BLOCK_SIZE * 8);
+    aesDecrypter.StartDecryption(ucAesKey);
+    aesEncrypter.StartEncryption(ucAesKey);
+    memset(ucEncryptionIV, 0xff, AES_BLOCK_SIZE);
+
+    // tag descriptions and interpretations like the real program, if the tags file is available
+    if(access(g_ctx.tagfilePath, R_OK) == 0) {
+        loadTagsFile(g_ctx.tagfilePath);
+    }
+
+    BenchWorkload workloads[] = {
+        { "single-tag",   setupSingleTag,   NULL,               1, std::vector<BenchFrame>() },
+        { "bat-9",        setupBat9,        NULL,               1, std::vector<BenchFrame>() },
+        { "dcb-32",       setupDcb32,       beforeFrameDcb32,   2, std::vector<BenchFrame>() },
+        { "history-year", setupHistoryYear, beforeFrameHistory, 1, std::vector<BenchFrame>() },
+    };
+
+    fprintf(benchOut, "RSCP Benchmark, %d Iterationen pro Messung (CRC32: %s, stdout %s)\n", iterations,
+            Crc32Implementation(), lineBuffered ? "zeilengepuffert" : "vollgepuffert");
+    for(size_t i = 0; i < sizeof(workloads) / sizeof(workloads[0]); i++) {
+        prepareWorkload(workloads[i]);
+        runWorkload(workloads[i], iterations);
+    }
+    fclose(benchOut);
+    return EXIT_SUCCESS;
+}
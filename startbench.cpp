@@ -0,0 +1,140 @@
+/*
+ * Startup benchmark for e3dcset.
+ * 1. in process: cost of the AES table computation (as done at every start before the tables were precomputed,
+ *    now only AES::SelfTest()) and of the key schedule for one key
+ * 2. process start: fork/exec of a command, time until the first output byte and until exit (p50/p99)
+ *
+ * make startbench && ./startbench [-n runs] [command [args...]]   (Standard: ./e3dcset -h)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <vector>
+#include <algorithm>
+#include "AES.h"
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double percentile(std::vector<double> values, double p) {
+    std::sort(values.begin(), values.end());
+    size_t index = (size_t) (p * (values.size() - 1) + 0.5);
+    return values[index];
+}
+
+// start the command once, stdout and stderr go into a pipe; returns false on errors
+static bool runOnce(char *const argv[], double *firstByte, double *total) {
+    int fds[2];
+    if(pipe(fds) != 0) {
+        return false;
+    }
+    double start = nowSeconds();
+    pid_t pid = fork();
+    if(pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if(pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        dup2(fds[1], STDERR_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    close(fds[1]);
+
+    char buffer[4096];
+    *firstByte = -1;
+    ssize_t n;
+    while((n = read(fds[0], buffer, sizeof(buffer))) != 0) {
+        if(n < 0) {
+            break;
+        }
+        if(*firstByte < 0) {
+            *firstByte = nowSeconds() - start;
+        }
+    }
+    close(fds[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    *total = nowSeconds() - start;
+    if(*firstByte < 0) {
+        *firstByte = *total;
+    }
+    return !(WIFEXITED(status) && WEXITSTATUS(status) == 127);
+}
+
+int main(int argc, char *argv[]) {
+    int runs = 300;
+    int argi = 1;
+    if(argi + 1 < argc && strcmp(argv[argi], "-n") == 0) {
+        runs = atoi(argv[argi + 1]);
+        argi += 2;
+    }
+    if(runs <= 0) {
+        fprintf(stderr, "Fehler: Ungueltige Anzahl Durchlaeufe\n");
+        return EXIT_FAILURE;
+    }
+    char *defaultCommand[] = { (char *) "./e3dcset", (char *) "-h", NULL };
+    char *const *command = (argi < argc) ? &argv[argi] : defaultCommand;
+
+    // in process
+    const int tableRuns = 200;
+    bool tablesOk = true;
+    double start = nowSeconds();
+    for(int i = 0; i < tableRuns; i++) {
+        tablesOk = AES::SelfTest() && tablesOk;
+    }
+    double tableTime = (nowSeconds() - start) / tableRuns;
+
+    unsigned char key[32];
+    memset(key, 0xff, sizeof(key));
+    memcpy(key, "e3dcset", 7);
+    const int keyRuns = 20000;
+    start = nowSeconds();
+    for(int i = 0; i < keyRuns; i++) {
+        AES encrypter, decrypter;
+        key[31] = (unsigned char) i;
+        encrypter.SetParameters(256, 256);
+        decrypter.SetParameters(256, 256);
+        encrypter.StartEncryption(key);
+        decrypter.StartDecryption(key);
+    }
+    double keyTime = (nowSeconds() - start) / keyRuns;
+
+    printf("AES Tabellen berechnen (frueher bei jedem Start): %8.1f us  (SelfTest: %s)\n",
+           tableTime * 1e6, tablesOk ? "ok" : "FEHLER");
+    printf("AES Key-Schedule Rijndael-256 (Ver- und Entschluesselung): %8.2f us\n", keyTime * 1e6);
+
+    // process start
+    std::vector<double> firstBytes, totals;
+    for(int i = 0; i < runs; i++) {
+        double firstByte, total;
+        if(!runOnce(command, &firstByte, &total)) {
+            fprintf(stderr, "Fehler: %s konnte nicht gestartet werden\n", command[0]);
+            return EXIT_FAILURE;
+        }
+        firstBytes.push_back(firstByte);
+        totals.push_back(total);
+    }
+
+    printf("Prozessstart:");
+    for(int i = 0; command[i] != NULL; i++) {
+        printf(" %s", command[i]);
+    }
+    printf(" (%d Durchlaeufe)\n", runs);
+    printf("  erstes Byte  p50 %7.3f ms  p99 %7.3f ms\n", percentile(firstBytes, 0.5) * 1e3, percentile(firstBytes, 0.99) * 1e3);
+    printf("  Ende         p50 %7.3f ms  p99 %7.3f ms\n", percentile(totals, 0.5) * 1e3, percentile(totals, 0.99) * 1e3);
+
+    return tablesOk ? EXIT_SUCCESS : EXIT_FAILURE;
+}
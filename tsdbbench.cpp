@@ -0,0 +1,126 @@
+/*
+ * Benchmark for the time series store (TimeSeriesStore.cpp).
+ * Writes synthetic 1 s values of a PV power tag for a number of days (timestamps with a few ms jitter like the
+ * poller, power values in watts with noise, night values 0), checks that every point reads back unchanged and
+ * reports size per point, append and query throughput.
+ *
+ * make tsdbbench && ./tsdbbench [-d days] [directory]   (Standard: 30 Tage in einem temporaeren Verzeichnis)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include "TimeSeriesStore.h"
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// PV power of a sunny day with clouds and noise, watts as integer like TAG_EMS_POWER_PV
+static double pvPower(int64_t second, uint32_t *seed) {
+    double hour = fmod(second / 3600.0, 24.0);
+    if(hour < 6.0 || hour > 20.0) {
+        return 0;
+    }
+    double sun = sin((hour - 6.0) / 14.0 * M_PI);
+    *seed = *seed * 1103515245u + 12345u;
+    double noise = ((*seed >> 16) % 200) - 100.0;
+    double clouds = (fmod(second / 600.0, 7.0) < 1.5) ? 0.4 : 1.0;
+    double power = 9000.0 * sun * clouds + noise;
+    return power < 0 ? 0 : floor(power);
+}
+
+int main(int argc, char *argv[]) {
+    int days = 30;
+    int argi = 1;
+    if(argi + 1 < argc && strcmp(argv[argi], "-d") == 0) {
+        days = atoi(argv[argi + 1]);
+        argi += 2;
+    }
+    if(days <= 0) {
+        fprintf(stderr, "Fehler: Ungueltige Anzahl Tage\n");
+        return EXIT_FAILURE;
+    }
+    char tempDirectory[] = "/tmp/tsdbbench.XXXXXX";
+    const char *directory = argi < argc ? argv[argi] : mkdtemp(tempDirectory);
+    if(directory == NULL) {
+        fprintf(stderr, "Fehler: Verzeichnis konnte nicht angelegt werden\n");
+        return EXIT_FAILURE;
+    }
+
+    const uint32_t tag = 0x01000001;   // TAG_EMS_POWER_PV
+    const int64_t start = 1790000000000LL;
+    const int64_t points = (int64_t) days * 86400;
+
+    // timestamps: 1 s cadence with up to 20 ms jitter, as seen by the poller
+    std::vector<int64_t> times(points);
+    std::vector<double> values(points);
+    uint32_t seed = 42;
+    for(int64_t i = 0; i < points; i++) {
+        seed = seed * 1103515245u + 12345u;
+        times[i] = start + i * 1000 + (seed >> 16) % 20;
+        values[i] = pvPower(i, &seed);
+    }
+
+    TimeSeriesStore store;
+    if(!store.open(directory)) {
+        fprintf(stderr, "Fehler: Speicher %s konnte nicht geoeffnet werden\n", directory);
+        return EXIT_FAILURE;
+    }
+    double t0 = nowSeconds();
+    for(int64_t i = 0; i < points; i++) {
+        if(!store.append(tag, times[i], values[i])) {
+            fprintf(stderr, "Fehler: Punkt %lld konnte nicht gespeichert werden\n", (long long) i);
+            return EXIT_FAILURE;
+        }
+    }
+    double appendTime = nowSeconds() - t0;
+    store.close();
+    store.open(directory);
+
+    // read back everything and compare
+    int64_t index = 0;
+    bool ok = true;
+    t0 = nowSeconds();
+    store.query(tag, INT64_MIN, INT64_MAX, [&](int64_t time, double value) {
+        if(index >= points || times[index] != time || values[index] != value) {
+            ok = false;
+        }
+        index++;
+    });
+    double queryTime = nowSeconds() - t0;
+    ok = ok && index == points;
+
+    // one day as 5 minute averages
+    int buckets = 0;
+    t0 = nowSeconds();
+    store.queryDownsampled(tag, start + (int64_t) (days / 2) * 86400000, start + (int64_t) (days / 2 + 1) * 86400000 - 1,
+                           300000, TS_AGG_AVG, [&](int64_t, double) { buckets++; });
+    double downsampleTime = nowSeconds() - t0;
+
+    uint64_t storedPoints, bytes;
+    uint32_t segments;
+    store.statistics(tag, &storedPoints, &bytes, &segments);
+
+    printf("%d Tage, %lld Punkte (1 s), %u Segmente\n", days, (long long) points, segments);
+    printf("  Groesse        %8.2f MB  (%.2f Byte/Punkt, unkomprimiert 16 Byte/Punkt)\n",
+           bytes / 1e6, (double) bytes / points);
+    printf("  Schreiben      %8.1f ns/Punkt\n", appendTime * 1e9 / points);
+    printf("  Lesen (alles)  %8.1f ns/Punkt  Pruefung: %s\n", queryTime * 1e9 / points, ok ? "ok" : "FEHLER");
+    printf("  1 Tag, 5 min Mittelwerte: %d Werte in %.2f ms\n", buckets, downsampleTime * 1e3);
+
+    if(argi >= argc) {
+        char command[128];
+        snprintf(command, sizeof(command), "rm -rf %s", directory);
+        if(system(command) != 0) {
+            fprintf(stderr, "Warnung: %s konnte nicht entfernt werden\n", directory);
+        }
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}